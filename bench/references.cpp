@@ -0,0 +1,83 @@
+// Serializes object graphs with a large number of object and string
+// references and reports the payload size and encode/decode times.
+
+#include <chrono>
+#include <cstdio>
+#include <initializer_list>
+#include <string>
+
+#include "amf.hpp"
+#include "deserializer.hpp"
+#include "serializer.hpp"
+#include "types/amfarray.hpp"
+#include "types/amfinteger.hpp"
+#include "types/amfobject.hpp"
+#include "types/amfstring.hpp"
+
+using namespace amf;
+
+typedef std::chrono::steady_clock Clock;
+
+static double elapsedMs(Clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Builds an array of 2 * count elements: count distinct objects, each of
+// which is referenced a second time, followed by count references to the
+// objects' label strings.
+static AmfArray buildGraph(int count) {
+	AmfArray root;
+	root.dense.reserve(3 * count);
+
+	for (int i = 0; i < count; ++i) {
+		AmfObject obj("Node", false, false);
+		obj.addSealedProperty("id", AmfInteger(i));
+		obj.addSealedProperty("label", AmfString("label" + std::to_string(i)));
+		root.push_back(obj);
+	}
+
+	for (int i = 0; i < count; ++i)
+		root.dense.push_back(root.dense[i]);
+
+	for (int i = 0; i < count; ++i)
+		root.push_back(AmfString("label" + std::to_string(i)));
+
+	return root;
+}
+
+int main() {
+	std::printf("%10s %12s %10s %12s %12s\n",
+		"refs", "bytes", "bytes/ref", "encode ms", "decode ms");
+
+	for (int count : { 5000, 50000, 500000 }) {
+		AmfArray root = buildGraph(count);
+
+		Clock::time_point start = Clock::now();
+		Serializer serializer;
+		serializer << root;
+		double encodeMs = elapsedMs(start);
+
+		const v8& data = serializer.data();
+
+		start = Clock::now();
+		Deserializer deserializer;
+		AmfArray decoded = deserializer.deserialize(data).as<AmfArray>();
+		double decodeMs = elapsedMs(start);
+
+		if (decoded.dense.size() != root.dense.size() ||
+		    decoded.dense[0].get() != decoded.dense[count].get()) {
+			std::fprintf(stderr, "round trip failed for %d references\n", 2 * count);
+			return 1;
+		}
+
+		int refs = 2 * count;
+		std::printf("%10d %12zu %10.2f %12.1f %12.1f\n",
+			refs, data.size(), static_cast<double>(data.size()) / refs,
+			encodeMs, decodeMs);
+
+		// Break up the shared ownership before the graphs are destroyed.
+		decoded.dense.clear();
+	}
+
+	return 0;
+}
@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <cstdint>
 #include <stdexcept>
+#include <utility>
 #include <vector>
 
 #ifdef _WIN32
@@ -47,8 +48,67 @@ v8 network_bytes(T x) {
 	return v8(bytes, bytes + sizeof(T));
 }
 
+// Appends x in network byte order to buf.
+template <typename T>
+void write_network(v8& buf, T x) {
+	T swapped = hton(x);
+	const u8* bytes = reinterpret_cast<const u8*>(&swapped);
+	buf.insert(buf.end(), bytes, bytes + sizeof(T));
+}
+
+// Overwrites the sizeof(T) bytes at offset with x in network byte order.
+// Used to back-patch length fields once the length is known.
+template <typename T>
+void patch_network(v8& buf, size_t offset, T x) {
+	T swapped = hton(x);
+	const u8* bytes = reinterpret_cast<const u8*>(&swapped);
+	std::copy(bytes, bytes + sizeof(T), buf.begin() + offset);
+}
+
+// Appends the lower 29 bits of value to buf, encoded as U29 (i.e. using
+// between one and four bytes, the high bit of each of the first three bytes
+// marking that another byte follows).
+inline void write_u29(v8& buf, uint32_t value) {
+	value &= 0x1FFFFFFF;
+
+	if (value <= 0x7F) {
+		buf.push_back(u8(value));
+	} else if (value <= 0x3FFF) {
+		u8 bytes[] = {
+			u8(value >> 7 | 0x80),
+			u8(value & 0x7F)
+		};
+		buf.insert(buf.end(), bytes, bytes + 2);
+	} else if (value <= 0x1FFFFF) {
+		u8 bytes[] = {
+			u8(value >> 14 | 0x80),
+			u8(((value >> 7) & 0x7F) | 0x80),
+			u8(value & 0x7F)
+		};
+		buf.insert(buf.end(), bytes, bytes + 3);
+	} else {
+		u8 bytes[] = {
+			u8(value >> 22 | 0x80),
+			u8(((value >> 15) & 0x7F) | 0x80),
+			u8(((value >> 8 ) & 0x7F) | 0x80),
+			u8(value & 0xFF)
+		};
+		buf.insert(buf.end(), bytes, bytes + 4);
+	}
+}
+
+// The number of bytes write_u29 appends for value.
+inline size_t u29_size(uint32_t value) {
+	value &= 0x1FFFFFFF;
+
+	if (value <= 0x7F) return 1;
+	if (value <= 0x3FFF) return 2;
+	if (value <= 0x1FFFFF) return 3;
+	return 4;
+}
+
 template<typename T>
-T read_network(v8::const_iterator& it, v8::const_iterator end) {
+T read_network(const u8*& it, const u8* end) {
 	if (static_cast<size_t>(end - it) < sizeof(T))
 		throw std::out_of_range("Not enough bytes to read");
 
@@ -59,6 +119,24 @@ T read_network(v8::const_iterator& it, v8::const_iterator end) {
 	return ntoh(val);
 }
 
+// Adapts a pointer-based deserialization function to vector iterators: f is
+// called with the range [it, end) and it is advanced past the consumed bytes.
+template<typename R, typename... Params, typename... Args>
+R with_pointers(R (*f)(const u8*&, const u8*, Params...),
+		v8::const_iterator& it, v8::const_iterator end, Args&&... args) {
+	const u8* begin = (it == end) ? nullptr : &*it;
+	const u8* cur = begin;
+	R ret = f(cur, begin + (end - it), std::forward<Args>(args)...);
+	it += cur - begin;
+
+	return ret;
+}
+
+template<typename T>
+T read_network(v8::const_iterator& it, v8::const_iterator end) {
+	return with_pointers(read_network<T>, it, end);
+}
+
 } // namespace amf
 
 #endif
@@ -0,0 +1,103 @@
+#include "amfatom.hpp"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace amf {
+
+// The table is split into shards with a lock each, so that threads decoding
+// different names rarely wait for each other.
+struct AmfAtom::Table {
+	static const size_t shardCount = 16;
+
+	struct Shard {
+		std::mutex mutex;
+		// Entries are never moved, so atoms can point to them.
+		std::deque<Entry> entries;
+		std::unordered_multimap<size_t, const Entry*> index;
+	};
+
+	Table() : maxAtoms(16384), maxLength(64), nextId(1), atoms(0), bytes(0),
+		lookups(0), hits(0) {
+		empty.hash = hash(nullptr, 0);
+		empty.id = 0;
+	}
+
+	Shard shards[shardCount];
+	// The default value, which isn't interned to keep AmfAtom() cheap.
+	Entry empty;
+
+	std::atomic<size_t> maxAtoms;
+	std::atomic<size_t> maxLength;
+	std::atomic<size_t> nextId;
+
+	std::atomic<size_t> atoms;
+	std::atomic<size_t> bytes;
+	std::atomic<size_t> lookups;
+	std::atomic<size_t> hits;
+};
+
+AmfAtom::Table& AmfAtom::table() {
+	// Never destroyed, so that atoms stay valid during static destruction.
+	static Table* table = new Table();
+	return *table;
+}
+
+AmfAtom::AmfAtom() : entry(&table().empty) { }
+
+AmfAtom::AmfAtom(AmfStringView str) {
+	Table& atoms = table();
+	size_t strHash = hash(str.data(), str.size());
+	atoms.lookups.fetch_add(1, std::memory_order_relaxed);
+
+	if (str.size() <= atoms.maxLength.load(std::memory_order_relaxed)) {
+		Table::Shard& shard = atoms.shards[strHash % Table::shardCount];
+		std::lock_guard<std::mutex> lock(shard.mutex);
+
+		auto range = shard.index.equal_range(strHash);
+		for (auto it = range.first; it != range.second; ++it) {
+			if (str == it->second->str) {
+				atoms.hits.fetch_add(1, std::memory_order_relaxed);
+				entry = it->second;
+				return;
+			}
+		}
+
+		// Concurrent threads may exceed the limit by a few atoms.
+		if (atoms.atoms.load(std::memory_order_relaxed) < atoms.maxAtoms.load(std::memory_order_relaxed)) {
+			Entry interned = { str.str(), strHash, atoms.nextId.fetch_add(1) };
+			shard.entries.push_back(std::move(interned));
+			entry = &shard.entries.back();
+			shard.index.emplace(strHash, entry);
+
+			atoms.atoms.fetch_add(1, std::memory_order_relaxed);
+			atoms.bytes.fetch_add(str.size(), std::memory_order_relaxed);
+			return;
+		}
+	}
+
+	Entry own = { str.str(), strHash, 0 };
+	owned = std::make_shared<const Entry>(std::move(own));
+	entry = owned.get();
+}
+
+void AmfAtom::setLimits(size_t maxAtoms, size_t maxLength) {
+	table().maxAtoms = maxAtoms;
+	table().maxLength = maxLength;
+}
+
+AmfAtom::Statistics AmfAtom::statistics() {
+	const Table& atoms = table();
+	Statistics stats = {
+		atoms.atoms.load(std::memory_order_relaxed),
+		atoms.bytes.load(std::memory_order_relaxed),
+		atoms.lookups.load(std::memory_order_relaxed),
+		atoms.hits.load(std::memory_order_relaxed)
+	};
+
+	return stats;
+}
+
+} // namespace amf
@@ -0,0 +1,139 @@
+#pragma once
+#ifndef AMFATOM_HPP
+#define AMFATOM_HPP
+
+#include <memory>
+#include <ostream>
+#include <string>
+
+#include "utils/amfstringview.hpp"
+
+namespace amf {
+
+// An immutable string, interned in a process-wide table. Atoms are used for
+// names that occur over and over again, like the dynamic property names of
+// objects: decoding a name that is in the table already doesn't allocate,
+// and interned atoms are compared by pointer.
+//
+// Interned atoms are never freed, so the table is limited in size (see
+// setLimits). Strings that don't fit are kept in atoms of their own, which
+// behave the same, but have an id of 0 and are compared by value.
+class AmfAtom {
+public:
+	struct Statistics {
+		// interned atoms and the bytes of their strings
+		size_t atoms;
+		size_t bytes;
+		// atoms created from strings and how many of those were interned
+		// already
+		size_t lookups;
+		size_t hits;
+	};
+
+	// The empty string.
+	AmfAtom();
+	explicit AmfAtom(AmfStringView str);
+	explicit AmfAtom(const std::string& str) : AmfAtom(AmfStringView(str)) { }
+	explicit AmfAtom(const char* str) : AmfAtom(AmfStringView(str)) { }
+
+	const std::string& str() const { return entry->str; }
+	operator const std::string&() const { return entry->str; }
+	size_t size() const { return entry->str.size(); }
+	bool empty() const { return entry->str.empty(); }
+
+	// The hash of the string, see hash(const char*, size_t).
+	size_t hash() const { return entry->hash; }
+	// A number identifying interned atoms, 0 for atoms that aren't interned.
+	size_t id() const { return entry->id; }
+
+	bool operator==(const AmfAtom& other) const {
+		if (entry == other.entry)
+			return true;
+
+		// different interned atoms always have different strings
+		if (entry->id != 0 && other.entry->id != 0)
+			return false;
+
+		return entry->hash == other.entry->hash && entry->str == other.entry->str;
+	}
+
+	bool operator!=(const AmfAtom& other) const {
+		return !(*this == other);
+	}
+
+	// The hash function used for atoms, which can be computed without
+	// creating a std::string.
+	static size_t hash(const char* data, size_t size) {
+		// FNV-1a
+		size_t value = static_cast<size_t>(14695981039346656037ull);
+		for (size_t i = 0; i < size; ++i) {
+			value ^= static_cast<unsigned char>(data[i]);
+			value *= static_cast<size_t>(1099511628211ull);
+		}
+
+		return value;
+	}
+
+	static size_t hash(const std::string& str) {
+		return hash(str.data(), str.size());
+	}
+
+	// Strings longer than maxLength bytes aren't interned, and no more atoms
+	// are interned once the table has maxAtoms atoms. This only affects atoms
+	// created afterwards. The defaults are 16384 atoms of 64 bytes.
+	static void setLimits(size_t maxAtoms, size_t maxLength);
+	static Statistics statistics();
+
+private:
+	struct Entry {
+		std::string str;
+		size_t hash;
+		size_t id;
+	};
+	struct Table;
+	static Table& table();
+
+	const Entry* entry;
+	// Keeps atoms alive that aren't interned.
+	std::shared_ptr<const Entry> owned;
+};
+
+inline bool operator==(const AmfAtom& lhs, const std::string& rhs) {
+	return lhs.str() == rhs;
+}
+
+inline bool operator!=(const AmfAtom& lhs, const std::string& rhs) {
+	return lhs.str() != rhs;
+}
+
+inline bool operator==(const std::string& lhs, const AmfAtom& rhs) {
+	return lhs == rhs.str();
+}
+
+inline bool operator!=(const std::string& lhs, const AmfAtom& rhs) {
+	return lhs != rhs.str();
+}
+
+inline bool operator==(const AmfAtom& lhs, const char* rhs) {
+	return lhs.str() == rhs;
+}
+
+inline bool operator!=(const AmfAtom& lhs, const char* rhs) {
+	return lhs.str() != rhs;
+}
+
+inline bool operator==(const char* lhs, const AmfAtom& rhs) {
+	return lhs == rhs.str();
+}
+
+inline bool operator!=(const char* lhs, const AmfAtom& rhs) {
+	return lhs != rhs.str();
+}
+
+inline std::ostream& operator<<(std::ostream& os, const AmfAtom& atom) {
+	return os << atom.str();
+}
+
+} // namespace amf
+
+#endif
@@ -1,5 +1,7 @@
 #include "amfpacket.hpp"
 
+#include "amfpacketindex.hpp"
+#include "amfthreadpool.hpp"
 #include "deserializationcontext.hpp"
 #include "deserializer.hpp"
 #include "serializationcontext.hpp"
@@ -8,173 +10,145 @@
 namespace amf {
 
 bool PacketHeader::operator==(const AmfItem& other) const {
-	const PacketHeader* p = dynamic_cast<const PacketHeader*>(&other);
+	const PacketHeader* p = item_cast<PacketHeader>(&other);
 	return p != nullptr && mustUnderstand == p->mustUnderstand &&
 		name == p->name && value == p->value;
 }
 
-v8 PacketHeader::serialize(SerializationContext& ctx) const {
-	v8 buf;
-	v8 value_data = value->serialize(ctx);
-	buf.reserve(2 + name.size() + 1 + 5 + value_data.size());
+void PacketHeader::serialize(v8& buf, SerializationContext& ctx) const {
 	// Strings in AMF packets are always serialized as AMF0 UTF-8, i.e.
 	// U16 length (in network order) U8* value
 	// even though AMF3 encodes strings in a different format
-	v8 name_length = network_bytes<uint16_t>(name.size());
-	buf.insert(buf.end(), name_length.begin(), name_length.end());
+	write_network<uint16_t>(buf, name.size());
 	buf.insert(buf.end(), name.begin(), name.end());
 
 	buf.push_back(mustUnderstand ? 0x01 : 0x00);
 
 	// we have to mark the value as AMF3 value, which is achieved by adding
 	// an AVMPLUS_OBJECT marker in front of the value. note that this counts
-	// towards the value's length.
-	v8 value_length = network_bytes<uint32_t>(value_data.size() + 1);
-	buf.insert(buf.end(), value_length.begin(), value_length.end());
+	// towards the value's length, which is patched in once it is known.
+	size_t length_offset = buf.size();
+	write_network<uint32_t>(buf, 0);
 	buf.push_back(AVMPLUS_OBJECT);
-	buf.insert(buf.end(), value_data.begin(), value_data.end());
-
-	return buf;
+	// every AMF3 value starts with empty reference tables
+	ctx.clear();
+	value->serialize(buf, ctx);
+	patch_network<uint32_t>(buf, length_offset, buf.size() - length_offset - 4);
 }
 
-PacketHeader PacketHeader::deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
-	uint16_t name_len = read_network<uint16_t>(it, end);
-
-	// Check for enough bytes for name and must understand flag.
-	if (end - it < name_len + 1)
-		throw std::out_of_range("Not enough bytes for PacketHeader");
-
-	std::string name(it, it + name_len);
-	it += name_len;
-
-	bool mustUnderstand = (*it++ == 0x01);
+size_t PacketHeader::serializedSize(SerializationContext&) const {
+	// name, must understand flag, value length and AVMPLUS_OBJECT marker.
+	// the value starts with empty reference tables, so it's sized with a
+	// context of its own instead of clearing the caller's.
+	SerializationContext valueCtx;
+	return 2 + name.size() + 1 + 4 + 1 + value->serializedSize(valueCtx);
+}
 
-	uint32_t value_len = read_network<uint32_t>(it, end);
-	// If the value length is (U32)-1 the actual length is unknown, thus require
-	// at least one byte for the type marker.
-	if (value_len == 0xFFFFFFFF) {
-		value_len = 1;
-	}
+// Decodes the value of a header or message, which starts with empty
+// reference tables. A known length bounds the value.
+static AmfItemPtr deserialize_value(const u8*& it, const u8* end, size_t length,
+	DeserializationContext& ctx) {
+	ctx.clear();
+	if (length == AmfPacketIndex::unknownLength)
+		return Deserializer::deserialize(it, end, ctx);
+
+	const u8* value_end = it + length;
+	AmfItemPtr value = Deserializer::deserialize(it, value_end, ctx);
+	it = value_end;
+	return value;
+}
 
-	// Check that we have enough data left for the AVM object marker and value.
-	// Note that the byte for the object marker is already included in value_len.
-	// If value_len is invalid (i.e. 0), this check always fails.
-	if (static_cast<uint32_t>(end - it) < value_len)
+PacketHeader PacketHeader::deserialize(const u8*& it, const u8* end, DeserializationContext& ctx) {
+	AmfPacketIndex::Framing framing;
+	if (!AmfPacketIndex::readFraming(it, end, true, framing))
 		throw std::out_of_range("Not enough bytes for PacketHeader");
 
-	if (*it++ != AVMPLUS_OBJECT)
-		throw std::invalid_argument("PacketHeader: Invalid type marker");
-
-	PacketHeader header(name, mustUnderstand, AmfNull());
-	header.value = Deserializer::deserialize(it, end, ctx);
-
+	PacketHeader header(framing.name.str(), framing.mustUnderstand, AmfNull());
+	header.value = deserialize_value(it, end, framing.valueLength, ctx);
 	return header;
 }
 
 bool PacketMessage::operator==(const AmfItem& other) const {
-	const PacketMessage* p = dynamic_cast<const PacketMessage*>(&other);
+	const PacketMessage* p = item_cast<PacketMessage>(&other);
 	return p != nullptr && target == p->target && response == p->response &&
 		value == p->value;
 }
 
-v8 PacketMessage::serialize(SerializationContext& ctx) const {
-	v8 buf;
-	v8 value_data = value->serialize(ctx);
-	buf.reserve(2 + target.size() + 2 + response.size() + 5 + value_data.size());
-
-	v8 target_length = network_bytes<uint16_t>(target.size());
-	buf.insert(buf.end(), target_length.begin(), target_length.end());
+void PacketMessage::serialize(v8& buf, SerializationContext& ctx) const {
+	write_network<uint16_t>(buf, target.size());
 	buf.insert(buf.end(), target.begin(), target.end());
 
-	v8 response_length = network_bytes<uint16_t>(response.size());
-	buf.insert(buf.end(), response_length.begin(), response_length.end());
+	write_network<uint16_t>(buf, response.size());
 	buf.insert(buf.end(), response.begin(), response.end());
 
-	v8 value_length = network_bytes<uint32_t>(value_data.size() + 1);
-	buf.insert(buf.end(), value_length.begin(), value_length.end());
+	size_t length_offset = buf.size();
+	write_network<uint32_t>(buf, 0);
 	buf.push_back(AVMPLUS_OBJECT);
-	buf.insert(buf.end(), value_data.begin(), value_data.end());
-
-	return buf;
+	ctx.clear();
+	value->serialize(buf, ctx);
+	patch_network<uint32_t>(buf, length_offset, buf.size() - length_offset - 4);
 }
 
-PacketMessage PacketMessage::deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
-	uint16_t target_len = read_network<uint16_t>(it, end);
-	if (end - it < target_len)
-		throw std::out_of_range("Not enough bytes for PacketMessage");
-
-	std::string target(it, it + target_len);
-	it += target_len;
-
-	uint16_t response_len = read_network<uint16_t>(it, end);
-	if (end - it < response_len)
-		throw std::out_of_range("Not enough bytes for PacketMessage");
-
-	std::string response(it, it + response_len);
-	it += response_len;
-
-	uint32_t value_len = read_network<uint32_t>(it, end);
-	// If the value length is (U32)-1 the actual length is unknown, thus require
-	// at least one byte for the type marker.
-	if (value_len == 0xFFFFFFFF) {
-		value_len = 1;
-	}
+size_t PacketMessage::serializedSize(SerializationContext&) const {
+	// target and response URIs, value length and AVMPLUS_OBJECT marker
+	SerializationContext valueCtx;
+	return 2 + target.size() + 2 + response.size() + 4 + 1 + value->serializedSize(valueCtx);
+}
 
-	// Check that we have enough data left for the AVM object marker and value.
-	// Note that the byte for the object marker is already included in value_len.
-	// If value_len is invalid (i.e. 0), this check always fails.
-	if (static_cast<uint32_t>(end - it) < value_len)
+PacketMessage PacketMessage::deserialize(const u8*& it, const u8* end, DeserializationContext& ctx) {
+	AmfPacketIndex::Framing framing;
+	if (!AmfPacketIndex::readFraming(it, end, false, framing))
 		throw std::out_of_range("Not enough bytes for PacketMessage");
 
-	if (*it++ != AVMPLUS_OBJECT)
-		throw std::invalid_argument("PacketMessage: Invalid type marker");
-
-	PacketMessage message(target, response, AmfNull());
-	message.value = Deserializer::deserialize(it, end, ctx);
-
+	PacketMessage message(framing.name.str(), framing.response.str(), AmfNull());
+	message.value = deserialize_value(it, end, framing.valueLength, ctx);
 	return message;
 }
 
 bool AmfPacket::operator==(const AmfItem& other) const {
-	const AmfPacket* p = dynamic_cast<const AmfPacket*>(&other);
+	const AmfPacket* p = item_cast<AmfPacket>(&other);
 	return p != nullptr && headers == p->headers && messages == p->messages;
 }
 
-v8 AmfPacket::serialize(SerializationContext& ctx) const {
+void AmfPacket::serialize(v8& buf, SerializationContext& ctx) const {
 	if (headers.size() >= 65536)
 		throw std::length_error("AmfPacket::serialize too many headers");
 
 	if (messages.size() >= 65536)
 		throw std::length_error("AmfPacket::serialize too many messages");
 
-	v8 buf = {
-		0x00, 0x03 // Version is always AMF3
-	};
+	// Version is always AMF3
+	buf.push_back(0x00);
+	buf.push_back(0x03);
 
-	v8 header_count = network_bytes<uint16_t>(headers.size());
-	buf.insert(buf.end(), header_count.begin(), header_count.end());
-	for (const PacketHeader& header : headers) {
-		const v8& val = header.serialize(ctx);
-		buf.insert(buf.end(), val.begin(), val.end());
-	}
+	write_network<uint16_t>(buf, headers.size());
+	for (const PacketHeader& header : headers)
+		header.serialize(buf, ctx);
 
-	v8 message_count = network_bytes<uint16_t>(messages.size());
-	buf.insert(buf.end(), message_count.begin(), message_count.end());
-	for (const PacketMessage& message : messages) {
-		const v8& val = message.serialize(ctx);
-		buf.insert(buf.end(), val.begin(), val.end());
-	}
+	write_network<uint16_t>(buf, messages.size());
+	for (const PacketMessage& message : messages)
+		message.serialize(buf, ctx);
+}
+
+size_t AmfPacket::serializedSize(SerializationContext& ctx) const {
+	// version, header count and message count
+	size_t size = 2 + 2 + 2;
 
-	return buf;
+	for (const PacketHeader& header : headers)
+		size += header.serializedSize(ctx);
+
+	for (const PacketMessage& message : messages)
+		size += message.serializedSize(ctx);
+
+	return size;
 }
 
-AmfPacket AmfPacket::deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+AmfPacket AmfPacket::deserialize(const u8*& it, const u8* end, DeserializationContext& ctx) {
 	// 2 bytes required for version, header count and message count each.
 	if (end - it < 2 + 2 + 2)
 		throw std::out_of_range("Not enough bytes for AmfPacket");
 
-	if (*it++ != 0x00 || *it++ != 0x03)
-		throw std::invalid_argument("AmfPacket: Invalid type marker");
+	AmfPacketIndex::readVersion(it, end);
 
 	AmfPacket p;
 
@@ -193,5 +167,57 @@ AmfPacket AmfPacket::deserialize(v8::const_iterator& it, v8::const_iterator end,
 	return p;
 }
 
+void AmfPacket::serializeParallel(v8& buf, const SerializationContext& ctx, AmfThreadPool& pool) const {
+	if (headers.size() >= 65536)
+		throw std::length_error("AmfPacket::serialize too many headers");
+
+	if (messages.size() >= 65536)
+		throw std::length_error("AmfPacket::serialize too many messages");
+
+	std::vector<v8> parts(headers.size() + messages.size());
+	pool.run(parts.size(), [&](size_t i) {
+		SerializationContext entryCtx(ctx);
+		if (i < headers.size())
+			headers[i].serialize(parts[i], entryCtx);
+		else
+			messages[i - headers.size()].serialize(parts[i], entryCtx);
+	});
+
+	buf.push_back(0x00);
+	buf.push_back(0x03);
+
+	write_network<uint16_t>(buf, headers.size());
+	for (size_t i = 0; i < headers.size(); ++i)
+		buf.insert(buf.end(), parts[i].begin(), parts[i].end());
+
+	write_network<uint16_t>(buf, messages.size());
+	for (size_t i = headers.size(); i < parts.size(); ++i)
+		buf.insert(buf.end(), parts[i].begin(), parts[i].end());
+}
+
+AmfPacket AmfPacket::deserializeParallel(const u8*& it, const u8* end,
+	const DeserializationContext& ctx, AmfThreadPool& pool) {
+	if (ctx.getArena() != nullptr)
+		throw std::invalid_argument("AmfPacket: Arenas can't be used by several threads");
+
+	// Find the range of every header and message first.
+	AmfPacketIndex index(it, end - it);
+	size_t headers = index.headers().size();
+
+	AmfPacket p;
+	p.headers.assign(headers, PacketHeader("", false, AmfNull()));
+	p.messages.assign(index.messages().size(), PacketMessage("", "", AmfNull()));
+
+	pool.run(headers + p.messages.size(), [&](size_t i) {
+		DeserializationContext entryCtx(ctx.stringStorageMode());
+		if (i < headers)
+			p.headers[i] = index.decodeHeader(i, entryCtx);
+		else
+			p.messages[i - headers] = index.decodeMessage(i - headers, entryCtx);
+	});
+
+	it += index.size();
+	return p;
+}
 
 } // namespace amf
@@ -9,6 +9,7 @@
 
 namespace amf {
 
+class AmfThreadPool;
 class SerializationContext;
 class DeserializationContext;
 
@@ -16,15 +17,23 @@ enum Amf0Marker : u8 {
 	AVMPLUS_OBJECT = 0x11
 };
 
+// The value of every header and message is serialized with its own reference
+// tables, i.e. the context passed to serialize and deserialize is cleared
+// before each value.
 class PacketHeader : public AmfItem {
 public:
 	template<typename T>
 	PacketHeader(std::string name, bool mustUnderstand, const T& value) :
-		name(name), mustUnderstand(mustUnderstand), value(new T(value)) { }
+		AmfItem(AMF_ITEM_PACKET_HEADER), name(name), mustUnderstand(mustUnderstand), value(new T(value)) { }
 
 	bool operator==(const AmfItem& other) const;
-	v8 serialize(SerializationContext& ctx) const;
-	static PacketHeader deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx);
+	using AmfItem::serialize;
+	void serialize(v8& buf, SerializationContext& ctx) const;
+	size_t serializedSize(SerializationContext& ctx) const;
+	static PacketHeader deserialize(const u8*& it, const u8* end, DeserializationContext& ctx);
+	static PacketHeader deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+		return with_pointers(deserialize, it, end, ctx);
+	}
 
 	template<typename T>
 	T& getValue() {
@@ -42,11 +51,16 @@ class PacketMessage : public AmfItem {
 public:
 	template<typename T>
 	PacketMessage(std::string targetUri, std::string responseUri, const T& value) :
-		target(targetUri), response(responseUri), value(new T(value)) { }
+		AmfItem(AMF_ITEM_PACKET_MESSAGE), target(targetUri), response(responseUri), value(new T(value)) { }
 
 	bool operator==(const AmfItem& other) const;
-	v8 serialize(SerializationContext& ctx) const;
-	static PacketMessage deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx);
+	using AmfItem::serialize;
+	void serialize(v8& buf, SerializationContext& ctx) const;
+	size_t serializedSize(SerializationContext& ctx) const;
+	static PacketMessage deserialize(const u8*& it, const u8* end, DeserializationContext& ctx);
+	static PacketMessage deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+		return with_pointers(deserialize, it, end, ctx);
+	}
 
 	template<typename T>
 	T& getValue() {
@@ -62,16 +76,42 @@ private:
 
 class AmfPacket : public AmfItem {
 public:
-	AmfPacket() { }
+	AmfPacket() : AmfItem(AMF_ITEM_PACKET) { }
 
 	bool operator==(const AmfItem& other) const;
-	v8 serialize(SerializationContext& ctx) const;
-	static AmfPacket deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx);
+	using AmfItem::serialize;
+	void serialize(v8& buf, SerializationContext& ctx) const;
+	size_t serializedSize(SerializationContext& ctx) const;
+	static AmfPacket deserialize(const u8*& it, const u8* end, DeserializationContext& ctx);
+	static AmfPacket deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+		return with_pointers(deserialize, it, end, ctx);
+	}
+
+	// Like serialize, but encodes the headers and messages in parallel on
+	// pool, each with a copy of ctx.
+	void serializeParallel(v8& buf, const SerializationContext& ctx, AmfThreadPool& pool) const;
+
+	// Like deserialize, but decodes the headers and messages in parallel on
+	// pool, each with a new context using the string storage mode of ctx.
+	// Only the framing of the packet is read serially, with an
+	// AmfPacketIndex. Throws std::invalid_argument if ctx has an arena, as
+	// arenas can't be shared between threads.
+	static AmfPacket deserializeParallel(const u8*& it, const u8* end,
+		const DeserializationContext& ctx, AmfThreadPool& pool);
 
 	std::vector<PacketHeader> headers;
 	std::vector<PacketMessage> messages;
 };
 
+template<>
+struct AmfItemTypeTag<PacketHeader> : AmfTaggedType<AMF_ITEM_PACKET_HEADER> { };
+
+template<>
+struct AmfItemTypeTag<PacketMessage> : AmfTaggedType<AMF_ITEM_PACKET_MESSAGE> { };
+
+template<>
+struct AmfItemTypeTag<AmfPacket> : AmfTaggedType<AMF_ITEM_PACKET> { };
+
 }
 
 #endif
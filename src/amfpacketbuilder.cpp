@@ -0,0 +1,92 @@
+#include "amfpacketbuilder.hpp"
+
+#include "amfpacket.hpp"
+
+namespace amf {
+
+AmfPacketBuilder::AmfPacketBuilder(size_t maxSize, SerializationContext ctx) :
+	maxSize(maxSize), ctx(ctx), messages(0) {
+	write_network<uint16_t>(headers, 0);
+
+	// version, header count and message count
+	if (maxSize < 2 + 2 + 2)
+		throw std::length_error("AmfPacketBuilder: Maximum size too small");
+}
+
+void AmfPacketBuilder::addHeader(const PacketHeader& header) {
+	if (!current.empty() || !completed.empty())
+		throw std::invalid_argument("AmfPacketBuilder: Headers have to be added first");
+
+	size_t count = ((headers[0] << 8) | headers[1]) + 1;
+	if (count == 65536)
+		throw std::length_error("AmfPacketBuilder: Too many headers");
+
+	size_t start = headers.size();
+	header.serialize(headers, ctx);
+	if (2 + headers.size() + 2 > maxSize) {
+		headers.resize(start);
+		throw std::length_error("AmfPacketBuilder: Headers exceed maximum size");
+	}
+
+	patch_network<uint16_t>(headers, 0, count);
+}
+
+void AmfPacketBuilder::addMessage(const PacketMessage& message) {
+	if (messages == 65535)
+		endPacket();
+
+	if (current.empty())
+		beginPacket();
+
+	size_t start = current.size();
+	message.serialize(current, ctx);
+
+	if (current.size() > maxSize) {
+		if (messages == 0) {
+			current.clear();
+			throw std::length_error("AmfPacketBuilder: Message exceeds maximum size");
+		}
+
+		// move the message into the next packet, unless it doesn't fit there
+		// either
+		size_t length = current.size() - start;
+		if (2 + headers.size() + 2 + length > maxSize) {
+			current.resize(start);
+			throw std::length_error("AmfPacketBuilder: Message exceeds maximum size");
+		}
+
+		v8 overflow(current.begin() + start, current.end());
+		current.resize(start);
+		endPacket();
+
+		beginPacket();
+		current.insert(current.end(), overflow.begin(), overflow.end());
+	}
+
+	++messages;
+}
+
+void AmfPacketBuilder::flush() {
+	if (messages != 0)
+		endPacket();
+}
+
+void AmfPacketBuilder::beginPacket() {
+	// Version is always AMF3
+	current.push_back(0x00);
+	current.push_back(0x03);
+	current.insert(current.end(), headers.begin(), headers.end());
+
+	// the message count is patched in by endPacket
+	write_network<uint16_t>(current, 0);
+	messages = 0;
+}
+
+void AmfPacketBuilder::endPacket() {
+	patch_network<uint16_t>(current, 2 + headers.size(), messages);
+	completed.push_back(std::move(current));
+	current.clear();
+	messages = 0;
+}
+
+} // namespace amf
@@ -0,0 +1,58 @@
+#pragma once
+#ifndef AMFPACKETBUILDER_HPP
+#define AMFPACKETBUILDER_HPP
+
+#include <vector>
+
+#include "amf.hpp"
+#include "serializationcontext.hpp"
+
+namespace amf {
+
+class PacketHeader;
+class PacketMessage;
+
+// Serializes messages into packets of at most maxSize bytes, starting a new
+// packet whenever the next message doesn't fit into the current one. All
+// packets carry the same headers.
+//
+// As every value has its own reference tables, a message is encoded the same
+// in any packet. A message that overflows the current packet is therefore
+// moved into the next one as is, instead of being serialized again.
+class AmfPacketBuilder {
+public:
+	AmfPacketBuilder(size_t maxSize, SerializationContext ctx = SerializationContext());
+
+	// Adds a header to all packets. Headers have to be added before the
+	// first message, otherwise std::invalid_argument is thrown. Throws
+	// std::length_error if the headers alone exceed maxSize.
+	void addHeader(const PacketHeader& header);
+
+	// Throws std::length_error (and leaves the builder unchanged) if the
+	// message doesn't even fit into an empty packet.
+	void addMessage(const PacketMessage& message);
+
+	// Completes the current packet, if it contains any messages.
+	void flush();
+
+	// The completed packets in order. They may be taken out of the builder,
+	// e.g. with swap, while adding further messages.
+	std::vector<v8>& packets() { return completed; }
+
+private:
+	void beginPacket();
+	void endPacket();
+
+	size_t maxSize;
+	SerializationContext ctx;
+	// The serialized headers, preceded by their count.
+	v8 headers;
+	// The current packet and the number of messages in it.
+	v8 current;
+	size_t messages;
+	std::vector<v8> completed;
+};
+
+} // namespace amf
+
+#endif
@@ -0,0 +1,114 @@
+#include "amfpacketforwarder.hpp"
+
+#include "amfpacketindex.hpp"
+
+namespace amf {
+
+AmfPacketForwarder::AmfPacketForwarder(const u8* data, size_t size) {
+	AmfPacketIndex index(data, size);
+
+	headers.reserve(index.headers().size());
+	for (const AmfPacketIndex::Entry& entry : index.headers()) {
+		Header header = { entry.name, entry.mustUnderstand,
+			data + entry.valueOffset, entry.valueLength };
+		headers.push_back(header);
+	}
+
+	messages.reserve(index.messages().size());
+	for (const AmfPacketIndex::Entry& entry : index.messages()) {
+		Message message = { entry.name, entry.response,
+			data + entry.valueOffset, entry.valueLength };
+		messages.push_back(message);
+	}
+}
+
+static void write_string(v8& buf, const std::string& value) {
+	if (value.size() >= 65536)
+		throw std::length_error("AmfPacketForwarder: String too long");
+
+	write_network<uint16_t>(buf, value.size());
+	buf.insert(buf.end(), value.begin(), value.end());
+}
+
+// Writes the value length and the AVMPLUS_OBJECT marker, which counts
+// towards the length.
+static void write_value_prefix(v8& buf, size_t length) {
+	if (length >= 0xFFFFFFFE)
+		throw std::length_error("AmfPacketForwarder: Value too long");
+
+	write_network<uint32_t>(buf, length + 1);
+	buf.push_back(AVMPLUS_OBJECT);
+}
+
+std::vector<AmfPacketForwarder::Segment> AmfPacketForwarder::segments() {
+	if (headers.size() >= 65536)
+		throw std::length_error("AmfPacketForwarder: Too many headers");
+
+	if (messages.size() >= 65536)
+		throw std::length_error("AmfPacketForwarder: Too many messages");
+
+	// Encode the framing first, as the envelope may be reallocated, and
+	// remember where the values go.
+	envelope.clear();
+	std::vector<size_t> splits;
+	splits.reserve(headers.size() + messages.size());
+
+	envelope.push_back(0x00);
+	envelope.push_back(0x03);
+
+	write_network<uint16_t>(envelope, headers.size());
+	for (const Header& header : headers) {
+		write_string(envelope, header.name);
+		envelope.push_back(header.mustUnderstand ? 0x01 : 0x00);
+		write_value_prefix(envelope, header.valueLength);
+		splits.push_back(envelope.size());
+	}
+
+	write_network<uint16_t>(envelope, messages.size());
+	for (const Message& message : messages) {
+		write_string(envelope, message.target);
+		write_string(envelope, message.response);
+		write_value_prefix(envelope, message.valueLength);
+		splits.push_back(envelope.size());
+	}
+
+	std::vector<Segment> result;
+	result.reserve(splits.size() * 2 + 1);
+
+	size_t start = 0;
+	for (size_t i = 0; i < splits.size(); ++i) {
+		Segment framing = { envelope.data() + start, splits[i] - start };
+		result.push_back(framing);
+
+		Segment value;
+		if (i < headers.size())
+			value = { headers[i].value, headers[i].valueLength };
+		else
+			value = { messages[i - headers.size()].value, messages[i - headers.size()].valueLength };
+		result.push_back(value);
+
+		start = splits[i];
+	}
+
+	// the message count, unless the last message ends the packet
+	if (start < envelope.size()) {
+		Segment framing = { envelope.data() + start, envelope.size() - start };
+		result.push_back(framing);
+	}
+
+	return result;
+}
+
+void AmfPacketForwarder::write(v8& buf) {
+	std::vector<Segment> parts = segments();
+
+	size_t size = buf.size();
+	for (const Segment& segment : parts)
+		size += segment.size;
+	buf.reserve(size);
+
+	for (const Segment& segment : parts)
+		buf.insert(buf.end(), segment.data, segment.data + segment.size);
+}
+
+} // namespace amf
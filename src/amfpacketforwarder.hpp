@@ -0,0 +1,69 @@
+#pragma once
+#ifndef AMFPACKETFORWARDER_HPP
+#define AMFPACKETFORWARDER_HPP
+
+#include <string>
+#include <vector>
+
+#include "amf.hpp"
+
+namespace amf {
+
+// Rewrites the framing of a serialized AmfPacket, e.g. the message target
+// URIs in a gateway, and forwards the header and message values unchanged,
+// without decoding and encoding them again.
+//
+// The headers and messages can be modified, removed or reordered before the
+// packet is written. Their values keep pointing into the input data, which is
+// not copied and must outlive the forwarder. Values of unknown length are
+// measured with an AmfScanner and written with their actual length.
+class AmfPacketForwarder {
+public:
+	struct Header {
+		std::string name;
+		bool mustUnderstand;
+		// The AMF3 value, excluding the AVMPLUS_OBJECT marker.
+		const u8* value;
+		size_t valueLength;
+	};
+
+	struct Message {
+		std::string target;
+		std::string response;
+		const u8* value;
+		size_t valueLength;
+	};
+
+	// A range of bytes of the output, which can be passed to writev as an
+	// iovec.
+	struct Segment {
+		const u8* data;
+		size_t size;
+	};
+
+	// Throws std::out_of_range or std::invalid_argument if data doesn't start
+	// with a complete and valid packet, see AmfPacketIndex.
+	AmfPacketForwarder(const u8* data, size_t size);
+	AmfPacketForwarder(const v8& data) : AmfPacketForwarder(data.data(), data.size()) { }
+	AmfPacketForwarder(v8&& data) = delete;
+
+	// The packet as a sequence of segments, alternating between the framing,
+	// which is encoded into a buffer of the forwarder, and the values. The
+	// segments are valid until the next call to segments or write. Throws
+	// std::length_error if there are too many headers or messages, or a name
+	// or URI is too long.
+	std::vector<Segment> segments();
+
+	// Appends the packet to buf.
+	void write(v8& buf);
+
+	std::vector<Header> headers;
+	std::vector<Message> messages;
+
+private:
+	v8 envelope;
+};
+
+} // namespace amf
+
+#endif
@@ -0,0 +1,157 @@
+#include "amfpacketindex.hpp"
+
+#include "amfscanner.hpp"
+#include "deserializationcontext.hpp"
+#include "deserializer.hpp"
+
+namespace amf {
+
+// Reads a U16 in network order. Returns false if the input ends first.
+static bool read_u16(const u8*& it, const u8* end, uint16_t& value) {
+	if (end - it < 2)
+		return false;
+
+	value = read_network<uint16_t>(it, end);
+	return true;
+}
+
+// Reads an AMF0 UTF-8 string, i.e. U16 length (in network order) U8* value.
+// Returns false if the input ends first.
+static bool read_string(const u8*& it, const u8* end, AmfStringView& value) {
+	uint16_t len;
+	if (!read_u16(it, end, len) || end - it < len)
+		return false;
+
+	value = AmfStringView(reinterpret_cast<const char*>(it), len);
+	it += len;
+	return true;
+}
+
+bool AmfPacketIndex::readVersion(const u8*& it, const u8* end) {
+	if (end - it < 2)
+		return false;
+
+	if (it[0] != 0x00 || it[1] != 0x03)
+		throw std::invalid_argument("AmfPacket: Invalid type marker");
+
+	it += 2;
+	return true;
+}
+
+bool AmfPacketIndex::readFraming(const u8*& it, const u8* end, bool isHeader, Framing& framing) {
+	const u8* p = it;
+	if (!read_string(p, end, framing.name))
+		return false;
+
+	framing.mustUnderstand = false;
+	framing.response = AmfStringView();
+	if (isHeader) {
+		if (p == end)
+			return false;
+
+		framing.mustUnderstand = (*p++ == 0x01);
+	} else if (!read_string(p, end, framing.response)) {
+		return false;
+	}
+
+	if (end - p < 4)
+		return false;
+
+	// The value length includes the AVMPLUS_OBJECT marker, or is (U32)-1 if
+	// unknown.
+	uint32_t value_len = read_network<uint32_t>(p, end);
+	// A length of 0 leaves no room for the marker, so the value can never be
+	// complete.
+	if (value_len == 0)
+		throw std::out_of_range("AmfPacket: Invalid value length");
+
+	if (value_len == 0xFFFFFFFF) {
+		framing.valueLength = unknownLength;
+		value_len = 1;
+	} else {
+		framing.valueLength = value_len - 1;
+	}
+
+	if (static_cast<uint32_t>(end - p) < value_len)
+		return false;
+
+	if (*p++ != AVMPLUS_OBJECT)
+		throw std::invalid_argument("AmfPacket: Invalid type marker");
+
+	it = p;
+	return true;
+}
+
+AmfPacketIndex::AmfPacketIndex(const u8* data, size_t size) : data(data) {
+	const u8* it = data;
+	const u8* end = data + size;
+
+	// 2 bytes required for version, header count and message count each.
+	if (size < 2 + 2 + 2)
+		throw std::out_of_range("Not enough bytes for AmfPacket");
+
+	readVersion(it, end);
+
+	uint16_t headers = read_network<uint16_t>(it, end);
+	headerEntries.reserve(headers);
+	for (int h = 0; h < headers; ++h)
+		headerEntries.push_back(readEntry(it, end, true));
+
+	uint16_t messages = read_network<uint16_t>(it, end);
+	messageEntries.reserve(messages);
+	for (int m = 0; m < messages; ++m)
+		messageEntries.push_back(readEntry(it, end, false));
+
+	length = it - data;
+}
+
+AmfPacketIndex::Entry AmfPacketIndex::readEntry(const u8*& it, const u8* end, bool isHeader) const {
+	Entry entry;
+	entry.offset = it - data;
+
+	Framing framing;
+	if (!readFraming(it, end, isHeader, framing))
+		throw std::out_of_range("Not enough bytes for AmfPacket");
+
+	entry.name = framing.name.str();
+	entry.response = framing.response.str();
+	entry.mustUnderstand = framing.mustUnderstand;
+
+	const u8* value = it;
+	if (framing.valueLength != unknownLength) {
+		it += framing.valueLength;
+	} else {
+		AmfScanner scanner;
+		switch (scanner.scan(it, end)) {
+			case AmfScanner::VALID:
+				break;
+			case AmfScanner::TRUNCATED:
+				throw std::out_of_range("Not enough bytes for AmfPacket");
+			case AmfScanner::MALFORMED:
+				throw std::invalid_argument("AmfPacket: Malformed value");
+			default: {
+				// only the external deserializer knows where the value ends
+				DeserializationContext ctx;
+				Deserializer::deserialize(it, end, ctx);
+			}
+		}
+	}
+
+	entry.valueOffset = value - data;
+	entry.valueLength = it - value;
+	return entry;
+}
+
+PacketHeader AmfPacketIndex::decodeHeader(size_t index, DeserializationContext& ctx) const {
+	const Entry& entry = headerEntries.at(index);
+	const u8* it = data + entry.offset;
+	return PacketHeader::deserialize(it, data + entry.valueOffset + entry.valueLength, ctx);
+}
+
+PacketMessage AmfPacketIndex::decodeMessage(size_t index, DeserializationContext& ctx) const {
+	const Entry& entry = messageEntries.at(index);
+	const u8* it = data + entry.offset;
+	return PacketMessage::deserialize(it, data + entry.valueOffset + entry.valueLength, ctx);
+}
+
+} // namespace amf
@@ -0,0 +1,99 @@
+#pragma once
+#ifndef AMFPACKETINDEX_HPP
+#define AMFPACKETINDEX_HPP
+
+#include <string>
+#include <vector>
+
+#include "amfpacket.hpp"
+#include "utils/amfstringview.hpp"
+
+namespace amf {
+
+class DeserializationContext;
+
+// The framing of a serialized AmfPacket: the header names, must understand
+// flags, message target and response URIs and the position of every value,
+// read without decoding any of the values. This is enough to e.g. dispatch a
+// packet based on its targets; each header or message is only decoded when
+// it is asked for, with its own reference tables.
+//
+// Values of unknown length are measured with an AmfScanner (or decoded, if
+// they contain externalizable objects). The data is not copied and must
+// outlive the index.
+class AmfPacketIndex {
+public:
+	struct Entry {
+		// The header name or message target URI.
+		std::string name;
+		// The message response URI, empty for headers.
+		std::string response;
+		// Always false for messages.
+		bool mustUnderstand;
+		// The offset of the header or message from the start of the packet.
+		size_t offset;
+		// The offset and length of the AMF3 value, excluding the
+		// AVMPLUS_OBJECT marker.
+		size_t valueOffset;
+		size_t valueLength;
+	};
+
+	// Everything of a header or message but its value.
+	struct Framing {
+		// The header name or message target URI, pointing into the input.
+		AmfStringView name;
+		// The message response URI, empty for headers.
+		AmfStringView response;
+		// Always false for messages.
+		bool mustUnderstand;
+		// The length of the AMF3 value, excluding the AVMPLUS_OBJECT marker,
+		// or unknownLength if the packet doesn't give it.
+		size_t valueLength;
+	};
+
+	static const size_t unknownLength = static_cast<size_t>(-1);
+
+	// Checks the packet version at it and advances it past the version.
+	// Returns false and leaves it unchanged if there are fewer than 2 bytes.
+	// Throws std::invalid_argument if the version is not AMF3.
+	static bool readVersion(const u8*& it, const u8* end);
+
+	// Reads the framing of a header or message starting at it and advances it
+	// to its AMF3 value. Returns false and leaves it unchanged if the input
+	// ends before the value starts or, if the length of the value is known,
+	// before the value ends. Throws std::invalid_argument if the marker of
+	// the value is wrong, and std::out_of_range if its length is 0.
+	//
+	// This is the only reader of the framing, which every way of reading
+	// packets uses, so that they all treat value lengths the same.
+	static bool readFraming(const u8*& it, const u8* end, bool isHeader, Framing& framing);
+
+	// Throws std::out_of_range or std::invalid_argument if data doesn't start
+	// with a complete and valid packet. Data following the packet is ignored.
+	AmfPacketIndex(const u8* data, size_t size);
+	AmfPacketIndex(const v8& data) : AmfPacketIndex(data.data(), data.size()) { }
+	AmfPacketIndex(v8&& data) = delete;
+
+	// The number of bytes of the packet.
+	size_t size() const { return length; }
+
+	const std::vector<Entry>& headers() const { return headerEntries; }
+	const std::vector<Entry>& messages() const { return messageEntries; }
+
+	// Decodes a header or message. Throws std::out_of_range if there is no
+	// such entry.
+	PacketHeader decodeHeader(size_t index, DeserializationContext& ctx) const;
+	PacketMessage decodeMessage(size_t index, DeserializationContext& ctx) const;
+
+private:
+	Entry readEntry(const u8*& it, const u8* end, bool isHeader) const;
+
+	const u8* data;
+	size_t length;
+	std::vector<Entry> headerEntries;
+	std::vector<Entry> messageEntries;
+};
+
+} // namespace amf
+
+#endif
@@ -0,0 +1,141 @@
+#include "amfpacketwriter.hpp"
+
+#include "amfpacket.hpp"
+
+namespace amf {
+
+// Checked before anything is written, so the buffer stays intact.
+static void check_utf8(const std::string& value) {
+	if (value.size() >= 65536)
+		throw std::length_error("AmfPacketWriter: String too long");
+}
+
+// Strings in AMF packets are always serialized as AMF0 UTF-8, i.e.
+// U16 length (in network order) U8* value
+static void write_utf8(v8& buf, const std::string& value) {
+	write_network<uint16_t>(buf, value.size());
+	buf.insert(buf.end(), value.begin(), value.end());
+}
+
+void AmfPacketWriter::clear() {
+	AmfWriter::clear();
+	state = IDLE;
+}
+
+void AmfPacketWriter::beginPacket() {
+	if (state != IDLE)
+		throw std::invalid_argument("AmfPacketWriter: Unexpected packet");
+
+	// Version is always AMF3
+	buf.push_back(0x00);
+	buf.push_back(0x03);
+
+	countOffset = buf.size();
+	count = 0;
+	write_network<uint16_t>(buf, 0);
+	state = HEADERS;
+}
+
+void AmfPacketWriter::endPacket() {
+	if (state == HEADERS)
+		beginMessages();
+
+	if (state != MESSAGES)
+		throw std::invalid_argument("AmfPacketWriter: Unexpected end");
+
+	patch_network<uint16_t>(buf, countOffset, count);
+	state = IDLE;
+}
+
+// Patches the header count and starts the messages.
+void AmfPacketWriter::beginMessages() {
+	patch_network<uint16_t>(buf, countOffset, count);
+
+	countOffset = buf.size();
+	count = 0;
+	write_network<uint16_t>(buf, 0);
+	state = MESSAGES;
+}
+
+void AmfPacketWriter::beginHeader(const std::string& name, bool mustUnderstand) {
+	if (state != HEADERS)
+		throw std::invalid_argument("AmfPacketWriter: Unexpected header");
+
+	if (count == 65535)
+		throw std::length_error("AmfPacketWriter: Too many headers");
+
+	check_utf8(name);
+
+	write_utf8(buf, name);
+	buf.push_back(mustUnderstand ? 0x01 : 0x00);
+	beginEntry(HEADER);
+}
+
+void AmfPacketWriter::endHeader() {
+	endEntry(HEADER);
+}
+
+void AmfPacketWriter::beginMessage(const std::string& target, const std::string& response) {
+	if (state == HEADERS)
+		beginMessages();
+
+	if (state != MESSAGES)
+		throw std::invalid_argument("AmfPacketWriter: Unexpected message");
+
+	if (count == 65535)
+		throw std::length_error("AmfPacketWriter: Too many messages");
+
+	check_utf8(target);
+	check_utf8(response);
+
+	write_utf8(buf, target);
+	write_utf8(buf, response);
+	beginEntry(MESSAGE);
+}
+
+void AmfPacketWriter::endMessage() {
+	endEntry(MESSAGE);
+}
+
+void AmfPacketWriter::writeHeader(const std::string& name, bool mustUnderstand, const AmfItem& item) {
+	beginHeader(name, mustUnderstand);
+	writeItem(item);
+	endHeader();
+}
+
+void AmfPacketWriter::writeMessage(const std::string& target, const std::string& response, const AmfItem& item) {
+	beginMessage(target, response);
+	writeItem(item);
+	endMessage();
+}
+
+// Writes the value length placeholder and the AVMPLUS_OBJECT marker, which
+// counts towards the length.
+void AmfPacketWriter::beginEntry(State entryState) {
+	lengthOffset = buf.size();
+	write_network<uint32_t>(buf, 0);
+	buf.push_back(AVMPLUS_OBJECT);
+
+	// every AMF3 value starts with empty reference tables
+	ctx.clear();
+	value = false;
+	state = entryState;
+}
+
+void AmfPacketWriter::endEntry(State entryState) {
+	if (state != entryState || !value || !AmfWriter::complete())
+		throw std::invalid_argument("AmfPacketWriter: Unexpected end");
+
+	patch_network<uint32_t>(buf, lengthOffset, buf.size() - lengthOffset - 4);
+	++count;
+	state = entryState == HEADER ? HEADERS : MESSAGES;
+}
+
+void AmfPacketWriter::beginTopLevelValue() {
+	if ((state != HEADER && state != MESSAGE) || value)
+		throw std::invalid_argument("AmfPacketWriter: Unexpected value");
+
+	value = true;
+}
+
+} // namespace amf
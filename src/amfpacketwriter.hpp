@@ -0,0 +1,87 @@
+#pragma once
+#ifndef AMFPACKETWRITER_HPP
+#define AMFPACKETWRITER_HPP
+
+#include <string>
+
+#include "amfwriter.hpp"
+
+namespace amf {
+
+// Serializes an AmfPacket incrementally, without constructing PacketHeaders
+// and PacketMessages first:
+//
+//   writer.beginPacket();
+//   writer.beginHeader("DSId", false);
+//   writer.writeString("1234-abcd");
+//   writer.endHeader();
+//   writer.beginMessage("/1/onResult", "");
+//   writer.writeItem(result);
+//   writer.endMessage();
+//   writer.endPacket();
+//
+// The value of each header and message is written with the AmfWriter calls
+// and gets its own reference tables, like with AmfPacket::serialize. The
+// header and message counts and value lengths are written as placeholders and
+// patched once they are known, so the packet never has to exist as a whole
+// before it is written. Headers have to be written before messages.
+//
+// Calls out of order (e.g. a message without a packet, a header after a
+// message, a value outside of a header or message, or a header or message
+// without exactly one value) throw std::invalid_argument, more than 65535
+// headers or messages throw std::length_error.
+class AmfPacketWriter : public AmfWriter {
+public:
+	AmfPacketWriter() :
+		state(IDLE), countOffset(0), count(0), lengthOffset(0), value(false) { }
+	AmfPacketWriter(SerializationContext ctx) :
+		AmfWriter(ctx), state(IDLE), countOffset(0), count(0), lengthOffset(0), value(false) { }
+
+	void clear();
+
+	// Whether all packets that have been begun have been ended.
+	bool complete() const { return state == IDLE; }
+
+	void beginPacket();
+	void endPacket();
+
+	void beginHeader(const std::string& name, bool mustUnderstand);
+	void endHeader();
+
+	void beginMessage(const std::string& target, const std::string& response);
+	void endMessage();
+
+	// Writes a header or message with item as its value.
+	void writeHeader(const std::string& name, bool mustUnderstand, const AmfItem& item);
+	void writeMessage(const std::string& target, const std::string& response, const AmfItem& item);
+
+protected:
+	void beginTopLevelValue();
+
+private:
+	enum State {
+		IDLE,
+		HEADERS,
+		HEADER,
+		MESSAGES,
+		MESSAGE
+	};
+
+	void beginEntry(State entryState);
+	void endEntry(State entryState);
+	void beginMessages();
+
+	State state;
+	// The offset of the current header or message count and the number of
+	// entries written so far.
+	size_t countOffset;
+	size_t count;
+	// The offset of the value length of the current entry, and whether its
+	// value has been written.
+	size_t lengthOffset;
+	bool value;
+};
+
+} // namespace amf
+
+#endif
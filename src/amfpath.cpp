@@ -0,0 +1,92 @@
+#include "amfpath.hpp"
+
+#include <stdexcept>
+
+namespace amf {
+
+static bool is_name_char(char c) {
+	return c != '.' && c != '[' && c != ']' && c != '"' && c != '\'' &&
+		c != ' ' && c != '\t' && c != '\r' && c != '\n';
+}
+
+static std::string parse_name(const std::string& expression, size_t& pos) {
+	size_t start = pos;
+	while (pos < expression.size() && is_name_char(expression[pos]))
+		++pos;
+
+	if (pos == start)
+		throw std::invalid_argument("AmfPath: Expected member name");
+
+	return expression.substr(start, pos - start);
+}
+
+// Parses the contents of a bracket step up to and including the closing
+// bracket.
+static AmfPath::Step parse_bracket(const std::string& expression, size_t& pos) {
+	AmfPath::Step step = { false, "", 0 };
+
+	if (pos == expression.size())
+		throw std::invalid_argument("AmfPath: Unterminated bracket");
+
+	char quote = expression[pos];
+	if (quote == '"' || quote == '\'') {
+		++pos;
+		while (pos < expression.size() && expression[pos] != quote) {
+			if (expression[pos] == '\\')
+				++pos;
+			if (pos == expression.size())
+				break;
+
+			step.key.push_back(expression[pos++]);
+		}
+
+		if (pos == expression.size())
+			throw std::invalid_argument("AmfPath: Unterminated key");
+		++pos;
+	} else {
+		size_t start = pos;
+		while (pos < expression.size() && expression[pos] >= '0' && expression[pos] <= '9') {
+			size_t digit = expression[pos++] - '0';
+			if (step.index > (static_cast<size_t>(-1) - digit) / 10)
+				throw std::invalid_argument("AmfPath: Index out of range");
+
+			step.index = step.index * 10 + digit;
+		}
+
+		if (pos == start)
+			throw std::invalid_argument("AmfPath: Expected index or quoted key");
+		step.byIndex = true;
+	}
+
+	if (pos == expression.size() || expression[pos] != ']')
+		throw std::invalid_argument("AmfPath: Unterminated bracket");
+	++pos;
+
+	return step;
+}
+
+AmfPath::AmfPath(const std::string& expression) {
+	size_t pos = 0;
+
+	if (!expression.empty() && expression[0] != '[') {
+		Step step = { false, parse_name(expression, pos), 0 };
+		path.push_back(step);
+	}
+
+	while (pos < expression.size()) {
+		char c = expression[pos++];
+		if (c == '.') {
+			Step step = { false, parse_name(expression, pos), 0 };
+			path.push_back(step);
+		} else if (c == '[') {
+			path.push_back(parse_bracket(expression, pos));
+		} else {
+			throw std::invalid_argument("AmfPath: Unexpected character");
+		}
+	}
+
+	if (path.empty())
+		throw std::invalid_argument("AmfPath: Empty path");
+}
+
+} // namespace amf
@@ -0,0 +1,41 @@
+#pragma once
+#ifndef AMFPATH_HPP
+#define AMFPATH_HPP
+
+#include <string>
+#include <vector>
+
+namespace amf {
+
+// A compiled path expression selecting a value nested in another one, e.g.
+// `body[0].user.id` or `headers["DSId"]`. Paths are evaluated on serialized
+// data with AmfLazyValue::find and LazyPacket::find.
+//
+// A path is a sequence of steps:
+// - `name` (only at the start) or `.name` selects a member of an object, an
+//   associative value of an array or the value of a string dictionary key.
+//   Names may not contain whitespace, quotes, dots or brackets.
+// - `["key"]` (or `['key']`) does the same for arbitrary names. Quotes and
+//   backslashes in the key are escaped with a backslash.
+// - `[n]` selects a dense value of an array, a value of an object vector or
+//   the value of an integer dictionary key.
+class AmfPath {
+public:
+	struct Step {
+		bool byIndex;
+		std::string key;
+		size_t index;
+	};
+
+	// Throws std::invalid_argument if expression isn't a valid path.
+	AmfPath(const std::string& expression);
+
+	const std::vector<Step>& steps() const { return path; }
+
+private:
+	std::vector<Step> path;
+};
+
+} // namespace amf
+
+#endif
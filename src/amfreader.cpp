@@ -0,0 +1,236 @@
+#include "amfreader.hpp"
+
+#include "deserializer.hpp"
+#include "types/amfinteger.hpp"
+#include "types/amfitem.hpp"
+#include "types/amfobject.hpp"
+#include "types/amfstring.hpp"
+
+namespace amf {
+
+void AmfHandler::externalObject(const AmfObjectTraits& traits,
+	const u8*& it, const u8* end, DeserializationContext& ctx) {
+	Deserializer::externalDeserializers.at(traits.className)(it, end, ctx);
+}
+
+// Reads the U29 value type of a complex value. Reports references and
+// returns true for them, otherwise the value gets a slot in the object table,
+// which stays empty as no item is built.
+bool AmfReader::readReference(const u8*& it, const u8* end, AmfHandler& handler, int& type) {
+	type = AmfInteger::deserializeValue(it, end);
+	if ((type & 0x01) == 0) {
+		size_t index = type >> 1;
+		if (index >= ctx.objectsCount())
+			throw std::out_of_range("AmfReader: Invalid object reference");
+
+		handler.objectReference(index);
+		return true;
+	}
+
+	ctx.addPointer(AmfItemPtr());
+	return false;
+}
+
+size_t AmfReader::readCount(int type) {
+	int count = type >> 1;
+	if (count < 0)
+		throw std::invalid_argument("AmfReader: Invalid length");
+
+	return count;
+}
+
+template<typename T>
+AmfVectorRun<T> AmfReader::readVector(const u8*& it, const u8* end, int type, bool& fixed) {
+	size_t count = readCount(type);
+
+	if (it == end)
+		throw std::out_of_range("Not enough bytes for AmfVector");
+
+	fixed = (*it++ == 0x01);
+
+	if (static_cast<size_t>(end - it) < count * sizeof(T))
+		throw std::out_of_range("Not enough bytes for AmfVector");
+
+	AmfVectorRun<T> run(it, count);
+	it += count * sizeof(T);
+	return run;
+}
+
+void AmfReader::read(const u8*& it, const u8* end, AmfHandler& handler) {
+	if (it == end)
+		throw std::out_of_range("AmfReader::read end of input");
+
+	u8 marker = *it++;
+	int type;
+	switch (marker) {
+		case AMF_UNDEFINED:
+			handler.undefinedValue();
+			break;
+		case AMF_NULL:
+			handler.nullValue();
+			break;
+		case AMF_FALSE:
+		case AMF_TRUE:
+			handler.boolValue(marker == AMF_TRUE);
+			break;
+		case AMF_INTEGER:
+			handler.integerValue(AmfInteger::deserializeValue(it, end));
+			break;
+		case AMF_DOUBLE:
+			handler.doubleValue(read_network<double>(it, end));
+			break;
+		case AMF_STRING:
+			handler.stringValue(AmfString::deserializeView(it, end, ctx));
+			break;
+		case AMF_XMLDOC:
+		case AMF_XML: {
+			if (readReference(it, end, handler, type)) break;
+
+			size_t length = readCount(type);
+			if (static_cast<size_t>(end - it) < length)
+				throw std::out_of_range("Not enough bytes for AmfXml");
+
+			handler.xmlValue(AmfStringView(reinterpret_cast<const char*>(it), length),
+				marker == AMF_XMLDOC);
+			it += length;
+			break;
+		}
+		case AMF_DATE:
+			if (readReference(it, end, handler, type)) break;
+
+			handler.dateValue(static_cast<long long>(read_network<double>(it, end)));
+			break;
+		case AMF_ARRAY: {
+			if (readReference(it, end, handler, type)) break;
+
+			size_t length = readCount(type);
+			handler.beginArray(length);
+
+			// associative until UTF-8-empty
+			while (true) {
+				AmfStringView name = AmfString::deserializeView(it, end, ctx);
+				if (name.empty()) break;
+
+				handler.associativeKey(name);
+				read(it, end, handler);
+			}
+
+			// dense
+			for (size_t i = 0; i < length; ++i)
+				read(it, end, handler);
+
+			handler.endArray();
+			break;
+		}
+		case AMF_OBJECT:
+			readObject(it, end, handler);
+			break;
+		case AMF_BYTEARRAY: {
+			if (readReference(it, end, handler, type)) break;
+
+			size_t length = readCount(type);
+			if (static_cast<size_t>(end - it) < length)
+				throw std::out_of_range("Not enough bytes for AmfByteArray");
+
+			handler.byteArrayValue(it, length);
+			it += length;
+			break;
+		}
+		case AMF_VECTOR_INT: {
+			if (readReference(it, end, handler, type)) break;
+
+			bool fixed;
+			AmfVectorRun<int> run = readVector<int>(it, end, type, fixed);
+			handler.intVector(run, fixed);
+			break;
+		}
+		case AMF_VECTOR_UINT: {
+			if (readReference(it, end, handler, type)) break;
+
+			bool fixed;
+			AmfVectorRun<unsigned int> run = readVector<unsigned int>(it, end, type, fixed);
+			handler.uintVector(run, fixed);
+			break;
+		}
+		case AMF_VECTOR_DOUBLE: {
+			if (readReference(it, end, handler, type)) break;
+
+			bool fixed;
+			AmfVectorRun<double> run = readVector<double>(it, end, type, fixed);
+			handler.doubleVector(run, fixed);
+			break;
+		}
+		case AMF_VECTOR_OBJECT: {
+			if (readReference(it, end, handler, type)) break;
+
+			size_t count = readCount(type);
+			if (it == end)
+				throw std::out_of_range("Not enough bytes for AmfVector");
+
+			bool fixed = (*it++ == 0x01);
+			handler.beginObjectVector(AmfString::deserializeView(it, end, ctx), count, fixed);
+
+			for (size_t i = 0; i < count; ++i)
+				read(it, end, handler);
+
+			handler.endObjectVector();
+			break;
+		}
+		case AMF_DICTIONARY: {
+			if (readReference(it, end, handler, type)) break;
+
+			size_t count = readCount(type);
+			if (it == end)
+				throw std::out_of_range("Not enough bytes for AmfDictionary");
+
+			bool weak = (*it++ == 0x01);
+			handler.beginDictionary(count, weak);
+
+			for (size_t i = 0; i < count; ++i) {
+				read(it, end, handler);
+				read(it, end, handler);
+			}
+
+			handler.endDictionary();
+			break;
+		}
+		default:
+			throw std::invalid_argument("AmfReader::read: Invalid type byte");
+	}
+}
+
+void AmfReader::readObject(const u8*& it, const u8* end, AmfHandler& handler) {
+	int type;
+	if (readReference(it, end, handler, type)) return;
+
+	// Nested objects may add traits, which invalidates references into the
+	// traits table, so the traits are looked up by index every time.
+	size_t traits = AmfObject::deserializeTraits(type, it, end, ctx);
+
+	if (ctx.getTraits(traits).externalizable) {
+		handler.externalObject(ctx.getTraits(traits), it, end, ctx);
+		return;
+	}
+
+	handler.beginObject(ctx.getTraits(traits));
+
+	size_t sealed = ctx.getTraits(traits).getAttriutes().size();
+	for (size_t i = 0; i < sealed; ++i) {
+		handler.propertyName(AmfStringView(ctx.getTraits(traits).getAttriutes()[i]));
+		read(it, end, handler);
+	}
+
+	if (ctx.getTraits(traits).dynamic) {
+		while (true) {
+			AmfStringView name = AmfString::deserializeView(it, end, ctx);
+			if (name.empty()) break;
+
+			handler.propertyName(name);
+			read(it, end, handler);
+		}
+	}
+
+	handler.endObject();
+}
+
+} // namespace amf
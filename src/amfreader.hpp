@@ -0,0 +1,139 @@
+#pragma once
+#ifndef AMFREADER_HPP
+#define AMFREADER_HPP
+
+#include "amf.hpp"
+#include "deserializationcontext.hpp"
+#include "utils/amfobjecttraits.hpp"
+#include "utils/amfstringview.hpp"
+
+namespace amf {
+
+// The values of an int, uint or double vector, decoded from the input on
+// access.
+template<typename T>
+class AmfVectorRun {
+public:
+	AmfVectorRun(const u8* data, size_t count) : data(data), count(count) { }
+
+	size_t size() const { return count; }
+
+	T operator[](size_t index) const {
+		T val;
+		const u8* p = data + index * sizeof(T);
+		std::copy(p, p + sizeof(T), reinterpret_cast<u8 *>(&val));
+		return ntoh(val);
+	}
+
+private:
+	const u8* data;
+	size_t count;
+};
+
+// Receives the events reported by AmfReader. All methods do nothing by
+// default, so handlers only need to override the events they are interested
+// in.
+//
+// Views and pointers passed to the handler point into the input or the
+// DeserializationContext and must not be kept after the call if either of
+// them may go away.
+class AmfHandler {
+public:
+	virtual ~AmfHandler() { }
+
+	virtual void undefinedValue() { }
+	virtual void nullValue() { }
+	virtual void boolValue(bool) { }
+	virtual void integerValue(int) { }
+	virtual void doubleValue(double) { }
+	virtual void stringValue(AmfStringView) { }
+	virtual void xmlValue(AmfStringView, bool /* document */) { }
+	virtual void dateValue(long long) { }
+	virtual void byteArrayValue(const u8*, size_t) { }
+
+	// A reference to a previously read date, XML value, byte array, vector,
+	// array, object or dictionary. They are numbered in the order they were
+	// reported in, starting at 0. Nested values are numbered after their
+	// parent.
+	virtual void objectReference(size_t) { }
+
+	// An array is reported as beginArray, the key and value of each
+	// associative member, denseCount values and endArray.
+	virtual void beginArray(size_t /* denseCount */) { }
+	virtual void associativeKey(AmfStringView) { }
+	virtual void endArray() { }
+
+	// An object is reported as beginObject, the name and value of each sealed
+	// and dynamic property and endObject.
+	virtual void beginObject(const AmfObjectTraits&) { }
+	virtual void propertyName(AmfStringView) { }
+	virtual void endObject() { }
+
+	// An externalizable object, whose data starts at it and must be consumed
+	// by this method. By default, it is decoded with the external deserializer
+	// registered with the Deserializer for its class name and discarded.
+	virtual void externalObject(const AmfObjectTraits& traits,
+		const u8*& it, const u8* end, DeserializationContext& ctx);
+
+	virtual void intVector(const AmfVectorRun<int>&, bool /* fixed */) { }
+	virtual void uintVector(const AmfVectorRun<unsigned int>&, bool /* fixed */) { }
+	virtual void doubleVector(const AmfVectorRun<double>&, bool /* fixed */) { }
+
+	// An object vector is reported as beginObjectVector, count values and
+	// endObjectVector.
+	virtual void beginObjectVector(AmfStringView /* type */, size_t /* count */, bool /* fixed */) { }
+	virtual void endObjectVector() { }
+
+	// A dictionary is reported as beginDictionary, count alternating keys and
+	// values and endDictionary.
+	virtual void beginDictionary(size_t /* count */, bool /* weak */) { }
+	virtual void endDictionary() { }
+};
+
+// Reads AMF3 values and reports their contents to an AmfHandler, without
+// building AmfItem objects. Strings and traits are resolved through the
+// DeserializationContext, so string and traits references are reported like
+// inline values, while references to complex values are reported as indices.
+//
+// Apart from new strings (in STRINGS_IN_CONTEXT mode) and new traits being
+// added to the context, reading allocates no memory. Complex values take up
+// an empty slot in the object table of the context, so that they are
+// numbered like the objects added by external deserializers.
+//
+// Like the Deserializer, the context is kept across calls to read until
+// clearContext is called.
+class AmfReader {
+public:
+	AmfReader(DeserializationContext ctx = DeserializationContext()) :
+		ctx(ctx) { }
+
+	// Reads a single value, advancing it past it. Throws
+	// std::invalid_argument or std::out_of_range on malformed input.
+	void read(const u8*& it, const u8* end, AmfHandler& handler);
+	void read(const u8* data, size_t size, AmfHandler& handler) {
+		read(data, data + size, handler);
+	}
+	void read(const v8& data, AmfHandler& handler) {
+		read(data.data(), data.size(), handler);
+	}
+
+	void clearContext() { ctx.clear(); }
+
+	DeserializationContext& context() { return ctx; }
+
+	// The number of values that can be referenced by objectReference.
+	size_t objectCount() const { return ctx.objectsCount(); }
+
+private:
+	bool readReference(const u8*& it, const u8* end, AmfHandler& handler, int& type);
+	size_t readCount(int type);
+	void readObject(const u8*& it, const u8* end, AmfHandler& handler);
+	template<typename T>
+	AmfVectorRun<T> readVector(const u8*& it, const u8* end, int type, bool& fixed);
+
+	DeserializationContext ctx;
+};
+
+} // namespace amf
+
+#endif
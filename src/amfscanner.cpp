@@ -0,0 +1,373 @@
+#include "amfscanner.hpp"
+
+#include "deserializationcontext.hpp"
+#include "types/amfitem.hpp"
+
+namespace amf {
+
+// Reads a sign-extended U29 like AmfInteger::deserializeValue. Returns false
+// if the input ends before the value does.
+static bool read_u29(const u8*& it, const u8* end, int& value) {
+	const u8* p = it;
+	int val = 0;
+
+	for (int i = 0; i < 3; ++i) {
+		if (p == end) return false;
+
+		u8 byte = *p++;
+		if ((byte & 0x80) == 0) {
+			val = (val << 7) | byte;
+			value = (val << 3) >> 3;
+			it = p;
+			return true;
+		}
+
+		val = (val << 7) | (byte & 0x7f);
+	}
+
+	if (p == end) return false;
+	val = (val << 8) | *p++;
+	value = (val << 3) >> 3;
+	it = p;
+	return true;
+}
+
+static AmfScanner::Status skip_bytes(const u8*& it, const u8* end, size_t count) {
+	if (static_cast<size_t>(end - it) < count)
+		return AmfScanner::TRUNCATED;
+
+	it += count;
+	return AmfScanner::VALID;
+}
+
+void AmfScanner::next() {
+	result = TRUNCATED;
+	started = false;
+	offset = 0;
+	stack.clear();
+	stringsBefore = strings;
+	traitsBefore = traits.size();
+	objectsBefore = objects.size();
+}
+
+void AmfScanner::clear() {
+	strings = 0;
+	traits.clear();
+	objects.clear();
+	next();
+}
+
+// Removes what the value being resumed added to the tables.
+void AmfScanner::discard() {
+	strings = stringsBefore;
+	traits.resize(traitsBefore);
+	objects.resize(objectsBefore);
+	started = false;
+	offset = 0;
+	stack.clear();
+}
+
+void AmfScanner::sync(DeserializationContext& ctx) {
+	if (ctx.stringsCount() < strings || ctx.traitsCount() < traits.size() ||
+	    ctx.objectsCount() < objects.size())
+		clear();
+
+	strings = ctx.stringsCount();
+
+	for (size_t i = traits.size(); i < ctx.traitsCount(); ++i) {
+		const AmfObjectTraits& known = ctx.getTraits(i);
+		Traits objectTraits = {
+			static_cast<uint32_t>(known.getAttriutes().size()),
+			known.dynamic,
+			known.externalizable
+		};
+		traits.push_back(objectTraits);
+	}
+
+	for (size_t i = objects.size(); i < ctx.objectsCount(); ++i)
+		objects.push_back(ctx.getPointer<AmfItem>(i)->typeTag());
+
+	next();
+}
+
+AmfScanner::Status AmfScanner::scan(const u8*& it, const u8* end) {
+	if (result == TRUNCATED)
+		discard();
+	next();
+
+	Status status = resume(it, end - it);
+	if (status == VALID)
+		it += offset;
+	else
+		discard();
+
+	next();
+	return status;
+}
+
+AmfScanner::Status AmfScanner::resume(const u8* data, size_t size) {
+	if (result != TRUNCATED)
+		return result;
+
+	const u8* end = data + size;
+	while (!started || !stack.empty()) {
+		const u8* it = data + offset;
+		Frame child;
+		bool nested = false;
+		Status status = VALID;
+
+		if (!started) {
+			status = scanValue(it, end, child, nested);
+			started = (status == VALID);
+		} else {
+			Frame& frame = stack.back();
+
+			if (frame.needValue || (!frame.pairsFirst && frame.values > 0)) {
+				status = scanValue(it, end, child, nested);
+				if (status == VALID) {
+					if (frame.needValue)
+						frame.needValue = false;
+					else
+						--frame.values;
+				}
+			} else if (frame.pairsFirst || frame.pairsLast) {
+				size_t added = 0;
+				bool empty;
+				status = scanString(it, end, added, empty);
+				if (status == VALID) {
+					strings += added;
+
+					if (!empty)
+						frame.needValue = true;
+					else if (frame.pairsFirst)
+						frame.pairsFirst = false;
+					else
+						frame.pairsLast = false;
+				}
+			} else {
+				stack.pop_back();
+			}
+		}
+
+		if (status == VALID && nested && stack.size() >= maxDepth)
+			status = UNSUPPORTED;
+
+		if (status == TRUNCATED)
+			return TRUNCATED;
+
+		if (status != VALID) {
+			discard();
+			return result = status;
+		}
+
+		offset = it - data;
+		if (nested)
+			stack.push_back(child);
+	}
+
+	return result = VALID;
+}
+
+// Scans a value up to its members, if it has any, which are described by
+// child. Adds the value to the tables only if it is complete (i.e. the result
+// is VALID), and leaves it unchanged otherwise.
+AmfScanner::Status AmfScanner::scanValue(const u8*& it, const u8* end, Frame& child, bool& nested) {
+	if (it == end) return TRUNCATED;
+
+	const u8* p = it;
+	u8 marker = *p++;
+	if (marker > AMF_DICTIONARY) return MALFORMED;
+
+	child.values = 0;
+	child.pairsFirst = false;
+	child.pairsLast = false;
+	child.needValue = false;
+
+	int type;
+	Status status = VALID;
+	switch (marker) {
+		case AMF_UNDEFINED:
+		case AMF_NULL:
+		case AMF_FALSE:
+		case AMF_TRUE:
+			break;
+		case AMF_INTEGER:
+			if (!read_u29(p, end, type)) return TRUNCATED;
+			break;
+		case AMF_DOUBLE:
+			status = skip_bytes(p, end, 8);
+			break;
+		case AMF_STRING: {
+			size_t added = 0;
+			bool empty;
+			status = scanString(p, end, added, empty);
+			if (status != VALID) return status;
+
+			strings += added;
+			break;
+		}
+		case AMF_OBJECT:
+			status = scanObjectHeader(p, end, child, nested);
+			break;
+		default: {
+			// All other values start with an object reference or an inline value.
+			if (!read_u29(p, end, type)) return TRUNCATED;
+
+			if ((type & 0x01) == 0) {
+				// the deserializer only accepts references to values of the same type
+				size_t index = type >> 1;
+				if (type < 0 || index >= objects.size() || objects[index] != marker)
+					return MALFORMED;
+
+				break;
+			}
+
+			if (type < 0) return MALFORMED;
+			size_t length = type >> 1;
+
+			size_t added = 0;
+			bool empty;
+			switch (marker) {
+				case AMF_XMLDOC:
+				case AMF_XML:
+				case AMF_BYTEARRAY:
+					status = skip_bytes(p, end, length);
+					break;
+				case AMF_DATE:
+					status = skip_bytes(p, end, 8);
+					break;
+				case AMF_VECTOR_INT:
+				case AMF_VECTOR_UINT:
+					// fixed-vector marker and 32 bit values
+					status = skip_bytes(p, end, 1 + length * 4);
+					break;
+				case AMF_VECTOR_DOUBLE:
+					status = skip_bytes(p, end, 1 + length * 8);
+					break;
+				case AMF_ARRAY:
+					child.values = static_cast<uint32_t>(length);
+					child.pairsFirst = true;
+					nested = true;
+					break;
+				case AMF_VECTOR_OBJECT:
+					// fixed-vector marker and object type name
+					if (p == end) return TRUNCATED;
+					++p;
+
+					status = scanString(p, end, added, empty);
+					child.values = static_cast<uint32_t>(length);
+					nested = true;
+					break;
+				default:
+					// AMF_DICTIONARY: weak keys marker and alternating keys and values
+					if (p == end) return TRUNCATED;
+					++p;
+
+					child.values = static_cast<uint32_t>(length * 2);
+					nested = true;
+					break;
+			}
+
+			if (status != VALID) return status;
+
+			// Complex values are added to the object table before their
+			// members, so that members can refer to them.
+			strings += added;
+			objects.push_back(marker);
+			break;
+		}
+	}
+
+	if (status == VALID)
+		it = p;
+
+	return status;
+}
+
+AmfScanner::Status AmfScanner::scanObjectHeader(const u8*& it, const u8* end, Frame& child, bool& nested) {
+	const u8* p = it;
+	int type;
+	if (!read_u29(p, end, type)) return TRUNCATED;
+	if (type < 0) return MALFORMED;
+
+	if ((type & 0x01) == 0) {
+		// U29O-ref
+		size_t index = type >> 1;
+		if (index >= objects.size() || objects[index] != AMF_OBJECT)
+			return MALFORMED;
+
+		it = p;
+		return VALID;
+	}
+
+	Traits objectTraits;
+	size_t added = 0;
+	if ((type & 0x03) == 0x01) {
+		// U29O-traits-ref
+		size_t index = type >> 2;
+		if (index >= traits.size()) return MALFORMED;
+
+		objectTraits = traits[index];
+		if (objectTraits.externalizable) return UNSUPPORTED;
+	} else if ((type & 0x07) == 0x07) {
+		// U29O-traits-ext
+		return UNSUPPORTED;
+	} else {
+		// U29O-traits: class name and sealed member names
+		objectTraits.dynamic = ((type & 0x08) == 0x08);
+		objectTraits.sealed = type >> 4;
+		objectTraits.externalizable = false;
+
+		bool empty;
+		for (uint32_t i = 0; i <= objectTraits.sealed; ++i) {
+			Status status = scanString(p, end, added, empty);
+			if (status != VALID) return status;
+		}
+
+		traits.push_back(objectTraits);
+	}
+
+	strings += added;
+	objects.push_back(AMF_OBJECT);
+
+	child.values = objectTraits.sealed;
+	child.pairsLast = objectTraits.dynamic;
+	nested = true;
+
+	it = p;
+	return VALID;
+}
+
+// Scans a UTF-8-vr. Counts an inline string in added instead of adding it to
+// the tables, so that the caller can add the strings of a header at once.
+AmfScanner::Status AmfScanner::scanString(const u8*& it, const u8* end, size_t& added, bool& empty) {
+	const u8* p = it;
+	int type;
+	if (!read_u29(p, end, type)) return TRUNCATED;
+	if (type < 0) return MALFORMED;
+
+	empty = false;
+	size_t length = type >> 1;
+	if ((type & 0x01) == 0) {
+		if (length >= strings + added) return MALFORMED;
+
+		it = p;
+		return VALID;
+	}
+
+	// empty strings are never sent by reference
+	if (length == 0) {
+		empty = true;
+		it = p;
+		return VALID;
+	}
+
+	Status status = skip_bytes(p, end, length);
+	if (status != VALID) return status;
+
+	++added;
+	it = p;
+	return VALID;
+}
+
+} // namespace amf
@@ -0,0 +1,129 @@
+#pragma once
+#ifndef AMFSCANNER_HPP
+#define AMFSCANNER_HPP
+
+#include <vector>
+
+#include "amf.hpp"
+
+namespace amf {
+
+class DeserializationContext;
+
+// Finds the end of a complete AMF3 value and checks that it is well-formed,
+// without decoding it. This is much cheaper than deserializing, so it can be
+// used to route, forward or reject input, or to skip values that aren't
+// needed.
+//
+// The scanner keeps its own string, traits and object reference tables, which
+// grow exactly like those of a DeserializationContext decoding the same
+// values, so references are checked (including the type of the referenced
+// object) just like the Deserializer does. It only stores the number of
+// strings, the member counts of traits and the type of each object, and
+// doesn't allocate anything apart from growing these tables and the stack of
+// open containers, which keep their capacity across clear().
+//
+// Values that arrive in several chunks can be scanned with resume, which
+// keeps its position within the value (including inside nested containers)
+// across calls, so every byte is examined only once, apart from re-reading a
+// partially received string or object header.
+class AmfScanner {
+public:
+	enum Status {
+		// The value is well-formed.
+		VALID,
+		// The input ends before the value does.
+		TRUNCATED,
+		// The value is malformed, e.g. contains an invalid type marker, a
+		// negative length or a reference to an unknown or wrong-type value.
+		MALFORMED,
+		// The value contains an externalizable object (whose format is defined
+		// by the external deserializer), or is nested deeper than maxDepth.
+		UNSUPPORTED
+	};
+
+	AmfScanner(size_t maxDepth = 1024) : maxDepth(maxDepth), strings(0) {
+		next();
+	}
+
+	// Scans the value starting at it. If it is valid, advances it past the
+	// value and adds the strings, traits and objects of the value to the
+	// reference tables. Otherwise, leaves both it and the tables unchanged.
+	// Discards a value that is partially scanned with resume.
+	Status scan(const u8*& it, const u8* end);
+
+	// Continues scanning the value starting at data, of which size bytes are
+	// available so far. data may move between calls (e.g. when the caller's
+	// buffer grows), but the bytes already passed in must not change.
+	//
+	// Returns TRUNCATED until the value is complete, and VALID afterwards,
+	// when size() is its length and the reference tables contain its strings,
+	// traits and objects. If the value is MALFORMED or UNSUPPORTED, the tables
+	// are left as they were before the value. Once the result is final, it is
+	// returned again until next() is called.
+	Status resume(const u8* data, size_t size);
+
+	// The number of bytes of the value resumed so far, i.e. the size of a
+	// complete value.
+	size_t size() const { return offset; }
+
+	// Prepares resuming the next value, keeping the reference tables.
+	void next();
+
+	// Clears all reference tables and discards a partially scanned value.
+	void clear();
+
+	// Adds the table entries that ctx has and the scanner doesn't, e.g. after
+	// values have been decoded without scanning them, so that the next value
+	// can be scanned before decoding it with ctx. The tables are cleared
+	// first if ctx has fewer entries. Must not be called while a value is
+	// partially scanned.
+	void sync(DeserializationContext& ctx);
+
+	size_t stringsCount() const { return strings; }
+	size_t traitsCount() const { return traits.size(); }
+	size_t objectsCount() const { return objects.size(); }
+
+private:
+	struct Traits {
+		uint32_t sealed;
+		bool dynamic;
+		bool externalizable;
+	};
+
+	// A container whose members are being scanned.
+	struct Frame {
+		// Number of values left before and after the key-value pairs.
+		uint32_t values;
+		// The value has key-value pairs before (arrays) or after (dynamic
+		// objects) the plain values, terminated by an empty key.
+		bool pairsFirst;
+		bool pairsLast;
+		// A key was read, its value is next.
+		bool needValue;
+	};
+
+	Status scanValue(const u8*& it, const u8* end, Frame& child, bool& nested);
+	Status scanObjectHeader(const u8*& it, const u8* end, Frame& child, bool& nested);
+	Status scanString(const u8*& it, const u8* end, size_t& added, bool& empty);
+	void discard();
+
+	size_t maxDepth;
+	size_t strings;
+	std::vector<Traits> traits;
+	// type marker of every object, to check the type of references
+	std::vector<u8> objects;
+
+	// State of the value being resumed and the table sizes before it.
+	Status result;
+	bool started;
+	size_t offset;
+	std::vector<Frame> stack;
+	size_t stringsBefore;
+	size_t traitsBefore;
+	size_t objectsBefore;
+};
+
+} // namespace amf
+
+#endif
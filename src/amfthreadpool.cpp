@@ -0,0 +1,90 @@
+#include "amfthreadpool.hpp"
+
+namespace amf {
+
+AmfThreadPool::AmfThreadPool(size_t threads) :
+	task(nullptr), count(0), next(0), pending(0), generation(0), stopping(false),
+	errorIndex(0) {
+	if (threads == 0) {
+		size_t hardware = std::thread::hardware_concurrency();
+		threads = hardware > 1 ? hardware - 1 : 0;
+	}
+
+	workers.reserve(threads);
+	for (size_t i = 0; i < threads; ++i)
+		workers.emplace_back(&AmfThreadPool::work, this);
+}
+
+AmfThreadPool::~AmfThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	wake.notify_all();
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+void AmfThreadPool::run(size_t count, const std::function<void(size_t)>& task) {
+	std::lock_guard<std::mutex> running(runMutex);
+	std::unique_lock<std::mutex> lock(mutex);
+
+	this->task = &task;
+	this->count = count;
+	next = 0;
+	pending = count;
+	error = nullptr;
+	errorIndex = count;
+	++generation;
+	wake.notify_all();
+
+	execute(lock);
+	done.wait(lock, [this] { return pending == 0; });
+
+	this->task = nullptr;
+	if (error)
+		std::rethrow_exception(error);
+}
+
+void AmfThreadPool::work() {
+	std::unique_lock<std::mutex> lock(mutex);
+	size_t seen = 0;
+
+	while (true) {
+		wake.wait(lock, [&] { return stopping || generation != seen; });
+		if (stopping)
+			return;
+
+		seen = generation;
+		execute(lock);
+	}
+}
+
+// Makes calls of the current batch until none are left. The lock is only
+// released during the calls.
+void AmfThreadPool::execute(std::unique_lock<std::mutex>& lock) {
+	while (next < count) {
+		size_t index = next++;
+		const std::function<void(size_t)>& call = *task;
+
+		lock.unlock();
+		std::exception_ptr thrown;
+		try {
+			call(index);
+		} catch (...) {
+			thrown = std::current_exception();
+		}
+		lock.lock();
+
+		if (thrown && index < errorIndex) {
+			error = thrown;
+			errorIndex = index;
+		}
+
+		if (--pending == 0)
+			done.notify_all();
+	}
+}
+
+} // namespace amf
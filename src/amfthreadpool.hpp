@@ -0,0 +1,60 @@
+#pragma once
+#ifndef AMFTHREADPOOL_HPP
+#define AMFTHREADPOOL_HPP
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace amf {
+
+// A fixed set of worker threads to encode and decode independent values (like
+// the headers and messages of an AmfPacket) in parallel. The threads are
+// started once and reused, so the pool should be kept around instead of
+// being created per packet.
+class AmfThreadPool {
+public:
+	// Starts threads worker threads. With 0, one less than the number of
+	// hardware threads is started, as the thread calling run() works as well.
+	explicit AmfThreadPool(size_t threads = 0);
+	~AmfThreadPool();
+
+	AmfThreadPool(const AmfThreadPool&) = delete;
+	AmfThreadPool& operator=(const AmfThreadPool&) = delete;
+
+	// The number of worker threads.
+	size_t size() const { return workers.size(); }
+
+	// Calls task(i) for every i < count on the worker threads and the calling
+	// thread, and returns once all calls have returned. If calls throw, the
+	// exception of the call with the lowest i is rethrown afterwards. Calls
+	// to run from several threads are executed one after another.
+	void run(size_t count, const std::function<void(size_t)>& task);
+
+private:
+	void work();
+	void execute(std::unique_lock<std::mutex>& lock);
+
+	std::vector<std::thread> workers;
+	std::mutex runMutex;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+
+	// The current batch of calls, guarded by mutex.
+	const std::function<void(size_t)>* task;
+	size_t count;
+	size_t next;
+	size_t pending;
+	size_t generation;
+	bool stopping;
+	std::exception_ptr error;
+	size_t errorIndex;
+};
+
+} // namespace amf
+
+#endif
@@ -0,0 +1,212 @@
+#include "amfwriter.hpp"
+
+#include "types/amfbool.hpp"
+#include "types/amfdouble.hpp"
+#include "types/amfinteger.hpp"
+#include "types/amfnull.hpp"
+#include "types/amfobject.hpp"
+#include "types/amfstring.hpp"
+#include "types/amfundefined.hpp"
+
+namespace amf {
+
+void AmfWriter::clear() {
+	buf.clear();
+	ctx.clear();
+	stack.clear();
+}
+
+// Checks that a value may be written next and counts it towards the
+// enclosing container.
+void AmfWriter::beginValue() {
+	if (stack.empty()) {
+		beginTopLevelValue();
+		return;
+	}
+
+	Frame& frame = stack.back();
+	if (frame.key) {
+		frame.key = false;
+		return;
+	}
+
+	if (frame.marker == AMF_ARRAY && frame.keys) {
+		// UTF-8-empty terminates the associative part of the array
+		buf.push_back(0x01);
+		frame.keys = false;
+	}
+
+	if (frame.written == frame.values)
+		throw std::invalid_argument("AmfWriter: Too many values");
+
+	++frame.written;
+}
+
+void AmfWriter::writeUndefined() {
+	beginValue();
+	AmfUndefined().serialize(buf, ctx);
+}
+
+void AmfWriter::writeNull() {
+	beginValue();
+	AmfNull().serialize(buf, ctx);
+}
+
+void AmfWriter::writeBool(bool value) {
+	beginValue();
+	AmfBool(value).serialize(buf, ctx);
+}
+
+void AmfWriter::writeInt(int value) {
+	beginValue();
+	AmfInteger(value).serialize(buf, ctx);
+}
+
+void AmfWriter::writeDouble(double value) {
+	beginValue();
+	AmfDouble(value).serialize(buf, ctx);
+}
+
+void AmfWriter::writeString(const std::string& value) {
+	beginValue();
+	buf.push_back(AMF_STRING);
+	AmfString::serializeValue(buf, value, ctx);
+}
+
+void AmfWriter::writeDate(long long millis) {
+	beginValue();
+	buf.push_back(AMF_DATE);
+	ctx.addAnonymousObject();
+
+	buf.push_back(0x01);
+	write_network(buf, static_cast<double>(millis));
+}
+
+void AmfWriter::writeByteArray(const u8* data, size_t size) {
+	beginValue();
+	buf.push_back(AMF_BYTEARRAY);
+	ctx.addAnonymousObject();
+
+	AmfInteger::serializeLength(buf, size);
+	buf.insert(buf.end(), data, data + size);
+}
+
+void AmfWriter::writeItem(const AmfItem& item) {
+	beginValue();
+	item.serialize(buf, ctx);
+
+	// Like the Serializer, don't keep referring to item by address, as it may
+	// be a temporary.
+	ctx.releaseObjects();
+}
+
+void AmfWriter::writeReference(AmfMarker marker, size_t index) {
+	// only complex values (XML documents and everything after them) are
+	// added to the object table
+	if (marker < AMF_XMLDOC || marker > AMF_DICTIONARY)
+		throw std::invalid_argument("AmfWriter: Type can't be referenced");
+
+	beginValue();
+	buf.push_back(marker);
+	AmfInteger::serializeReference(buf, index);
+}
+
+size_t AmfWriter::beginContainer(AmfMarker marker, size_t values, bool keys) {
+	beginValue();
+	buf.push_back(marker);
+	size_t index = ctx.addAnonymousObject();
+
+	Frame frame = { marker, values, 0, keys, false };
+	stack.push_back(frame);
+	return index;
+}
+
+size_t AmfWriter::beginArray(size_t denseCount) {
+	size_t index = beginContainer(AMF_ARRAY, denseCount, true);
+	AmfInteger::serializeLength(buf, denseCount);
+	return index;
+}
+
+size_t AmfWriter::beginObject(const AmfObjectTraits& traits) {
+	if (traits.externalizable)
+		throw std::invalid_argument("AmfWriter: Externalizable objects are not supported");
+
+	size_t index = beginContainer(AMF_OBJECT, traits.getAttriutes().size(), traits.dynamic);
+	AmfObject::serializeTraits(buf, traits, ctx);
+	return index;
+}
+
+size_t AmfWriter::beginObject(const std::string& className,
+	const std::vector<std::string>& sealedNames, bool dynamic) {
+	AmfObjectTraits traits(className, dynamic, false);
+	for (const std::string& name : sealedNames)
+		traits.addAttribute(name);
+
+	return beginObject(traits);
+}
+
+size_t AmfWriter::beginObjectVector(const std::string& type, size_t count, bool fixed) {
+	size_t index = beginContainer(AMF_VECTOR_OBJECT, count, false);
+	AmfInteger::serializeLength(buf, count);
+	buf.push_back(fixed ? 0x01 : 0x00);
+	AmfString::serializeValue(buf, type, ctx);
+	return index;
+}
+
+size_t AmfWriter::beginDictionary(size_t count, bool weak) {
+	size_t index = beginContainer(AMF_DICTIONARY, count * 2, false);
+	AmfInteger::serializeLength(buf, count);
+	buf.push_back(weak ? 0x01 : 0x00);
+	return index;
+}
+
+void AmfWriter::writeKey(const std::string& key) {
+	if (stack.empty() || stack.back().key || !stack.back().keys)
+		throw std::invalid_argument("AmfWriter: Unexpected key");
+
+	// dynamic members follow the sealed values
+	Frame& frame = stack.back();
+	if (frame.marker == AMF_OBJECT && frame.written != frame.values)
+		throw std::invalid_argument("AmfWriter: Unexpected key");
+
+	// an empty key would terminate the members
+	if (key.empty())
+		throw std::invalid_argument("AmfWriter: Empty key");
+
+	AmfString::serializeValue(buf, key, ctx);
+	frame.key = true;
+}
+
+void AmfWriter::endContainer(AmfMarker marker) {
+	if (stack.empty() || stack.back().marker != marker)
+		throw std::invalid_argument("AmfWriter: Unexpected end");
+
+	const Frame& frame = stack.back();
+	if (frame.key || frame.written != frame.values)
+		throw std::invalid_argument("AmfWriter: Missing values");
+
+	// UTF-8-empty terminates the associative part of an array or the dynamic
+	// members of an object
+	if (frame.keys)
+		buf.push_back(0x01);
+
+	stack.pop_back();
+}
+
+void AmfWriter::endArray() {
+	endContainer(AMF_ARRAY);
+}
+
+void AmfWriter::endObject() {
+	endContainer(AMF_OBJECT);
+}
+
+void AmfWriter::endObjectVector() {
+	endContainer(AMF_VECTOR_OBJECT);
+}
+
+void AmfWriter::endDictionary() {
+	endContainer(AMF_DICTIONARY);
+}
+
+} // namespace amf
@@ -0,0 +1,124 @@
+#pragma once
+#ifndef AMFWRITER_HPP
+#define AMFWRITER_HPP
+
+#include <string>
+#include <vector>
+
+#include "amf.hpp"
+#include "serializationcontext.hpp"
+#include "types/amfitem.hpp"
+#include "utils/amfobjecttraits.hpp"
+
+namespace amf {
+
+// Serializes AMF3 values directly into a buffer, without constructing
+// AmfItems for them first. Containers are written by a begin call, followed
+// by their contents and the matching end call:
+//
+//   writer.beginArray(2);
+//   writer.writeKey("name"); writer.writeString("points");
+//   writer.beginObject(pointTraits);
+//   writer.writeInt(1); writer.writeInt(2);
+//   writer.endObject();
+//   writer.writeReference(AMF_OBJECT, pointIndex);
+//   writer.endArray();
+//
+// Strings and traits are referenced through the SerializationContext like
+// with the Serializer. Complex values written by the writer are never
+// referenced automatically, but the begin calls return the reference index of
+// the new value, which can be passed to writeReference.
+//
+// Writing a value or key where it isn't allowed (e.g. too many values for an
+// array or object, or an end call that doesn't match the begin call) throws
+// std::invalid_argument.
+class AmfWriter {
+public:
+	AmfWriter() { }
+	AmfWriter(SerializationContext ctx) : ctx(ctx) { }
+	virtual ~AmfWriter() { }
+
+	const std::vector<u8> & data() const { return buf; }
+	void clear();
+
+	// Pre-allocates the output buffer if the (approximate) size of the
+	// serialized data is known in advance.
+	void reserve(size_t size) { buf.reserve(size); }
+
+	SerializationContext& context() { return ctx; }
+
+	// Whether all containers have been ended.
+	bool complete() const { return stack.empty(); }
+
+	void writeUndefined();
+	void writeNull();
+	void writeBool(bool value);
+	// Values outside the U29 range are written as double, like AmfInteger.
+	void writeInt(int value);
+	void writeDouble(double value);
+	void writeString(const std::string& value);
+	void writeDate(long long millis);
+	void writeByteArray(const u8* data, size_t size);
+
+	// Serializes item as the next value.
+	void writeItem(const AmfItem& item);
+
+	// Writes a reference to a complex value previously written with the same
+	// context. marker is the type marker of that value.
+	void writeReference(AmfMarker marker, size_t index);
+
+	// Begin a container and return its reference index.
+	//
+	// Arrays have optional associative members, written as writeKey followed
+	// by the value, before exactly denseCount values.
+	size_t beginArray(size_t denseCount);
+	// Objects have one value for each sealed property, in the order of the
+	// traits, followed by dynamic members written as writeKey and value if
+	// the traits are dynamic. Externalizable traits are not supported.
+	size_t beginObject(const AmfObjectTraits& traits);
+	size_t beginObject(const std::string& className,
+		const std::vector<std::string>& sealedNames, bool dynamic);
+	// Object vectors have exactly count values.
+	size_t beginObjectVector(const std::string& type, size_t count, bool fixed);
+	// Dictionaries have exactly count keys and values, written alternately
+	// as plain values.
+	size_t beginDictionary(size_t count, bool weak);
+
+	void writeKey(const std::string& key);
+
+	void endArray();
+	void endObject();
+	void endObjectVector();
+	void endDictionary();
+
+protected:
+	// Called before a value is written outside of any container.
+	virtual void beginTopLevelValue() { }
+
+	SerializationContext ctx;
+	std::vector<u8> buf;
+
+private:
+	struct Frame {
+		AmfMarker marker;
+		// Number of values expected and written so far, not counting the
+		// values of associative and dynamic members.
+		size_t values;
+		size_t written;
+		// Keys may be written: the associative part of an array that hasn't
+		// been terminated yet, or a dynamic object.
+		bool keys;
+		// A key was written, its value is next.
+		bool key;
+	};
+
+	void beginValue();
+	size_t beginContainer(AmfMarker marker, size_t values, bool keys);
+	void endContainer(AmfMarker marker);
+
+	std::vector<Frame> stack;
+};
+
+} // namespace amf
+
+#endif
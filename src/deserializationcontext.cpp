@@ -6,6 +6,7 @@ namespace amf {
 
 void DeserializationContext::clear() {
 	strings.clear();
+	stringSlab.clear();
 	traits.clear();
 	objects.clear();
 }
@@ -13,18 +14,36 @@ void DeserializationContext::clear() {
 void DeserializationContext::addString(const std::string& str) {
 	if (str.empty()) return;
 
+	strings.push_back(stringSlab.store(str.data(), str.size()));
+}
+
+AmfStringView DeserializationContext::addString(AmfStringView str) {
+	if (str.empty()) return str;
+
+	if (stringMode == STRINGS_IN_CONTEXT)
+		str = stringSlab.store(str.data(), str.size());
+
 	strings.push_back(str);
+	return str;
 }
 
-const std::string & DeserializationContext::getString(size_t index) {
+AmfStringView DeserializationContext::getString(size_t index) {
 	return strings.at(index);
 }
 
 void DeserializationContext::addTraits(const AmfObjectTraits& trait) {
-	traits.push_back(trait);
+	traits.push_back(AmfObjectTraits::intern(trait));
+}
+
+void DeserializationContext::addTraits(AmfObjectTraitsPtr trait) {
+	traits.push_back(std::move(trait));
 }
 
 const AmfObjectTraits & DeserializationContext::getTraits(size_t index) {
+	return *traits.at(index);
+}
+
+const AmfObjectTraitsPtr & DeserializationContext::getTraitsPtr(size_t index) {
 	return traits.at(index);
 }
 
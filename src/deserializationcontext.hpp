@@ -5,22 +5,90 @@
 #include <vector>
 
 #include "amf.hpp"
+#include "utils/amfarena.hpp"
 #include "utils/amfitemptr.hpp"
 #include "utils/amfobjecttraits.hpp"
+#include "utils/amfstringview.hpp"
 
 namespace amf {
 
+// Where the string reference table keeps the bytes of decoded strings.
+//
+// STRINGS_IN_CONTEXT copies every decoded string once into a slab owned by
+// the context. STRINGS_IN_INPUT stores views directly into the input buffer
+// and copies nothing, so the caller must keep the input alive and unchanged
+// for as long as it uses the context or views obtained from it.
+enum StringStorageMode {
+	STRINGS_IN_CONTEXT,
+	STRINGS_IN_INPUT
+};
+
 class DeserializationContext {
 public:
-	DeserializationContext() { }
-
+	DeserializationContext(StringStorageMode mode = STRINGS_IN_CONTEXT) :
+		stringMode(mode), arena(nullptr) { }
+
+	// The sizes of the tables, see rollback.
+	struct Checkpoint {
+		size_t strings;
+		size_t traits;
+		size_t objects;
+		AmfStringSlab::Mark slab;
+	};
+
+	// Clears all tables. Views previously returned by getString are
+	// invalidated.
 	void clear();
 
+	Checkpoint checkpoint() const {
+		Checkpoint checkpoint = { strings.size(), traits.size(), objects.size(), stringSlab.mark() };
+		return checkpoint;
+	}
+
+	// Removes the strings, traits and objects added since the checkpoint was
+	// taken, e.g. by a deserializer that failed. The context must not have
+	// been cleared since.
+	void rollback(const Checkpoint& checkpoint) {
+		strings.resize(checkpoint.strings);
+		traits.resize(checkpoint.traits);
+		objects.resize(checkpoint.objects);
+		stringSlab.rewind(checkpoint.slab);
+	}
+
+	StringStorageMode stringStorageMode() const { return stringMode; }
+
+	// Makes all items deserialized with this context live in arena instead of
+	// being allocated individually. The returned AmfItemPtrs don't own the
+	// items and are only valid until the arena is cleared or destroyed, at
+	// which point the context must be cleared as well. Pass nullptr to go back
+	// to individually owned items.
+	void setArena(AmfArena* arena) { this->arena = arena; }
+	AmfArena* getArena() const { return arena; }
+
+	// Creates a new deserialized item, in the arena if one is set.
+	template<typename T, typename... Args>
+	AmfItemPtr createItem(Args&&... args) {
+		if (arena == nullptr)
+			return AmfItemPtr(new T(std::forward<Args>(args)...));
+
+		return AmfItemPtr::unowned(arena->create<T>(std::forward<Args>(args)...));
+	}
+
+	// Stores a copy of str, regardless of the storage mode.
 	void addString(const std::string& str);
-	const std::string & getString(size_t index);
+	// Stores a view of str in STRINGS_IN_INPUT mode, a copy otherwise.
+	AmfStringView addString(AmfStringView str);
+	AmfStringView getString(size_t index);
+	size_t stringsCount() const { return strings.size(); }
 
+	// Adds the interned traits equal to trait, see AmfObjectTraits::intern.
 	void addTraits(const AmfObjectTraits& trait);
+	void addTraits(AmfObjectTraitsPtr trait);
 	const AmfObjectTraits & getTraits(size_t index);
+	const AmfObjectTraitsPtr & getTraitsPtr(size_t index);
+	size_t traitsCount() const { return traits.size(); }
+
+	size_t objectsCount() const { return objects.size(); }
 
 	void addPointer(const AmfItemPtr & ptr) {
 		objects.push_back(ptr);
@@ -38,7 +106,7 @@ public:
 
 	template<typename T>
 	void addObject(const T& object) {
-		objects.emplace_back(new T(object));
+		objects.push_back(createItem<T>(object));
 	}
 
 	template<typename T>
@@ -48,8 +116,11 @@ public:
 	}
 
 private:
-	std::vector<std::string> strings;
-	std::vector<AmfObjectTraits> traits;
+	StringStorageMode stringMode;
+	AmfArena* arena;
+	AmfStringSlab stringSlab;
+	std::vector<AmfStringView> strings;
+	std::vector<AmfObjectTraitsPtr> traits;
 	std::vector<AmfItemPtr> objects;
 };
 
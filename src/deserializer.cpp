@@ -21,60 +21,58 @@ namespace amf {
 
 std::map<std::string, ExternalDeserializerFunction> Deserializer::externalDeserializers({ });
 
-AmfItemPtr Deserializer::deserialize(v8 data, DeserializationContext& ctx) {
-	auto it = data.cbegin();
-	return deserialize(it, data.cend(), ctx);
+AmfItemPtr Deserializer::deserialize(const v8& data, DeserializationContext& ctx) {
+	return deserialize(data.data(), data.size(), ctx);
 }
 
-AmfItemPtr Deserializer::deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+AmfItemPtr Deserializer::deserialize(const u8* data, size_t size, DeserializationContext& ctx) {
+	return deserialize(data, data + size, ctx);
+}
+
+template<typename T>
+static AmfItemPtr deserializeItem(const u8*& it, const u8* end, DeserializationContext& ctx) {
+	return ctx.createItem<T>(T::deserialize(it, end, ctx));
+}
+
+AmfItemPtr Deserializer::deserialize(const u8*& it, const u8* end, DeserializationContext& ctx) {
+	typedef AmfItemPtr (*DeserializerFunction)(const u8*&, const u8*, DeserializationContext&);
+
+	// Indexed by type marker.
+	static const DeserializerFunction deserializers[] = {
+		deserializeItem<AmfUndefined>, // AMF_UNDEFINED
+		deserializeItem<AmfNull>, // AMF_NULL
+		deserializeItem<AmfBool>, // AMF_FALSE
+		deserializeItem<AmfBool>, // AMF_TRUE
+		deserializeItem<AmfInteger>, // AMF_INTEGER
+		deserializeItem<AmfDouble>, // AMF_DOUBLE
+		deserializeItem<AmfString>, // AMF_STRING
+		deserializeItem<AmfXmlDocument>, // AMF_XMLDOC
+		deserializeItem<AmfDate>, // AMF_DATE
+		AmfArray::deserializePtr, // AMF_ARRAY
+		AmfObject::deserializePtr, // AMF_OBJECT
+		deserializeItem<AmfXml>, // AMF_XML
+		deserializeItem<AmfByteArray>, // AMF_BYTEARRAY
+		deserializeItem<AmfVector<int>>, // AMF_VECTOR_INT
+		deserializeItem<AmfVector<unsigned int>>, // AMF_VECTOR_UINT
+		deserializeItem<AmfVector<double>>, // AMF_VECTOR_DOUBLE
+		AmfVector<AmfItem>::deserializePtr, // AMF_VECTOR_OBJECT
+		AmfDictionary::deserializePtr, // AMF_DICTIONARY
+	};
+	static_assert(sizeof(deserializers) / sizeof(deserializers[0]) == AMF_DICTIONARY + 1,
+		"Missing deserializer for type marker");
+
 	if (it == end)
 		throw std::out_of_range("Deserializer::deserialize end of input");
 
 	u8 type = *it;
-	switch (type) {
-		case AMF_UNDEFINED:
-			return AmfItemPtr(AmfUndefined::deserialize(it, end, ctx));
-		case AMF_NULL:
-			return AmfItemPtr(AmfNull::deserialize(it, end, ctx));
-		case AMF_FALSE:
-		case AMF_TRUE:
-			return AmfItemPtr(AmfBool::deserialize(it, end, ctx));
-		case AMF_INTEGER:
-			return AmfItemPtr(AmfInteger::deserialize(it, end, ctx));
-		case AMF_DOUBLE:
-			return AmfItemPtr(AmfDouble::deserialize(it, end, ctx));
-		case AMF_STRING:
-			return AmfItemPtr(AmfString::deserialize(it, end, ctx));
-		case AMF_XMLDOC:
-			return AmfItemPtr(AmfXmlDocument::deserialize(it, end, ctx));
-		case AMF_DATE:
-			return AmfItemPtr(AmfDate::deserialize(it, end, ctx));
-		case AMF_ARRAY:
-			return AmfArray::deserializePtr(it, end, ctx);
-		case AMF_OBJECT:
-			return AmfObject::deserializePtr(it, end, ctx);
-		case AMF_XML:
-			return AmfItemPtr(AmfXml::deserialize(it, end, ctx));
-		case AMF_BYTEARRAY:
-			return AmfItemPtr(AmfByteArray::deserialize(it, end, ctx));
-		case AMF_VECTOR_INT:
-			return AmfItemPtr(AmfVector<int>::deserialize(it, end, ctx));
-		case AMF_VECTOR_UINT:
-			return AmfItemPtr(AmfVector<unsigned int>::deserialize(it, end, ctx));
-		case AMF_VECTOR_DOUBLE:
-			return AmfItemPtr(AmfVector<double>::deserialize(it, end, ctx));
-		case AMF_VECTOR_OBJECT:
-			return AmfVector<AmfItem>::deserializePtr(it, end, ctx);
-		case AMF_DICTIONARY:
-			return AmfDictionary::deserializePtr(it, end, ctx);
-		default:
-			throw std::invalid_argument("Deserializer::deserialize: Invalid type byte");
-	}
+	if (type > AMF_DICTIONARY)
+		throw std::invalid_argument("Deserializer::deserialize: Invalid type byte");
+
+	return deserializers[type](it, end, ctx);
 }
 
-AmfItemPtr Deserializer::deserialize(v8 buf) {
-	auto it = buf.cbegin();
-	return deserialize(it, buf.cend(), ctx);
+AmfItemPtr Deserializer::deserialize(const v8& buf) {
+	return deserialize(buf.data(), buf.size(), ctx);
 }
 
 } // namespace amf
@@ -14,7 +14,7 @@ namespace amf {
 
 class AmfObject;
 
-typedef std::function<AmfObject(v8::const_iterator&, v8::const_iterator,
+typedef std::function<AmfObject(const u8*&, const u8*,
 	DeserializationContext&)> ExternalDeserializerFunction;
 
 class Deserializer {
@@ -22,15 +22,27 @@ public:
 	Deserializer() : ctx() { }
 	Deserializer(DeserializationContext ctx) : ctx(ctx) { }
 
-	AmfItemPtr deserialize(v8 buf);
+	AmfItemPtr deserialize(const v8& buf);
+	AmfItemPtr deserialize(const u8* data, size_t size) {
+		return deserialize(data, size, ctx);
+	}
+	AmfItemPtr deserialize(const u8*& it, const u8* end) {
+		return deserialize(it, end, ctx);
+	}
 	AmfItemPtr deserialize(v8::const_iterator& it, v8::const_iterator end) {
 		return deserialize(it, end, ctx);
 	}
 
 	void clearContext() { ctx.clear(); }
 
-	static AmfItemPtr deserialize(v8 data, DeserializationContext& ctx);
-	static AmfItemPtr deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx);
+	static AmfItemPtr deserialize(const v8& data, DeserializationContext& ctx);
+	// Deserializes a single value directly from the given buffer, which is
+	// not copied (e.g. a socket read buffer or a memory-mapped file).
+	static AmfItemPtr deserialize(const u8* data, size_t size, DeserializationContext& ctx);
+	static AmfItemPtr deserialize(const u8*& it, const u8* end, DeserializationContext& ctx);
+	static AmfItemPtr deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+		return with_pointers(deserialize, it, end, ctx);
+	}
 
 	static std::map<std::string, ExternalDeserializerFunction> externalDeserializers;
 
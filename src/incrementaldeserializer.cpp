@@ -0,0 +1,232 @@
+#include "incrementaldeserializer.hpp"
+
+#include <stdexcept>
+
+#include "amfpacketindex.hpp"
+#include "deserializer.hpp"
+
+namespace amf {
+
+// Discards the decoded part of buffer once it makes up at least half of it,
+// so that each byte is moved at most a constant number of times on average.
+static void compact(v8& buffer, size_t& start) {
+	if (start == buffer.size()) {
+		buffer.clear();
+		start = 0;
+	} else if (start >= 4096 && start >= buffer.size() / 2) {
+		buffer.erase(buffer.begin(), buffer.begin() + start);
+		start = 0;
+	}
+}
+
+// Runs decode, which reads a value the AmfScanner can't find the end of.
+// Returns false if the value is incomplete, i.e. decode throws
+// std::out_of_range, in which case the entries decode added to ctx are
+// removed again. Other exceptions mean the value is malformed and are passed
+// on.
+template<typename F>
+static bool try_decode(F decode, DeserializationContext& ctx) {
+	DeserializationContext::Checkpoint checkpoint = ctx.checkpoint();
+	try {
+		decode();
+	} catch (const std::out_of_range&) {
+		ctx.rollback(checkpoint);
+		return false;
+	}
+
+	return true;
+}
+
+IncrementalDeserializer::IncrementalDeserializer(DeserializationContext ctx, size_t maxBuffered) :
+	ctx(ctx), start(0), maxBuffered(maxBuffered) {
+	if (ctx.stringStorageMode() == STRINGS_IN_INPUT)
+		throw std::invalid_argument("IncrementalDeserializer: strings must be stored in the context");
+
+	// values may refer to what is in the context already
+	scanner.sync(this->ctx);
+}
+
+void IncrementalDeserializer::push(const u8* data, size_t size) {
+	buffer.insert(buffer.end(), data, data + size);
+
+	const u8* it = buffer.data() + start;
+	const u8* end = buffer.data() + buffer.size();
+	while (it != end) {
+		AmfScanner::Status status = scanner.resume(it, end - it);
+		if (status == AmfScanner::TRUNCATED)
+			break;
+
+		if (status == AmfScanner::MALFORMED)
+			throw std::invalid_argument("IncrementalDeserializer: Malformed value");
+
+		AmfItemPtr item;
+		if (status == AmfScanner::VALID) {
+			item = Deserializer::deserialize(it, it + scanner.size(), ctx);
+			scanner.next();
+		} else {
+			const u8* p = it;
+			bool decoded = try_decode([&]() {
+				item = Deserializer::deserialize(p, end, ctx);
+			}, ctx);
+
+			if (!decoded)
+				break;
+
+			// the scanner doesn't know what the decoded value added to ctx
+			scanner.sync(ctx);
+			it = p;
+		}
+
+		items.push_back(item);
+	}
+
+	start = it - buffer.data();
+	compact(buffer, start);
+
+	if (buffered() > maxBuffered)
+		throw std::length_error("IncrementalDeserializer: Value exceeds the maximum size");
+}
+
+bool IncrementalDeserializer::next(AmfItemPtr& item) {
+	if (items.empty())
+		return false;
+
+	item = items.front();
+	items.pop_front();
+	return true;
+}
+
+IncrementalPacketDeserializer::IncrementalPacketDeserializer(DeserializationContext ctx, size_t maxBuffered) :
+	ctx(ctx), start(0), maxBuffered(maxBuffered), state(VERSION), remaining(0) {
+	if (ctx.stringStorageMode() == STRINGS_IN_INPUT)
+		throw std::invalid_argument("IncrementalPacketDeserializer: strings must be stored in the context");
+}
+
+void IncrementalPacketDeserializer::push(const u8* data, size_t size) {
+	buffer.insert(buffer.end(), data, data + size);
+
+	while (decodeNext()) { }
+
+	compact(buffer, start);
+
+	if (buffered() > maxBuffered)
+		throw std::length_error("IncrementalPacketDeserializer: Entry exceeds the maximum size");
+}
+
+// Decodes a header or message starting at it, if it is complete.
+template<typename T>
+static bool decode_entry(const u8*& it, const u8* end, bool isHeader,
+	AmfScanner& scanner, DeserializationContext& ctx, std::deque<T>& entries) {
+	const u8* value = it;
+	AmfPacketIndex::Framing framing;
+	if (!AmfPacketIndex::readFraming(value, end, isHeader, framing))
+		return false;
+
+	const u8* value_end;
+	if (framing.valueLength != AmfPacketIndex::unknownLength) {
+		value_end = value + framing.valueLength;
+	} else {
+		// The length is unknown, so scan the AMF3 value. It starts with empty
+		// reference tables, which the scanner has been cleared to after the
+		// previous entry.
+		AmfScanner::Status status = scanner.resume(value, end - value);
+		if (status == AmfScanner::TRUNCATED)
+			return false;
+
+		if (status == AmfScanner::MALFORMED)
+			throw std::invalid_argument("AmfPacket: Malformed value");
+
+		if (status == AmfScanner::UNSUPPORTED) {
+			// T::deserialize clears ctx, which must happen before the
+			// checkpoint is taken.
+			ctx.clear();
+
+			const u8* p = it;
+			bool decoded = try_decode([&]() {
+				entries.push_back(T::deserialize(p, end, ctx));
+			}, ctx);
+
+			if (decoded) {
+				scanner.clear();
+				it = p;
+			}
+
+			return decoded;
+		}
+
+		value_end = value + scanner.size();
+	}
+
+	entries.push_back(T::deserialize(it, value_end, ctx));
+	scanner.clear();
+	return true;
+}
+
+bool IncrementalPacketDeserializer::decodeNext() {
+	const u8* it = buffer.data() + start;
+	const u8* end = buffer.data() + buffer.size();
+
+	switch (state) {
+		case VERSION:
+			if (!AmfPacketIndex::readVersion(it, end))
+				return false;
+
+			state = HEADER_COUNT;
+			break;
+		case HEADER_COUNT:
+		case MESSAGE_COUNT:
+			if (end - it < 2)
+				return false;
+
+			remaining = read_network<uint16_t>(it, end);
+			state = (state == HEADER_COUNT) ? HEADER : MESSAGE;
+			break;
+		case HEADER:
+			if (remaining == 0) {
+				state = MESSAGE_COUNT;
+				return true;
+			}
+
+			if (!decode_entry(it, end, true, scanner, ctx, headers))
+				return false;
+
+			--remaining;
+			break;
+		case MESSAGE:
+			if (remaining == 0) {
+				state = DONE;
+				return true;
+			}
+
+			if (!decode_entry(it, end, false, scanner, ctx, messages))
+				return false;
+
+			--remaining;
+			break;
+		case DONE:
+			return false;
+	}
+
+	start = it - buffer.data();
+	return true;
+}
+
+bool IncrementalPacketDeserializer::nextHeader(PacketHeader& header) {
+	if (headers.empty())
+		return false;
+
+	header = headers.front();
+	headers.pop_front();
+	return true;
+}
+
+bool IncrementalPacketDeserializer::nextMessage(PacketMessage& message) {
+	if (messages.empty())
+		return false;
+
+	message = messages.front();
+	messages.pop_front();
+	return true;
+}
+
+} // namespace amf
@@ -0,0 +1,116 @@
+#pragma once
+#ifndef INCREMENTALDESERIALIZER_HPP
+#define INCREMENTALDESERIALIZER_HPP
+
+#include <deque>
+
+#include "amf.hpp"
+#include "amfpacket.hpp"
+#include "amfscanner.hpp"
+#include "deserializationcontext.hpp"
+#include "utils/amfitemptr.hpp"
+
+namespace amf {
+
+// Deserializes a sequence of top-level AMF3 values from input that arrives in
+// chunks (e.g. from a socket). Each value is decoded as soon as its last byte
+// has been pushed, without re-reading the input received before.
+//
+// Values containing externalizable objects can't be scanned ahead of
+// decoding. Decoding them is attempted on every push until it no longer runs
+// out of input (i.e. doesn't throw std::out_of_range), and each attempt reads
+// the value from its start. To bound the work and memory spent on a value, no
+// more than maxBuffered bytes are buffered.
+//
+// All push methods throw std::invalid_argument or std::out_of_range on
+// malformed input, and std::length_error if more than maxBuffered bytes don't
+// make up a complete value. The deserializer can't be used anymore after
+// that.
+class IncrementalDeserializer {
+public:
+	static const size_t defaultMaxBuffered = 64 * 1024 * 1024;
+
+	// The context must store strings in the context, as the input buffer is
+	// discarded once values are decoded.
+	IncrementalDeserializer(DeserializationContext ctx = DeserializationContext(),
+		size_t maxBuffered = defaultMaxBuffered);
+
+	// Appends data to the input and decodes all values completed by it.
+	void push(const u8* data, size_t size);
+	void push(const v8& data) { push(data.data(), data.size()); }
+
+	// Takes the next decoded value, returns false if there is none yet.
+	bool next(AmfItemPtr& item);
+
+	// The number of decoded values not yet taken by next().
+	size_t available() const { return items.size(); }
+
+	// The number of received bytes that aren't part of a decoded value yet.
+	size_t buffered() const { return buffer.size() - start; }
+
+	DeserializationContext& context() { return ctx; }
+
+private:
+	DeserializationContext ctx;
+	v8 buffer;
+	size_t start;
+	size_t maxBuffered;
+	AmfScanner scanner;
+	std::deque<AmfItemPtr> items;
+};
+
+// Deserializes an AMF packet that arrives in chunks. Headers and messages are
+// available as soon as they have been received completely, before the rest of
+// the packet arrives. Values are handled like by the IncrementalDeserializer.
+class IncrementalPacketDeserializer {
+public:
+	IncrementalPacketDeserializer(DeserializationContext ctx = DeserializationContext(),
+		size_t maxBuffered = IncrementalDeserializer::defaultMaxBuffered);
+
+	// Appends data to the input and decodes all headers and messages
+	// completed by it. Throws std::invalid_argument or std::out_of_range on
+	// malformed input, and std::length_error if more than maxBuffered bytes
+	// don't make up a complete header or message.
+	void push(const u8* data, size_t size);
+	void push(const v8& data) { push(data.data(), data.size()); }
+
+	// Take the next decoded header or message, return false if there is
+	// none yet.
+	bool nextHeader(PacketHeader& header);
+	bool nextMessage(PacketMessage& message);
+
+	// Whether the whole packet has been received.
+	bool finished() const { return state == DONE; }
+
+	// The number of received bytes that aren't part of a decoded header or
+	// message yet.
+	size_t buffered() const { return buffer.size() - start; }
+
+	DeserializationContext& context() { return ctx; }
+
+private:
+	enum State {
+		VERSION,
+		HEADER_COUNT,
+		HEADER,
+		MESSAGE_COUNT,
+		MESSAGE,
+		DONE
+	};
+
+	bool decodeNext();
+
+	DeserializationContext ctx;
+	v8 buffer;
+	size_t start;
+	size_t maxBuffered;
+	AmfScanner scanner;
+	State state;
+	uint16_t remaining;
+	std::deque<PacketHeader> headers;
+	std::deque<PacketMessage> messages;
+};
+
+} // namespace amf
+
+#endif
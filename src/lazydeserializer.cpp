@@ -0,0 +1,1011 @@
+#include "lazydeserializer.hpp"
+
+#include <typeinfo>
+
+#include "amfpacketindex.hpp"
+#include "amfpath.hpp"
+#include "types/amfarray.hpp"
+#include "types/amfbool.hpp"
+#include "types/amfbytearray.hpp"
+#include "types/amfdate.hpp"
+#include "types/amfdictionary.hpp"
+#include "types/amfdouble.hpp"
+#include "types/amfinteger.hpp"
+#include "types/amfnull.hpp"
+#include "types/amfobject.hpp"
+#include "types/amfstring.hpp"
+#include "types/amfundefined.hpp"
+#include "types/amfvector.hpp"
+#include "types/amfxml.hpp"
+#include "types/amfxmldocument.hpp"
+
+namespace amf {
+
+// The positions of the members of a container.
+struct LazyIndex {
+	// Index of the traits of an object in the context.
+	size_t traits;
+	// Dense values of arrays, sealed values of objects, values of object
+	// vectors and alternating keys and values of dictionaries.
+	std::vector<LazyPosition> values;
+	// Associative members of arrays and dynamic members of objects.
+	std::vector<std::pair<AmfStringView, LazyPosition>> members;
+	// The position right after the container.
+	LazyPosition after;
+};
+
+// The input and reference tables shared by a LazyDeserializer and its
+// handles.
+//
+// Reading a part of the input for the first time adds its strings, traits
+// and objects to the tables. The input is always read in stream order, so a
+// table entry is new exactly if the table size at the current position (as
+// counted while reading) equals the size of the table, i.e. re-reading input
+// doesn't add entries again.
+class LazyDocument {
+public:
+	LazyDocument(const u8* data, size_t size) :
+		data(data), end(data + size), ctx(STRINGS_IN_INPUT) { }
+
+	AmfStringView readString(const u8*& it, LazyPosition& tables);
+	size_t readTraits(int type, const u8*& it, LazyPosition& tables);
+	void skip(const u8*& it, LazyPosition& tables);
+	size_t resolve(const LazyPosition& pos, u8 marker);
+	const LazyIndex& index(size_t object);
+	AmfItemPtr materialize(const LazyPosition& pos);
+	void materialize(const LazyPosition& pos, AmfDenseArray& dense);
+	bool find(LazyPosition& pos, const AmfPath& path, size_t first);
+
+	const u8* objectStart(size_t object) const {
+		return data + objects[object].pos.offset;
+	}
+
+	const u8* data;
+	const u8* end;
+	DeserializationContext ctx;
+
+private:
+	struct Object {
+		// Position of the type marker and table sizes before the object.
+		LazyPosition pos;
+		std::unique_ptr<LazyIndex> index;
+		AmfItemPtr item;
+	};
+
+	size_t addObject(const u8* start, LazyPosition& tables);
+	void walkContents(u8 marker, int type, const u8*& it, LazyPosition& tables, LazyIndex* index);
+	bool step(LazyPosition& pos, const AmfPath::Step& step);
+	bool stepIndexed(const LazyIndex& index, u8 marker, const AmfPath::Step& step, LazyPosition& pos);
+	bool readKey(const u8*& it, LazyPosition& tables, const AmfPath::Step& step);
+	bool skipTo(size_t index, size_t count, const u8*& it, LazyPosition& tables, LazyPosition& pos);
+	LazyPosition position(const u8* it, const LazyPosition& tables) const {
+		LazyPosition pos = tables;
+		pos.offset = it - data;
+		return pos;
+	}
+
+	std::vector<Object> objects;
+};
+
+static size_t read_count(int type) {
+	int count = type >> 1;
+	if (count < 0)
+		throw std::invalid_argument("LazyDeserializer: Invalid length");
+
+	return count;
+}
+
+static void skip_bytes(const u8*& it, const u8* end, size_t count) {
+	if (static_cast<size_t>(end - it) < count)
+		throw std::out_of_range("LazyDeserializer: Not enough bytes");
+
+	it += count;
+}
+
+template<typename T>
+static AmfItemPtr decode_leaf(const u8* it, const u8* end) {
+	// Leaf values don't contain references, so the tables aren't needed.
+	DeserializationContext ctx;
+	return AmfItemPtr(new T(T::deserialize(it, end, ctx)));
+}
+
+AmfStringView LazyDocument::readString(const u8*& it, LazyPosition& tables) {
+	int type = AmfInteger::deserializeValue(it, end);
+	if ((type & 0x01) == 0) {
+		// ctx may have more strings when re-reading input, which aren't
+		// defined yet at this position
+		size_t index = type >> 1;
+		if (index >= tables.strings)
+			throw std::out_of_range("LazyDeserializer: Invalid string reference");
+
+		return ctx.getString(index);
+	}
+
+	size_t length = read_count(type);
+	if (static_cast<size_t>(end - it) < length)
+		throw std::out_of_range("Not enough bytes for AmfString");
+
+	AmfStringView str(reinterpret_cast<const char*>(it), length);
+	it += length;
+
+	// UTF-8-empty isn't added to the table.
+	if (length > 0) {
+		if (tables.strings == ctx.stringsCount())
+			ctx.addString(str);
+
+		++tables.strings;
+	}
+
+	return str;
+}
+
+size_t LazyDocument::readTraits(int type, const u8*& it, LazyPosition& tables) {
+	if ((type & 0x03) == 0x01) {
+		// U29O-traits-ref
+		size_t index = type >> 2;
+		if (index >= tables.traits)
+			throw std::out_of_range("LazyDeserializer: Invalid traits reference");
+
+		return index;
+	}
+
+	if (tables.traits == ctx.traitsCount()) {
+		// New traits, so their strings are new as well.
+		size_t strings = ctx.stringsCount();
+		size_t index = AmfObject::deserializeTraits(type, it, end, ctx);
+		tables.strings += ctx.stringsCount() - strings;
+		++tables.traits;
+		return index;
+	}
+
+	// Traits read before, only skip them.
+	readString(it, tables);
+	if ((type & 0x07) == 0x03) {
+		int sealed = type >> 4;
+		for (int i = 0; i < sealed; ++i)
+			readString(it, tables);
+	}
+
+	return tables.traits++;
+}
+
+size_t LazyDocument::addObject(const u8* start, LazyPosition& tables) {
+	if (tables.objects == objects.size()) {
+		Object object;
+		object.pos = position(start, tables);
+		objects.push_back(std::move(object));
+	}
+
+	return tables.objects++;
+}
+
+// Reads the value at it, adding new table entries, without decoding it.
+void LazyDocument::skip(const u8*& it, LazyPosition& tables) {
+	if (it == end)
+		throw std::out_of_range("LazyDeserializer: End of input");
+
+	const u8* start = it;
+	u8 marker = *it++;
+	switch (marker) {
+		case AMF_UNDEFINED:
+		case AMF_NULL:
+		case AMF_FALSE:
+		case AMF_TRUE:
+			return;
+		case AMF_INTEGER:
+			AmfInteger::deserializeValue(it, end);
+			return;
+		case AMF_DOUBLE:
+			skip_bytes(it, end, 8);
+			return;
+		case AMF_STRING:
+			readString(it, tables);
+			return;
+	}
+
+	if (marker > AMF_DICTIONARY)
+		throw std::invalid_argument("LazyDeserializer: Invalid type byte");
+
+	int type = AmfInteger::deserializeValue(it, end);
+	if ((type & 0x01) == 0) {
+		if (static_cast<size_t>(type >> 1) >= tables.objects)
+			throw std::out_of_range("LazyDeserializer: Invalid object reference");
+
+		return;
+	}
+
+	size_t object = addObject(start, tables);
+	switch (marker) {
+		case AMF_XMLDOC:
+		case AMF_XML:
+		case AMF_BYTEARRAY:
+			skip_bytes(it, end, read_count(type));
+			return;
+		case AMF_DATE:
+			skip_bytes(it, end, 8);
+			return;
+		case AMF_VECTOR_INT:
+		case AMF_VECTOR_UINT:
+			skip_bytes(it, end, 1 + read_count(type) * 4);
+			return;
+		case AMF_VECTOR_DOUBLE:
+			skip_bytes(it, end, 1 + read_count(type) * 8);
+			return;
+	}
+
+	// Containers that have been indexed can be skipped right away.
+	const LazyIndex* index = objects[object].index.get();
+	if (index != nullptr) {
+		it = data + index->after.offset;
+		tables = index->after;
+		return;
+	}
+
+	walkContents(marker, type, it, tables, nullptr);
+}
+
+// Reads the contents of a container after its U29 value type, recording the
+// positions of the members in index if it isn't null.
+void LazyDocument::walkContents(u8 marker, int type, const u8*& it,
+	LazyPosition& tables, LazyIndex* index) {
+	bool pairs = false;
+	size_t count = 0;
+
+	switch (marker) {
+		case AMF_ARRAY:
+			// associative until UTF-8-empty
+			while (true) {
+				AmfStringView key = readString(it, tables);
+				if (key.empty()) break;
+
+				if (index != nullptr)
+					index->members.emplace_back(key, position(it, tables));
+				skip(it, tables);
+			}
+
+			count = read_count(type);
+			break;
+		case AMF_OBJECT: {
+			size_t traits = readTraits(type, it, tables);
+			const AmfObjectTraits& objectTraits = ctx.getTraits(traits);
+			if (objectTraits.externalizable)
+				throw std::invalid_argument("LazyDeserializer: Externalizable objects are not supported");
+
+			if (index != nullptr)
+				index->traits = traits;
+			count = objectTraits.getAttriutes().size();
+			pairs = objectTraits.dynamic;
+			break;
+		}
+		case AMF_VECTOR_OBJECT:
+			count = read_count(type);
+			// fixed flag and object type name
+			skip_bytes(it, end, 1);
+			readString(it, tables);
+			break;
+		case AMF_DICTIONARY:
+			count = read_count(type) * 2;
+			// weak keys flag
+			skip_bytes(it, end, 1);
+			break;
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		if (index != nullptr)
+			index->values.push_back(position(it, tables));
+		skip(it, tables);
+	}
+
+	// dynamic members until UTF-8-empty
+	while (pairs) {
+		AmfStringView name = readString(it, tables);
+		if (name.empty()) break;
+
+		if (index != nullptr)
+			index->members.emplace_back(name, position(it, tables));
+		skip(it, tables);
+	}
+}
+
+// Returns the object table index of the complex value at pos, following
+// object references. Throws std::bad_cast if it isn't of type marker.
+size_t LazyDocument::resolve(const LazyPosition& pos, u8 marker) {
+	const u8* it = data + pos.offset;
+	if (it == end || *it != marker)
+		throw std::bad_cast();
+
+	++it;
+	int type = AmfInteger::deserializeValue(it, end);
+	if ((type & 0x01) == 0) {
+		size_t object = type >> 1;
+		if (object >= pos.objects)
+			throw std::out_of_range("LazyDeserializer: Invalid object reference");
+		if (data[objects[object].pos.offset] != marker)
+			throw std::invalid_argument("LazyDeserializer: Object reference of wrong type");
+
+		return object;
+	}
+
+	LazyPosition tables = pos;
+	return addObject(data + pos.offset, tables);
+}
+
+const LazyIndex& LazyDocument::index(size_t object) {
+	if (objects[object].index)
+		return *objects[object].index;
+
+	std::unique_ptr<LazyIndex> index(new LazyIndex());
+	LazyPosition tables = objects[object].pos;
+	const u8* it = data + tables.offset;
+
+	u8 marker = *it++;
+	int type = AmfInteger::deserializeValue(it, end);
+	++tables.objects;
+
+	walkContents(marker, type, it, tables, index.get());
+	index->after = position(it, tables);
+
+	// walkContents may have added objects, so look it up again.
+	objects[object].index = std::move(index);
+	return *objects[object].index;
+}
+
+AmfItemPtr LazyDocument::materialize(const LazyPosition& pos) {
+	const u8* it = data + pos.offset;
+	if (it == end)
+		throw std::out_of_range("LazyDeserializer: End of input");
+
+	u8 marker = *it++;
+	switch (marker) {
+		case AMF_UNDEFINED:
+			return AmfItemPtr(new AmfUndefined());
+		case AMF_NULL:
+			return AmfItemPtr(new AmfNull());
+		case AMF_FALSE:
+		case AMF_TRUE:
+			return AmfItemPtr(new AmfBool(marker == AMF_TRUE));
+		case AMF_INTEGER:
+			return AmfItemPtr(new AmfInteger(AmfInteger::deserializeValue(it, end)));
+		case AMF_DOUBLE:
+			return AmfItemPtr(new AmfDouble(read_network<double>(it, end)));
+		case AMF_STRING: {
+			LazyPosition tables = pos;
+			return AmfItemPtr(new AmfString(readString(it, tables).str()));
+		}
+	}
+
+	if (marker > AMF_DICTIONARY)
+		throw std::invalid_argument("LazyDeserializer: Invalid type byte");
+
+	size_t object = resolve(pos, marker);
+	if (objects[object].item.get() != nullptr)
+		return objects[object].item;
+
+	const u8* start = data + objects[object].pos.offset;
+	switch (marker) {
+		case AMF_XMLDOC:
+			return objects[object].item = decode_leaf<AmfXmlDocument>(start, end);
+		case AMF_DATE:
+			return objects[object].item = decode_leaf<AmfDate>(start, end);
+		case AMF_XML:
+			return objects[object].item = decode_leaf<AmfXml>(start, end);
+		case AMF_BYTEARRAY:
+			return objects[object].item = decode_leaf<AmfByteArray>(start, end);
+		case AMF_VECTOR_INT:
+			return objects[object].item = decode_leaf<AmfVector<int>>(start, end);
+		case AMF_VECTOR_UINT:
+			return objects[object].item = decode_leaf<AmfVector<unsigned int>>(start, end);
+		case AMF_VECTOR_DOUBLE:
+			return objects[object].item = decode_leaf<AmfVector<double>>(start, end);
+	}
+
+	// Containers are stored before decoding their members, which may refer
+	// back to them.
+	const LazyIndex& members = index(object);
+	AmfItemPtr item;
+
+	switch (marker) {
+		case AMF_ARRAY: {
+			item = AmfItemPtr(new AmfArray());
+			objects[object].item = item;
+
+			AmfArray& array = item.as<AmfArray>();
+			array.associative.reserve(members.members.size());
+			array.dense.reserve(members.values.size());
+			for (const auto& it : members.members)
+				array.associative[AmfAtom(it.first)] = materialize(it.second);
+			for (const LazyPosition& it : members.values)
+				materialize(it, array.dense);
+			break;
+		}
+		case AMF_OBJECT: {
+			item = AmfItemPtr(new AmfObject(ctx.getTraitsPtr(members.traits)));
+			objects[object].item = item;
+
+			AmfObject& obj = item.as<AmfObject>();
+			for (size_t i = 0; i < obj.sealedValues.size(); ++i)
+				obj.sealedValues[i] = materialize(members.values[i]);
+			obj.dynamicProperties.reserve(members.members.size());
+			for (const auto& it : members.members)
+				obj.dynamicProperties[AmfAtom(it.first)] = materialize(it.second);
+			break;
+		}
+		case AMF_VECTOR_OBJECT: {
+			// U29V value, fixed flag and object type name, which have been read
+			// by index() already
+			LazyPosition tables = objects[object].pos;
+			const u8* p = start + 1;
+			AmfInteger::deserializeValue(p, end);
+			bool fixed = (*p++ == 0x01);
+			std::string name = readString(p, tables).str();
+
+			item = AmfItemPtr(new AmfVector<AmfItem>(name, fixed));
+			objects[object].item = item;
+
+			AmfVector<AmfItem>& vec = item.as<AmfVector<AmfItem>>();
+			vec.values.reserve(members.values.size());
+			for (const LazyPosition& it : members.values)
+				vec.values.push_back(materialize(it));
+			break;
+		}
+		case AMF_DICTIONARY: {
+			const u8* p = start + 1;
+			AmfInteger::deserializeValue(p, end);
+			bool weak = (*p == 0x01);
+
+			item = AmfItemPtr(new AmfDictionary(false, weak));
+			objects[object].item = item;
+
+			AmfDictionary& dict = item.as<AmfDictionary>();
+			for (size_t i = 0; i + 1 < members.values.size(); i += 2) {
+				AmfItemPtr key = materialize(members.values[i]);
+				dict.values[key] = materialize(members.values[i + 1]);
+			}
+			break;
+		}
+	}
+
+	return item;
+}
+
+// Appends the value at pos to a dense array. Scalars are pushed as plain
+// values, so that the array stays packed as long as they have the same type.
+void LazyDocument::materialize(const LazyPosition& pos, AmfDenseArray& dense) {
+	const u8* it = data + pos.offset;
+	if (it != end && dense.packed()) {
+		u8 marker = *it++;
+		switch (marker) {
+			case AMF_FALSE:
+			case AMF_TRUE:
+				dense.pushBool(marker == AMF_TRUE);
+				return;
+			case AMF_INTEGER:
+				dense.pushInteger(AmfInteger::deserializeValue(it, end));
+				return;
+			case AMF_DOUBLE:
+				dense.pushDouble(read_network<double>(it, end));
+				return;
+			case AMF_STRING: {
+				LazyPosition tables = pos;
+				dense.pushString(readString(it, tables).str());
+				return;
+			}
+		}
+	}
+
+	dense.push_back(materialize(pos));
+}
+
+// Follows path from the value at pos, starting with step first. Returns false
+// if the path doesn't match.
+bool LazyDocument::find(LazyPosition& pos, const AmfPath& path, size_t first) {
+	const std::vector<AmfPath::Step>& steps = path.steps();
+	for (size_t i = first; i < steps.size(); ++i)
+		if (!step(pos, steps[i]))
+			return false;
+
+	return true;
+}
+
+bool LazyDocument::step(LazyPosition& pos, const AmfPath::Step& step) {
+	const u8* it = data + pos.offset;
+	if (it == end)
+		throw std::out_of_range("LazyDeserializer: End of input");
+
+	u8 marker = *it;
+	if (marker != AMF_ARRAY && marker != AMF_OBJECT &&
+		marker != AMF_VECTOR_OBJECT && marker != AMF_DICTIONARY)
+		return false;
+
+	size_t object = resolve(pos, marker);
+	if (objects[object].index)
+		return stepIndexed(*objects[object].index, marker, step, pos);
+
+	// Read the container in stream order up to the selected member, without
+	// indexing it.
+	LazyPosition tables = objects[object].pos;
+	it = data + tables.offset + 1;
+	int type = AmfInteger::deserializeValue(it, end);
+	++tables.objects;
+
+	switch (marker) {
+		case AMF_ARRAY:
+			// associative until UTF-8-empty
+			while (true) {
+				AmfStringView key = readString(it, tables);
+				if (key.empty()) break;
+
+				if (!step.byIndex && key == step.key) {
+					pos = position(it, tables);
+					return true;
+				}
+				skip(it, tables);
+			}
+
+			return step.byIndex && skipTo(step.index, read_count(type), it, tables, pos);
+		case AMF_OBJECT: {
+			if (step.byIndex)
+				return false;
+
+			// The traits may be moved by reading the members, so look up the
+			// member before.
+			const AmfObjectTraits& objectTraits = ctx.getTraits(readTraits(type, it, tables));
+			if (objectTraits.externalizable)
+				throw std::invalid_argument("LazyDeserializer: Externalizable objects are not supported");
+
+			const std::vector<std::string>& names = objectTraits.getAttriutes();
+			size_t sealed = names.size();
+			bool dynamic = objectTraits.dynamic;
+			size_t member = std::find(names.begin(), names.end(), step.key) - names.begin();
+
+			if (member < sealed)
+				return skipTo(member, sealed, it, tables, pos);
+			if (!dynamic)
+				return false;
+
+			for (size_t i = 0; i < sealed; ++i)
+				skip(it, tables);
+
+			// dynamic members until UTF-8-empty
+			while (true) {
+				AmfStringView name = readString(it, tables);
+				if (name.empty()) break;
+
+				if (name == step.key) {
+					pos = position(it, tables);
+					return true;
+				}
+				skip(it, tables);
+			}
+
+			return false;
+		}
+		case AMF_VECTOR_OBJECT: {
+			if (!step.byIndex)
+				return false;
+
+			size_t count = read_count(type);
+			// fixed flag and object type name
+			skip_bytes(it, end, 1);
+			readString(it, tables);
+			return skipTo(step.index, count, it, tables, pos);
+		}
+		default: {
+			// AMF_DICTIONARY
+			size_t count = read_count(type);
+			// weak keys flag
+			skip_bytes(it, end, 1);
+
+			for (size_t i = 0; i < count; ++i) {
+				if (readKey(it, tables, step)) {
+					pos = position(it, tables);
+					return true;
+				}
+				skip(it, tables);
+			}
+
+			return false;
+		}
+	}
+}
+
+bool LazyDocument::stepIndexed(const LazyIndex& index, u8 marker,
+	const AmfPath::Step& step, LazyPosition& pos) {
+	const std::vector<LazyPosition>& values = index.values;
+
+	if (marker == AMF_DICTIONARY) {
+		for (size_t i = 0; i + 1 < values.size(); i += 2) {
+			LazyPosition tables = values[i];
+			const u8* it = data + tables.offset;
+			if (readKey(it, tables, step)) {
+				pos = values[i + 1];
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	if (step.byIndex) {
+		if (marker == AMF_OBJECT || step.index >= values.size())
+			return false;
+
+		pos = values[step.index];
+		return true;
+	}
+
+	if (marker == AMF_OBJECT) {
+		const std::vector<std::string>& names = ctx.getTraits(index.traits).getAttriutes();
+		for (size_t i = 0; i < names.size(); ++i) {
+			if (names[i] == step.key) {
+				pos = values[i];
+				return true;
+			}
+		}
+	}
+
+	// associative members of arrays and dynamic members of objects
+	for (const auto& it : index.members) {
+		if (it.first == step.key) {
+			pos = it.second;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Reads a dictionary key, returning whether step selects it.
+bool LazyDocument::readKey(const u8*& it, LazyPosition& tables, const AmfPath::Step& step) {
+	if (it != end && *it == AMF_STRING && !step.byIndex) {
+		++it;
+		return readString(it, tables) == step.key;
+	}
+
+	if (it != end && *it == AMF_INTEGER && step.byIndex) {
+		++it;
+		int key = AmfInteger::deserializeValue(it, end);
+		return key >= 0 && static_cast<size_t>(key) == step.index;
+	}
+
+	skip(it, tables);
+	return false;
+}
+
+// Skips to value index of count values starting at it.
+bool LazyDocument::skipTo(size_t index, size_t count, const u8*& it,
+	LazyPosition& tables, LazyPosition& pos) {
+	if (index >= count)
+		return false;
+
+	for (size_t i = 0; i < index; ++i)
+		skip(it, tables);
+
+	pos = position(it, tables);
+	return true;
+}
+
+AmfMarker AmfLazyValue::type() const {
+	const u8* it = doc->data + pos.offset;
+	if (it == doc->end)
+		throw std::out_of_range("LazyDeserializer: End of input");
+	if (*it > AMF_DICTIONARY)
+		throw std::invalid_argument("LazyDeserializer: Invalid type byte");
+
+	return static_cast<AmfMarker>(*it);
+}
+
+bool AmfLazyValue::asBool() const {
+	AmfMarker marker = type();
+	if (marker != AMF_TRUE && marker != AMF_FALSE)
+		throw std::bad_cast();
+
+	return marker == AMF_TRUE;
+}
+
+int AmfLazyValue::asInt() const {
+	if (type() != AMF_INTEGER)
+		throw std::bad_cast();
+
+	const u8* it = doc->data + pos.offset + 1;
+	return AmfInteger::deserializeValue(it, doc->end);
+}
+
+double AmfLazyValue::asDouble() const {
+	if (type() != AMF_DOUBLE)
+		throw std::bad_cast();
+
+	const u8* it = doc->data + pos.offset + 1;
+	return read_network<double>(it, doc->end);
+}
+
+std::string AmfLazyValue::asString() const {
+	return stringView().str();
+}
+
+AmfStringView AmfLazyValue::stringView() const {
+	if (type() != AMF_STRING)
+		throw std::bad_cast();
+
+	const u8* it = doc->data + pos.offset + 1;
+	LazyPosition tables = pos;
+	return doc->readString(it, tables);
+}
+
+size_t AmfLazyValue::size() const {
+	AmfMarker marker = type();
+	switch (marker) {
+		case AMF_ARRAY:
+		case AMF_VECTOR_OBJECT:
+			return doc->index(doc->resolve(pos, marker)).values.size();
+		case AMF_DICTIONARY:
+			return doc->index(doc->resolve(pos, marker)).values.size() / 2;
+		case AMF_VECTOR_INT:
+		case AMF_VECTOR_UINT:
+		case AMF_VECTOR_DOUBLE: {
+			// the U29V value after the marker
+			const u8* it = doc->objectStart(doc->resolve(pos, marker)) + 1;
+			return read_count(AmfInteger::deserializeValue(it, doc->end));
+		}
+		default:
+			throw std::bad_cast();
+	}
+}
+
+AmfLazyValue AmfLazyValue::at(size_t index) const {
+	AmfMarker marker = type();
+	if (marker != AMF_ARRAY && marker != AMF_VECTOR_OBJECT)
+		throw std::bad_cast();
+
+	return AmfLazyValue(doc, doc->index(doc->resolve(pos, marker)).values.at(index));
+}
+
+AmfLazyValue AmfLazyValue::at(const std::string& key) const {
+	const LazyIndex& index = doc->index(doc->resolve(pos, AMF_ARRAY));
+	for (const auto& it : index.members)
+		if (it.first == key)
+			return AmfLazyValue(doc, it.second);
+
+	throw std::out_of_range("AmfLazyValue::at: No such key");
+}
+
+const AmfObjectTraits& AmfLazyValue::objectTraits() const {
+	return doc->ctx.getTraits(doc->index(doc->resolve(pos, AMF_OBJECT)).traits);
+}
+
+AmfLazyValue AmfLazyValue::getSealedProperty(const std::string& name) const {
+	const LazyIndex& index = doc->index(doc->resolve(pos, AMF_OBJECT));
+	const std::vector<std::string>& names = doc->ctx.getTraits(index.traits).getAttriutes();
+
+	for (size_t i = 0; i < names.size(); ++i)
+		if (names[i] == name)
+			return AmfLazyValue(doc, index.values[i]);
+
+	throw std::out_of_range("AmfLazyValue::getSealedProperty");
+}
+
+AmfLazyValue AmfLazyValue::getDynamicProperty(const std::string& name) const {
+	const LazyIndex& index = doc->index(doc->resolve(pos, AMF_OBJECT));
+	for (const auto& it : index.members)
+		if (it.first == name)
+			return AmfLazyValue(doc, it.second);
+
+	throw std::out_of_range("AmfLazyValue::getDynamicProperty");
+}
+
+AmfLazyValue AmfLazyValue::keyAt(size_t index) const {
+	return AmfLazyValue(doc, doc->index(doc->resolve(pos, AMF_DICTIONARY)).values.at(index * 2));
+}
+
+AmfLazyValue AmfLazyValue::valueAt(size_t index) const {
+	return AmfLazyValue(doc, doc->index(doc->resolve(pos, AMF_DICTIONARY)).values.at(index * 2 + 1));
+}
+
+AmfItemPtr AmfLazyValue::materialize() const {
+	return doc->materialize(pos);
+}
+
+AmfLazyValue AmfLazyValue::find(const AmfPath& path) const {
+	LazyPosition result = pos;
+	if (!doc->find(result, path, 0))
+		throw std::out_of_range("AmfLazyValue::find: Path doesn't match");
+
+	return AmfLazyValue(doc, result);
+}
+
+LazyDeserializer::LazyDeserializer(const u8* data, size_t size) :
+	doc(std::make_shared<LazyDocument>(data, size)), pending(false) {
+	current.offset = 0;
+	current.strings = 0;
+	current.traits = 0;
+	current.objects = 0;
+}
+
+void LazyDeserializer::skipCurrent() {
+	if (!pending)
+		return;
+
+	const u8* it = doc->data + current.offset;
+	doc->skip(it, current);
+	current.offset = it - doc->data;
+	pending = false;
+}
+
+AmfLazyValue LazyDeserializer::next() {
+	skipCurrent();
+	if (doc->data + current.offset == doc->end)
+		throw std::out_of_range("LazyDeserializer::next: End of input");
+
+	pending = true;
+	return AmfLazyValue(doc, current);
+}
+
+bool LazyDeserializer::finished() {
+	skipCurrent();
+	return doc->data + current.offset == doc->end;
+}
+
+DeserializationContext& LazyDeserializer::context() {
+	return doc->ctx;
+}
+
+// Reads an AMF0 UTF-8 string, i.e. U16 length (in network order) U8* value.
+LazyPacket::LazyPacket(const u8* data, size_t size) :
+	data(data), end(data + size), pending(nullptr), messageTotal(0), messagesCounted(false) {
+	const u8* it = data;
+	if (!AmfPacketIndex::readVersion(it, end))
+		throw std::out_of_range("Not enough bytes for AmfPacket");
+
+	headerTotal = read_network<uint16_t>(it, end);
+	cursor = it;
+}
+
+// Skips the value of the last entry read, if any, and returns the position
+// after it.
+const u8* LazyPacket::skipPending() {
+	if (pending != nullptr) {
+		if (pending->valueEnd != nullptr) {
+			cursor = pending->valueEnd;
+		} else {
+			LazyPosition tables = pending->value;
+			pending->doc->skip(cursor, tables);
+		}
+		pending = nullptr;
+	}
+
+	return cursor;
+}
+
+void LazyPacket::readEntry(std::vector<Entry>& entries, bool isHeader) {
+	const u8* it = skipPending();
+
+	AmfPacketIndex::Framing framing;
+	if (!AmfPacketIndex::readFraming(it, end, isHeader, framing))
+		throw std::out_of_range("LazyPacket: Not enough bytes");
+
+	Entry entry;
+	entry.name = framing.name;
+	entry.response = framing.response;
+	entry.mustUnderstand = framing.mustUnderstand;
+
+	// A known length bounds the value, like in AmfPacketIndex.
+	entry.valueEnd = nullptr;
+	const u8* value_end = end;
+	if (framing.valueLength != AmfPacketIndex::unknownLength)
+		value_end = entry.valueEnd = it + framing.valueLength;
+
+	// Every value has its own reference tables.
+	entry.doc = std::make_shared<LazyDocument>(data, value_end - data);
+	entry.value.offset = it - data;
+	entry.value.strings = 0;
+	entry.value.traits = 0;
+	entry.value.objects = 0;
+
+	entries.push_back(entry);
+	cursor = it;
+	pending = &entries.back();
+}
+
+void LazyPacket::readMessageCount() {
+	if (messagesCounted)
+		return;
+
+	while (headers.size() < headerTotal)
+		readEntry(headers, true);
+
+	const u8* it = skipPending();
+	messageTotal = read_network<uint16_t>(it, end);
+	cursor = it;
+	messagesCounted = true;
+}
+
+const LazyPacket::Entry& LazyPacket::headerEntry(size_t index) {
+	if (index >= headerTotal)
+		throw std::out_of_range("LazyPacket: No such header");
+
+	while (headers.size() <= index)
+		readEntry(headers, true);
+
+	return headers[index];
+}
+
+const LazyPacket::Entry& LazyPacket::messageEntry(size_t index) {
+	if (index >= messageCount())
+		throw std::out_of_range("LazyPacket: No such message");
+
+	while (messages.size() <= index)
+		readEntry(messages, false);
+
+	return messages[index];
+}
+
+std::string LazyPacket::headerName(size_t index) {
+	return headerEntry(index).name.str();
+}
+
+bool LazyPacket::headerMustUnderstand(size_t index) {
+	return headerEntry(index).mustUnderstand;
+}
+
+AmfLazyValue LazyPacket::header(size_t index) {
+	const Entry& entry = headerEntry(index);
+	return AmfLazyValue(entry.doc, entry.value);
+}
+
+AmfLazyValue LazyPacket::header(const std::string& name) {
+	return header(headerIndex(name));
+}
+
+// Returns the index of the first header called name. Throws
+// std::out_of_range if there is none.
+size_t LazyPacket::headerIndex(const std::string& name) {
+	for (size_t i = 0; i < headerTotal; ++i)
+		if (headerEntry(i).name == name)
+			return i;
+
+	throw std::out_of_range("LazyPacket: No such header");
+}
+
+size_t LazyPacket::messageCount() {
+	readMessageCount();
+	return messageTotal;
+}
+
+std::string LazyPacket::messageTarget(size_t index) {
+	return messageEntry(index).name.str();
+}
+
+std::string LazyPacket::messageResponse(size_t index) {
+	return messageEntry(index).response.str();
+}
+
+AmfLazyValue LazyPacket::message(size_t index) {
+	const Entry& entry = messageEntry(index);
+	return AmfLazyValue(entry.doc, entry.value);
+}
+
+AmfLazyValue LazyPacket::find(const AmfPath& path) {
+	const std::vector<AmfPath::Step>& steps = path.steps();
+	if (steps.size() < 2 || steps[0].byIndex)
+		throw std::out_of_range("LazyPacket::find: Path doesn't match");
+
+	const Entry* entry;
+	const AmfPath::Step& step = steps[1];
+	if (steps[0].key == "headers" && step.byIndex && step.index < headerTotal) {
+		entry = &headerEntry(step.index);
+	} else if (steps[0].key == "headers" && !step.byIndex) {
+		entry = &headerEntry(headerIndex(step.key));
+	} else if (steps[0].key == "messages" && step.byIndex && step.index < messageCount()) {
+		entry = &messageEntry(step.index);
+	} else {
+		throw std::out_of_range("LazyPacket::find: Path doesn't match");
+	}
+
+	LazyPosition pos = entry->value;
+	if (!entry->doc->find(pos, path, 2))
+		throw std::out_of_range("LazyPacket::find: Path doesn't match");
+
+	return AmfLazyValue(entry->doc, pos);
+}
+
+} // namespace amf
@@ -0,0 +1,192 @@
+#pragma once
+#ifndef LAZYDESERIALIZER_HPP
+#define LAZYDESERIALIZER_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "amf.hpp"
+#include "deserializationcontext.hpp"
+#include "types/amfitem.hpp"
+#include "utils/amfitemptr.hpp"
+#include "utils/amfobjecttraits.hpp"
+#include "utils/amfstringview.hpp"
+
+namespace amf {
+
+class AmfPath;
+class LazyDocument;
+
+// A position in the input, along with the sizes of the string, traits and
+// object reference tables at that position.
+struct LazyPosition {
+	size_t offset;
+	size_t strings;
+	size_t traits;
+	size_t objects;
+};
+
+// A handle to a value in the input of a LazyDeserializer, which is only
+// decoded as far as the accessors called on it require. Containers build an
+// index of the positions of their members on first access, so accessing
+// several members of the same container doesn't re-read it.
+//
+// Accessors throw std::bad_cast if the value has a different type, and
+// std::invalid_argument or std::out_of_range on malformed input.
+class AmfLazyValue {
+public:
+	AmfLazyValue(std::shared_ptr<LazyDocument> doc, LazyPosition pos) :
+		doc(doc), pos(pos) { }
+
+	// The type marker of the value (or of the referenced value, for object
+	// references).
+	AmfMarker type() const;
+
+	bool asBool() const;
+	int asInt() const;
+	double asDouble() const;
+	std::string asString() const;
+	// A view into the input buffer.
+	AmfStringView stringView() const;
+
+	// The number of dense values of an array, or the number of values of a
+	// vector or dictionary.
+	size_t size() const;
+
+	// Dense values of arrays and values of object vectors.
+	AmfLazyValue at(size_t index) const;
+	// Associative values of arrays.
+	AmfLazyValue at(const std::string& key) const;
+
+	// The traits of an object.
+	// WARNING: the reference is only valid until the next access that reads
+	//          new traits from the input.
+	const AmfObjectTraits& objectTraits() const;
+	AmfLazyValue getSealedProperty(const std::string& name) const;
+	AmfLazyValue getDynamicProperty(const std::string& name) const;
+
+	// Keys and values of dictionaries.
+	AmfLazyValue keyAt(size_t index) const;
+	AmfLazyValue valueAt(size_t index) const;
+
+	// The value selected by path. Unlike the accessors above, this doesn't
+	// index the containers along the path, but only reads them up to the
+	// selected member. Throws std::out_of_range if the path doesn't match.
+	AmfLazyValue find(const AmfPath& path) const;
+
+	// Fully decodes the value. Objects are decoded only once, so repeated
+	// calls (and references to the value) return the same AmfItemPtr.
+	AmfItemPtr materialize() const;
+
+	template<typename T>
+	T as() const {
+		return materialize().as<T>();
+	}
+
+private:
+	std::shared_ptr<LazyDocument> doc;
+	LazyPosition pos;
+};
+
+// Deserializes a sequence of top-level AMF3 values lazily, i.e. returns
+// handles to values that are decoded on access. This is useful if only a few
+// members of large values are needed.
+//
+// The reference tables are filled in stream order as far as accessed values
+// require, so accessing a value reads (but doesn't decode) all input before
+// it. Externalizable objects are not supported, as they can't be skipped.
+//
+// The input is not copied and must outlive the deserializer and all handles.
+class LazyDeserializer {
+public:
+	LazyDeserializer(const u8* data, size_t size);
+	LazyDeserializer(const v8& data) : LazyDeserializer(data.data(), data.size()) { }
+	LazyDeserializer(v8&& data) = delete;
+
+	// Returns a handle to the next top-level value, skipping over the
+	// previous one. Throws std::out_of_range at the end of the input.
+	AmfLazyValue next();
+
+	// Whether all top-level values have been returned.
+	bool finished();
+
+	// The string and traits tables read so far.
+	DeserializationContext& context();
+
+private:
+	void skipCurrent();
+
+	std::shared_ptr<LazyDocument> doc;
+	LazyPosition current;
+	bool pending;
+};
+
+// Gives lazy access to the headers and messages of a serialized AmfPacket.
+// Like with the LazyDeserializer, headers and messages are only read as far as
+// needed, and their values are decoded on access. Every value has its own
+// reference tables.
+//
+// The input is not copied and must outlive the packet and all handles.
+class LazyPacket {
+public:
+	// Throws std::out_of_range or std::invalid_argument if data doesn't start
+	// with a packet version and header count.
+	LazyPacket(const u8* data, size_t size);
+	LazyPacket(const v8& data) : LazyPacket(data.data(), data.size()) { }
+	LazyPacket(v8&& data) = delete;
+
+	size_t headerCount() const { return headerTotal; }
+	std::string headerName(size_t index);
+	bool headerMustUnderstand(size_t index);
+	AmfLazyValue header(size_t index);
+	// Throws std::out_of_range if there is no such header.
+	AmfLazyValue header(const std::string& name);
+
+	size_t messageCount();
+	std::string messageTarget(size_t index);
+	std::string messageResponse(size_t index);
+	AmfLazyValue message(size_t index);
+
+	// The value selected by path, which starts with a header (`headers[0]` or
+	// `headers["name"]`) or message (`messages[0]`), e.g.
+	// `messages[0].body[0].user.id`. Throws std::out_of_range if the path
+	// doesn't match.
+	AmfLazyValue find(const AmfPath& path);
+
+private:
+	struct Entry {
+		// The header name or message target URI.
+		AmfStringView name;
+		AmfStringView response;
+		bool mustUnderstand;
+		// The end of the value if the packet gives its length, nullptr
+		// otherwise.
+		const u8* valueEnd;
+		std::shared_ptr<LazyDocument> doc;
+		LazyPosition value;
+	};
+
+	const Entry& headerEntry(size_t index);
+	const Entry& messageEntry(size_t index);
+	size_t headerIndex(const std::string& name);
+	void readEntry(std::vector<Entry>& entries, bool isHeader);
+	void readMessageCount();
+	const u8* skipPending();
+
+	const u8* data;
+	const u8* end;
+	// The position after the last framing read, i.e. at the value of the
+	// last entry if pending.
+	const u8* cursor;
+	const Entry* pending;
+	size_t headerTotal;
+	size_t messageTotal;
+	bool messagesCounted;
+	std::vector<Entry> headers;
+	std::vector<Entry> messages;
+};
+
+} // namespace amf
+
+#endif
@@ -2,55 +2,202 @@
 #ifndef SERIALIZATIONCONTEXT_HPP
 #define SERIALIZATIONCONTEXT_HPP
 
+#include <iterator>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "amf.hpp"
+#include "amfatom.hpp"
 #include "utils/amfitemptr.hpp"
 #include "utils/amfobjecttraits.hpp"
 
 namespace amf {
 
+// Determines when two objects (i.e. arrays, objects, dates, byte arrays, XML,
+// vectors and dictionaries) are serialized as references to each other.
+enum ObjectReferenceMode {
+	// Only the very same instance is serialized as reference. This correctly
+	// encodes shared and cyclic subgraphs, but requires that all serialized
+	// items outlive the context (or rather, its next clear()), as a new item
+	// allocated at the address of a destroyed one would be encoded as
+	// reference to the destroyed item.
+	REFERENCE_BY_IDENTITY,
+	// Any object that compares equal to a previously serialized object is
+	// serialized as reference. This requires storing a copy of every object
+	// and comparing it against all previous ones.
+	REFERENCE_BY_VALUE
+};
+
 class SerializationContext {
 public:
-	SerializationContext() { }
+	// The size of the reference tables at some point, see checkpoint().
+	struct Checkpoint {
+		int strings;
+		size_t traits;
+		int objects;
+	};
+
+	SerializationContext(ObjectReferenceMode mode = REFERENCE_BY_IDENTITY) :
+		stringCount(0), minStringRefLength(0), objectCount(0), mode(mode) { }
 
 	void clear() {
 		strings.clear();
+		atomIds.clear();
+		stringCount = 0;
 		traits.clear();
+		traitIds.clear();
 		objects.clear();
+		objectIndices.clear();
+		objectCount = 0;
+	}
+
+	Checkpoint checkpoint() const {
+		Checkpoint checkpoint = { stringCount, traits.size(), objectCount };
+		return checkpoint;
+	}
+
+	// Removes the strings, traits and objects added since checkpoint was
+	// taken, e.g. to discard a value that has been serialized partially or
+	// doesn't fit into the output. This takes time linear in the size of the
+	// tables, but costs nothing while serializing.
+	void rollback(const Checkpoint& checkpoint) {
+		for (auto it = strings.begin(); it != strings.end(); )
+			it = it->second >= checkpoint.strings ? strings.erase(it) : std::next(it);
+		for (auto it = atomIds.begin(); it != atomIds.end(); )
+			it = it->second >= checkpoint.strings ? atomIds.erase(it) : std::next(it);
+		stringCount = checkpoint.strings;
+
+		for (auto it = traits.begin(); it != traits.end(); )
+			it = static_cast<size_t>(it->second) >= checkpoint.traits ? traits.erase(it) : std::next(it);
+		for (auto it = traitIds.begin(); it != traitIds.end(); )
+			it = static_cast<size_t>(it->second) >= checkpoint.traits ? traitIds.erase(it) : std::next(it);
+
+		for (auto it = objectIndices.begin(); it != objectIndices.end(); )
+			it = it->second >= checkpoint.objects ? objectIndices.erase(it) : std::next(it);
+		if (objects.size() > static_cast<size_t>(checkpoint.objects))
+			objects.erase(objects.begin() + checkpoint.objects, objects.end());
+		objectCount = checkpoint.objects;
+	}
+
+	ObjectReferenceMode referenceMode() const {
+		return mode;
+	}
+
+	// Forgets which instances have been serialized so far, while keeping the
+	// reference indices in sync with the deserializer. Afterwards, previously
+	// serialized items may safely be destroyed, but will no longer be
+	// serialized as reference. Does nothing when comparing by value.
+	void releaseObjects() {
+		objectIndices.clear();
+	}
+
+	// Strings shorter than this are neither looked up nor stored in the
+	// string table, i.e. they are always serialized inline. This saves the
+	// hashing overhead for strings that are barely longer than a reference.
+	// Note that such strings still count towards the reference indices, as
+	// the deserializer adds every inline string to its table.
+	void setMinStringReferenceLength(size_t length) {
+		minStringRefLength = length;
 	}
 
 	void addString(const std::string& str) {
-		strings.push_back(str);
+		if (str.size() >= minStringRefLength)
+			strings.emplace(str, stringCount);
+
+		++stringCount;
+	}
+
+	void addString(const AmfAtom& str) {
+		if (str.size() >= minStringRefLength && str.id() != 0)
+			atomIds.emplace(str.id(), stringCount);
+
+		addString(str.str());
 	}
 
 	void addTraits(const AmfObjectTraits& trait) {
-		traits.push_back(trait);
+		int index = static_cast<int>(traits.size());
+		traits.emplace(trait, index);
+		if (trait.getId() != 0)
+			traitIds.emplace(trait.getId(), index);
 	}
 
 	template<typename T>
 	void addObject(const T & obj) {
-		objects.emplace_back(new T(obj));
+		if (mode == REFERENCE_BY_IDENTITY)
+			objectIndices.emplace(&obj, objectCount);
+		else
+			objects.emplace_back(new T(obj));
+
+		++objectCount;
+	}
+
+	// Assigns the next reference index to an object that is serialized
+	// without an AmfItem (e.g. by the AmfWriter), so it can't be found by
+	// getIndex. Returns its index.
+	int addAnonymousObject() {
+		if (mode == REFERENCE_BY_VALUE)
+			objects.emplace_back();
+
+		return objectCount++;
 	}
 
 	int getIndex(const std::string& str) {
-		auto it = std::find(strings.begin(), strings.end(), str);
+		if (str.size() < minStringRefLength)
+			return -1;
+
+		auto it = strings.find(str);
 		if (it == strings.end())
 			return -1;
 
-		return it - strings.begin();
+		return it->second;
 	}
 
-	int getIndex(const AmfObjectTraits& str) {
-		auto it = std::find(traits.begin(), traits.end(), str);
+	// Interned atoms are found by id, without hashing the string.
+	int getIndex(const AmfAtom& str) {
+		if (str.id() == 0)
+			return getIndex(str.str());
+
+		auto id = atomIds.find(str.id());
+		if (id != atomIds.end())
+			return id->second;
+
+		int index = getIndex(str.str());
+		if (index != -1)
+			atomIds.emplace(str.id(), index);
+
+		return index;
+	}
+
+	int getIndex(const AmfObjectTraits& trait) {
+		// Interned traits are found by id, without hashing and comparing
+		// the names of their attributes.
+		if (trait.getId() != 0) {
+			auto id = traitIds.find(trait.getId());
+			if (id != traitIds.end())
+				return id->second;
+		}
+
+		auto it = traits.find(trait);
 		if (it == traits.end())
 			return -1;
 
-		return it - traits.begin();
+		if (trait.getId() != 0)
+			traitIds.emplace(trait.getId(), it->second);
+
+		return it->second;
 	}
 
 	template<typename T>
 	int getIndex(const T & obj) const {
+		if (mode == REFERENCE_BY_IDENTITY) {
+			auto it = objectIndices.find(&obj);
+			if (it == objectIndices.end())
+				return -1;
+
+			return it->second;
+		}
+
 		for (size_t i = 0; i < objects.size(); ++i) {
 			const T* typeval = objects[i].asPtr<T>();
 
@@ -62,9 +209,20 @@ public:
 	}
 
 private:
-	std::vector<std::string> strings;
-	std::vector<AmfObjectTraits> traits;
+	// Maps each value to its reference index, i.e. its insertion order.
+	std::unordered_map<std::string, int> strings;
+	// Reference indices of interned atoms by their id.
+	std::unordered_map<size_t, int> atomIds;
+	int stringCount;
+	size_t minStringRefLength;
+	std::unordered_map<AmfObjectTraits, int, AmfObjectTraitsHash> traits;
+	// Reference indices of interned traits by their id.
+	std::unordered_map<size_t, int> traitIds;
+	// Only one of these is used, depending on the reference mode.
 	std::vector<AmfItemPtr> objects;
+	std::unordered_map<const AmfItem*, int> objectIndices;
+	int objectCount;
+	ObjectReferenceMode mode;
 };
 
 } // namespace amf
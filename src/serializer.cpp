@@ -5,10 +5,22 @@
 namespace amf {
 
 Serializer& Serializer::operator<<(const AmfItem& item) {
-	std::vector<u8> serialized = item.serialize(ctx);
-	buf.insert(buf.end(), serialized.begin(), serialized.end());
+	// Items append their serialized data directly to the output buffer.
+	item.serialize(buf, ctx);
+
+	// Serialized items are usually temporaries, so we can't keep referring
+	// to them by address once the top-level item is done.
+	ctx.releaseObjects();
 
 	return *this;
 }
 
+size_t Serializer::measure(const AmfItem& item) {
+	SerializationContext::Checkpoint checkpoint = ctx.checkpoint();
+	size_t size = item.serializedSize(ctx);
+	ctx.rollback(checkpoint);
+
+	return size;
+}
+
 } // namespace amf
@@ -11,9 +11,22 @@ namespace amf {
 
 class AmfItem;
 
+// Serializes a sequence of top-level items into a single buffer. Strings,
+// traits and (when comparing by value) objects are referenced across items.
+// When referencing objects by identity, only objects within the same
+// top-level item are serialized as reference, as the items passed in may be
+// destroyed right after serializing them.
 class Serializer {
 public:
+	// The state of the output and the reference tables at some point, see
+	// checkpoint().
+	struct Checkpoint {
+		size_t size;
+		SerializationContext::Checkpoint context;
+	};
+
 	Serializer() { }
+	Serializer(SerializationContext ctx) : ctx(ctx) { }
 	~Serializer() { }
 
 	Serializer& operator<<(const AmfItem& item);
@@ -21,6 +34,27 @@ public:
 	const std::vector<u8> & data() const { return buf; }
 	void clear() { buf.clear(); ctx.clear(); }
 
+	// The exact number of bytes operator<< would append for item, e.g. to
+	// reserve the output buffer or to send a length before the data. The
+	// reference tables are left unchanged.
+	size_t measure(const AmfItem& item);
+
+	Checkpoint checkpoint() const {
+		Checkpoint checkpoint = { buf.size(), ctx.checkpoint() };
+		return checkpoint;
+	}
+
+	// Discards the data and references of all items serialized since
+	// checkpoint was taken.
+	void rollback(const Checkpoint& checkpoint) {
+		buf.resize(checkpoint.size);
+		ctx.rollback(checkpoint.context);
+	}
+
+	// Pre-allocates the output buffer if the (approximate) size of the
+	// serialized data is known in advance.
+	void reserve(size_t size) { buf.reserve(size); }
+
 private:
 	SerializationContext ctx;
 	std::vector<u8> buf;
@@ -3,17 +3,80 @@
 #include "deserializationcontext.hpp"
 #include "deserializer.hpp"
 #include "serializationcontext.hpp"
+#include "types/amfbool.hpp"
+#include "types/amfdouble.hpp"
 #include "types/amfinteger.hpp"
 #include "types/amfstring.hpp"
 
 namespace amf {
 
+// Writes the dense values, directly from their packed form if possible.
+static void serialize_dense(v8& buf, const AmfDenseArray& dense, SerializationContext& ctx) {
+	switch (dense.storageType()) {
+		case AmfDenseArray::EMPTY:
+			break;
+		case AmfDenseArray::INTEGERS:
+			for (int value : dense.integers())
+				AmfInteger(value).serialize(buf, ctx);
+			break;
+		case AmfDenseArray::DOUBLES:
+			for (double value : dense.doubles())
+				AmfDouble(value).serialize(buf, ctx);
+			break;
+		case AmfDenseArray::BOOLS:
+			for (bool value : dense.bools())
+				AmfBool(value).serialize(buf, ctx);
+			break;
+		case AmfDenseArray::STRINGS:
+			for (const std::string& value : dense.strings()) {
+				buf.push_back(AMF_STRING);
+				AmfString::serializeValue(buf, value, ctx);
+			}
+			break;
+		case AmfDenseArray::ITEMS:
+			for (const auto& it : dense.items())
+				it->serialize(buf, ctx);
+			break;
+	}
+}
+
+static size_t dense_size(const AmfDenseArray& dense, SerializationContext& ctx) {
+	size_t size = 0;
+
+	switch (dense.storageType()) {
+		case AmfDenseArray::EMPTY:
+			break;
+		case AmfDenseArray::INTEGERS:
+			for (int value : dense.integers())
+				size += AmfInteger(value).serializedSize(ctx);
+			break;
+		case AmfDenseArray::DOUBLES:
+			// marker and 8 bytes each
+			size = dense.doubles().size() * 9;
+			break;
+		case AmfDenseArray::BOOLS:
+			// just the marker
+			size = dense.bools().size();
+			break;
+		case AmfDenseArray::STRINGS:
+			for (const std::string& value : dense.strings())
+				size += 1 + AmfString::valueSize(value, ctx);
+			break;
+		case AmfDenseArray::ITEMS:
+			for (const auto& it : dense.items())
+				size += it->serializedSize(ctx);
+			break;
+	}
+
+	return size;
+}
+
 bool AmfArray::operator==(const AmfItem& other) const {
-	const AmfArray* p = dynamic_cast<const AmfArray*>(&other);
+	const AmfArray* p = item_cast<AmfArray>(&other);
 	return p != nullptr && dense == p->dense && associative == p->associative;
 }
 
-std::vector<u8> AmfArray::serialize(SerializationContext& ctx) const {
+void AmfArray::serialize(v8& buf, SerializationContext& ctx) const {
 	/*
 	 * array-marker
 	 * (
@@ -21,39 +84,53 @@ std::vector<u8> AmfArray::serialize(SerializationContext& ctx) const {
 	 * 	(U29A-value *(assoc-value) UTF-8-empty *(value-type))
 	 * )
 	 */
+	buf.push_back(AMF_ARRAY);
 
 	int index = ctx.getIndex(*this);
-	if (index != -1)
-		return std::vector<u8> { AMF_ARRAY, u8(index << 1) };
+	if (index != -1) {
+		AmfInteger::serializeReference(buf, index);
+		return;
+	}
 	ctx.addObject(*this);
 
 	// U29A-value
-	std::vector<u8> buf = AmfInteger::asLength(dense.size(), AMF_ARRAY);
+	AmfInteger::serializeLength(buf, dense.size());
 
 	// *(assoc-value) = (UTF-8-vr value-type)
 	for (const auto& it : associative) {
-		auto name = AmfString(it.first).serializeValue(ctx);
-		auto value = it.second->serialize(ctx);
-
 		// UTF-8-vr
-		buf.insert(buf.end(), name.begin(), name.end());
+		AmfString::serializeValue(buf, it.first, ctx);
 		// value-type
-		buf.insert(buf.end(), value.begin(), value.end());
+		it.second->serialize(buf, ctx);
 	}
 
 	// UTF-8-empty
 	buf.push_back(0x01);
 
 	// *(value-type)
-	for (const auto& it : dense) {
-		auto s = it->serialize(ctx);
-		buf.insert(buf.end(), s.begin(), s.end());
+	serialize_dense(buf, dense, ctx);
+}
+
+size_t AmfArray::serializedSize(SerializationContext& ctx) const {
+	int index = ctx.getIndex(*this);
+	if (index != -1)
+		return 1 + AmfInteger::referenceSize(index);
+	ctx.addObject(*this);
+
+	size_t size = 1 + AmfInteger::lengthSize(dense.size());
+
+	for (const auto& it : associative) {
+		size += AmfString::valueSize(it.first, ctx);
+		size += it.second->serializedSize(ctx);
 	}
 
-	return buf;
+	// UTF-8-empty
+	size += 1;
+
+	return size + dense_size(dense, ctx);
 }
 
-AmfItemPtr AmfArray::deserializePtr(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+AmfItemPtr AmfArray::deserializePtr(const u8*& it, const u8* end, DeserializationContext& ctx) {
 	if (it == end || *it++ != AMF_ARRAY)
 		throw std::invalid_argument("AmfArray: Invalid type marker");
 
@@ -64,29 +141,52 @@ AmfItemPtr AmfArray::deserializePtr(v8::const_iterator& it, v8::const_iterator e
 	// Create the return value and store it in the deserialization context.
 	// By having the context point to the actual array we're constructing here
 	// instead of a copy, we enable circular references.
-	AmfItemPtr ret(new AmfArray());
+	AmfItemPtr ret = ctx.createItem<AmfArray>();
 	ctx.addPointer(ret);
 
 	AmfArray & array = ret.as<AmfArray>();
 
 	// associative until UTF-8-empty
 	while (true) {
-		std::string name = AmfString::deserializeValue(it, end, ctx);
-		if (name == "") break;
+		AmfStringView name = AmfString::deserializeView(it, end, ctx);
+		if (name.empty()) break;
 
 		AmfItemPtr val = Deserializer::deserialize(it, end, ctx);
-		array.associative[name] = val;
+		array.associative[AmfAtom(name)] = val;
 	}
 
-	// dense
+	// dense, packed until the first value of another type than the previous
+	// ones (or one that isn't a number, boolean or string)
 	int length = type >> 1;
-	for (int i = 0; i < length; ++i)
-		array.dense.push_back(Deserializer::deserialize(it, end, ctx));
+	// every value takes at least one byte, so this doesn't trust the length
+	array.dense.reserve(std::min<size_t>(length, end - it));
+	for (int i = 0; i < length; ++i) {
+		u8 marker = it != end && array.dense.packed() ? *it : static_cast<u8>(AMF_UNDEFINED);
+		switch (marker) {
+			case AMF_INTEGER:
+				++it;
+				array.dense.pushInteger(AmfInteger::deserializeValue(it, end));
+				break;
+			case AMF_DOUBLE:
+				array.dense.pushDouble(AmfDouble::deserialize(it, end, ctx).value);
+				break;
+			case AMF_FALSE:
+			case AMF_TRUE:
+				array.dense.pushBool(AmfBool::deserialize(it, end, ctx).value);
+				break;
+			case AMF_STRING:
+				++it;
+				array.dense.pushString(AmfString::deserializeValue(it, end, ctx));
+				break;
+			default:
+				array.dense.push_back(Deserializer::deserialize(it, end, ctx));
+		}
+	}
 
 	return ret;
 }
 
-AmfArray AmfArray::deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+AmfArray AmfArray::deserialize(const u8*& it, const u8* end, DeserializationContext& ctx) {
 	return deserializePtr(it, end, ctx).as<AmfArray>();
 }
 
@@ -6,7 +6,9 @@
 #include <string>
 
 #include "types/amfitem.hpp"
+#include "utils/amfdensearray.hpp"
 #include "utils/amfitemptr.hpp"
+#include "utils/amforderedmap.hpp"
 
 namespace amf {
 
@@ -15,16 +17,17 @@ class DeserializationContext;
 
 class AmfArray : public AmfItem {
 public:
-	AmfArray() { }
+	AmfArray() : AmfItem(AMF_ARRAY) { }
 
 	template<class V>
-	AmfArray(std::vector<V> densePart) {
+	AmfArray(std::vector<V> densePart) : AmfItem(AMF_ARRAY) {
 		for (const V& it : densePart)
 			push_back(it);
 	}
 
 	template<class V, class A>
-	AmfArray(std::vector<V> densePart, std::map<std::string, A> associativePart) {
+	AmfArray(std::vector<V> densePart, std::map<std::string, A> associativePart) :
+		AmfItem(AMF_ARRAY) {
 		for (const V& it : densePart)
 			push_back(it);
 
@@ -36,7 +39,7 @@ public:
 	void push_back(const T& item) {
 		static_assert(std::is_base_of<AmfItem, T>::value, "Elements must extend AmfItem");
 
-		dense.emplace_back(new T(item));
+		dense.push_back(item);
 	}
 
 	template<class T>
@@ -51,8 +54,11 @@ public:
 		return dense.at(index).as<T>();
 	}
 
+	// Returns integers, doubles, booleans and strings by value, as they may be
+	// packed (see AmfDenseArray).
 	template<class T>
-	const T& at(int index) const {
+	typename AmfDenseConstRef<T>::type at(int index) const {
+		static_assert(!std::is_same<T, AmfItem>::value, "Use dense.at() to access values as AmfItem");
 		return dense.at(index).as<T>();
 	}
 
@@ -67,14 +73,27 @@ public:
 	}
 
 	bool operator==(const AmfItem& other) const;
-	std::vector<u8> serialize(SerializationContext& ctx) const;
-	static AmfItemPtr deserializePtr(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx);
-	static AmfArray deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx);
+	using AmfItem::serialize;
+	void serialize(v8& buf, SerializationContext& ctx) const;
+	size_t serializedSize(SerializationContext& ctx) const;
+	static AmfItemPtr deserializePtr(const u8*& it, const u8* end, DeserializationContext& ctx);
+	static AmfItemPtr deserializePtr(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+		return with_pointers(deserializePtr, it, end, ctx);
+	}
+	static AmfArray deserialize(const u8*& it, const u8* end, DeserializationContext& ctx);
+	static AmfArray deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+		return with_pointers(deserialize, it, end, ctx);
+	}
 
-	std::vector<AmfItemPtr> dense;
-	std::map<std::string, AmfItemPtr> associative;
+	// Dense values, packed if they all have the same scalar type.
+	AmfDenseArray dense;
+	// Associative members in the order they were added or deserialized.
+	AmfOrderedMap<AmfItemPtr> associative;
 };
 
+template<>
+struct AmfItemTypeTag<AmfArray> : AmfTaggedType<AMF_ARRAY> { };
+
 } // namespace amf
 
 #endif
@@ -4,11 +4,11 @@ namespace amf
 {
 
 bool AmfBool::operator==(const AmfItem& other) const {
-	const AmfBool* p = dynamic_cast<const AmfBool*>(&other);
+	const AmfBool* p = item_cast<AmfBool>(&other);
 	return p != nullptr && value == p->value;
 }
 
-AmfBool AmfBool::deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext&) {
+AmfBool AmfBool::deserialize(const u8*& it, const u8* end, DeserializationContext&) {
 	if (it == end)
 		throw std::invalid_argument("AmfBool: End of iterator");
 
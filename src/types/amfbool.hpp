@@ -11,20 +11,28 @@ class DeserializationContext;
 
 class AmfBool : public AmfItem {
 public:
-	AmfBool(bool v) : value(v) { }
+	AmfBool(bool v) : AmfItem(AMF_TRUE), value(v) { }
 	operator bool() const { return value; }
 
 	bool operator==(const AmfItem& other) const;
 
-	std::vector<u8> serialize(SerializationContext&) const {
-		return std::vector<u8>{ value ? AMF_TRUE : AMF_FALSE };
+	using AmfItem::serialize;
+	size_t serializedSize(SerializationContext&) const { return 1; }
+	void serialize(v8& buf, SerializationContext&) const {
+		buf.push_back(value ? AMF_TRUE : AMF_FALSE);
 	}
 
-	static AmfBool deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext&);
+	static AmfBool deserialize(const u8*& it, const u8* end, DeserializationContext&);
+	static AmfBool deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+		return with_pointers(deserialize, it, end, ctx);
+	}
 
 	bool value;
 };
 
+template<>
+struct AmfItemTypeTag<AmfBool> : AmfTaggedType<AMF_TRUE> { };
+
 } // namespace amf
 
 #endif
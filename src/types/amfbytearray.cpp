@@ -7,23 +7,34 @@
 namespace amf {
 
 bool AmfByteArray::operator==(const AmfItem& other) const {
-	const AmfByteArray* p = dynamic_cast<const AmfByteArray*>(&other);
+	const AmfByteArray* p = item_cast<AmfByteArray>(&other);
 	return p != nullptr && value == p->value;
 }
 
-std::vector<u8> AmfByteArray::serialize(SerializationContext& ctx) const {
+void AmfByteArray::serialize(v8& buf, SerializationContext& ctx) const {
+	buf.push_back(AMF_BYTEARRAY);
+
 	int index = ctx.getIndex(*this);
-	if (index != -1)
-		return std::vector<u8> { AMF_BYTEARRAY, u8(index << 1) };
+	if (index != -1) {
+		AmfInteger::serializeReference(buf, index);
+		return;
+	}
 	ctx.addObject(*this);
 
-	std::vector<u8> buf = AmfInteger::asLength(value.size(), AMF_BYTEARRAY);
+	AmfInteger::serializeLength(buf, value.size());
 	buf.insert(buf.end(), value.begin(), value.end());
+}
+
+size_t AmfByteArray::serializedSize(SerializationContext& ctx) const {
+	int index = ctx.getIndex(*this);
+	if (index != -1)
+		return 1 + AmfInteger::referenceSize(index);
+	ctx.addObject(*this);
 
-	return buf;
+	return 1 + AmfInteger::lengthSize(value.size()) + value.size();
 }
 
-AmfByteArray AmfByteArray::deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+AmfByteArray AmfByteArray::deserialize(const u8*& it, const u8* end, DeserializationContext& ctx) {
 	if (it == end || *it++ != AMF_BYTEARRAY)
 		throw std::invalid_argument("AmfByteArray: Invalid type marker");
 
@@ -11,28 +11,36 @@ class DeserializationContext;
 
 class AmfByteArray : public AmfItem {
 public:
-	AmfByteArray() { }
-	AmfByteArray(const AmfByteArray& other) : value(other.value) { }
+	AmfByteArray() : AmfItem(AMF_BYTEARRAY) { }
+	AmfByteArray(const AmfByteArray& other) : AmfItem(other), value(other.value) { }
 
 	template<typename T>
-	AmfByteArray(const T& v) {
+	AmfByteArray(const T& v) : AmfItem(AMF_BYTEARRAY) {
 		using std::begin;
 		using std::end;
 		value = std::vector<u8>(begin(v), end(v));
 	}
 
 	template<typename T>
-	AmfByteArray(T begin, T end) {
+	AmfByteArray(T begin, T end) : AmfItem(AMF_BYTEARRAY) {
 		value = std::vector<u8>(begin, end);
 	}
 
 	bool operator==(const AmfItem& other) const;
-	std::vector<u8> serialize(SerializationContext& ctx) const;
-	static AmfByteArray deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx);
+	using AmfItem::serialize;
+	void serialize(v8& buf, SerializationContext& ctx) const;
+	size_t serializedSize(SerializationContext& ctx) const;
+	static AmfByteArray deserialize(const u8*& it, const u8* end, DeserializationContext& ctx);
+	static AmfByteArray deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+		return with_pointers(deserialize, it, end, ctx);
+	}
 
 	std::vector<u8> value;
 };
 
+template<>
+struct AmfItemTypeTag<AmfByteArray> : AmfTaggedType<AMF_BYTEARRAY> { };
+
 } // namespace amf
 
 #endif
@@ -2,42 +2,51 @@
 
 #include "deserializationcontext.hpp"
 #include "serializationcontext.hpp"
-#include "types/amfdouble.hpp"
 #include "types/amfinteger.hpp"
 
 namespace amf {
 
-AmfDate::AmfDate(std::chrono::system_clock::time_point date) {
+AmfDate::AmfDate(std::chrono::system_clock::time_point date) : AmfItem(AMF_DATE) {
 	auto duration = date.time_since_epoch();
 	value = std::chrono::duration_cast<std::chrono::milliseconds>(
 		duration).count();
 }
 
 bool AmfDate::operator==(const AmfItem& other) const {
-	const AmfDate* p = dynamic_cast<const AmfDate*>(&other);
+	const AmfDate* p = item_cast<AmfDate>(&other);
 	return p != nullptr && value == p->value;
 }
 
-std::vector<u8> AmfDate::serialize(SerializationContext& ctx) const {
+void AmfDate::serialize(v8& buf, SerializationContext& ctx) const {
 	// AmfDate is date-marker (U29O-ref | (U29D-value date-time)),
 	// where U29D-value is 1 and date-time is a int64 describing the number of
 	// milliseconds since epoch, encoded as double
+	buf.push_back(AMF_DATE);
+
 	int index = ctx.getIndex(*this);
-	if (index != -1)
-		return std::vector<u8> { AMF_DATE, u8(index << 1) };
+	if (index != -1) {
+		AmfInteger::serializeReference(buf, index);
+		return;
+	}
 	ctx.addObject(*this);
 
-	std::vector<u8> buf { AMF_DATE, 0x01 };
+	buf.push_back(0x01);
 
 	// dates are serialised as double, ignoring the precision loss
-	std::vector<u8> date(AmfDouble(static_cast<double>(value)).serialize(ctx));
-	// skip the AMF_DOUBLE marker
-	buf.insert(buf.end(), date.begin() + 1, date.end());
+	write_network(buf, static_cast<double>(value));
+}
+
+size_t AmfDate::serializedSize(SerializationContext& ctx) const {
+	int index = ctx.getIndex(*this);
+	if (index != -1)
+		return 1 + AmfInteger::referenceSize(index);
+	ctx.addObject(*this);
 
-	return buf;
+	// U29D-value and date-time
+	return 1 + 1 + 8;
 }
 
-AmfDate AmfDate::deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+AmfDate AmfDate::deserialize(const u8*& it, const u8* end, DeserializationContext& ctx) {
 	if (it == end || *it++ != AMF_DATE)
 		throw std::invalid_argument("AmfDate: Invalid type marker");
 
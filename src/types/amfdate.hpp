@@ -20,17 +20,25 @@ namespace {
 class AmfDate : public AmfItem {
 public:
 	// millisconds since epoch
-	AmfDate(long long date) : value(date) { }
-	AmfDate(std::tm* date) : value(mktime(date) * MSEC_PER_SEC) { }
+	AmfDate(long long date) : AmfItem(AMF_DATE), value(date) { }
+	AmfDate(std::tm* date) : AmfItem(AMF_DATE), value(mktime(date) * MSEC_PER_SEC) { }
 	AmfDate(std::chrono::system_clock::time_point date);
 
 	bool operator==(const AmfItem& other) const;
-	std::vector<u8> serialize(SerializationContext& ctx) const;
-	static AmfDate deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx);
+	using AmfItem::serialize;
+	void serialize(v8& buf, SerializationContext& ctx) const;
+	size_t serializedSize(SerializationContext& ctx) const;
+	static AmfDate deserialize(const u8*& it, const u8* end, DeserializationContext& ctx);
+	static AmfDate deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+		return with_pointers(deserialize, it, end, ctx);
+	}
 
 	long long value;
 };
 
+template<>
+struct AmfItemTypeTag<AmfDate> : AmfTaggedType<AMF_DATE> { };
+
 } // namespace amf
 
 #endif
@@ -25,33 +25,50 @@ size_t AmfDictionaryHash::operator()(const AmfItemPtr& val) const {
 }
 
 bool AmfDictionary::operator==(const AmfItem& other) const {
-	const AmfDictionary* p = dynamic_cast<const AmfDictionary*>(&other);
+	const AmfDictionary* p = item_cast<AmfDictionary>(&other);
 	return p != nullptr && asString == p->asString && weak == p->weak &&
 		values == p->values;
 }
 
-std::vector<u8> AmfDictionary::serialize(SerializationContext & ctx) const {
+void AmfDictionary::serialize(v8& buf, SerializationContext & ctx) const {
+	buf.push_back(AMF_DICTIONARY);
+
 	int index = ctx.getIndex(*this);
-	if (index != -1)
-		return std::vector<u8> { AMF_DICTIONARY, u8(index << 1) };
+	if (index != -1) {
+		AmfInteger::serializeReference(buf, index);
+		return;
+	}
 	ctx.addObject(*this);
 
-	std::vector<u8> buf = AmfInteger::asLength(values.size(), AMF_DICTIONARY);
+	AmfInteger::serializeLength(buf, values.size());
 
 	buf.push_back(weak ? 0x01 : 0x00);
 
-	for (auto it : values) {
+	for (const auto& it : values) {
 		// convert key's value to string if necessary
-		auto k = serializeKey(it.first, ctx);
-		auto v = it.second->serialize(ctx);
-		buf.insert(buf.end(), k.begin(), k.end());
-		buf.insert(buf.end(), v.begin(), v.end());
+		serializeKey(buf, it.first, ctx);
+		it.second->serialize(buf, ctx);
+	}
+}
+
+size_t AmfDictionary::serializedSize(SerializationContext& ctx) const {
+	int index = ctx.getIndex(*this);
+	if (index != -1)
+		return 1 + AmfInteger::referenceSize(index);
+	ctx.addObject(*this);
+
+	// marker, U29Dict-value and weak keys marker
+	size_t size = 1 + AmfInteger::lengthSize(values.size()) + 1;
+
+	for (const auto& it : values) {
+		size += keySize(it.first, ctx);
+		size += it.second->serializedSize(ctx);
 	}
 
-	return buf;
+	return size;
 }
 
-AmfItemPtr AmfDictionary::deserializePtr(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+AmfItemPtr AmfDictionary::deserializePtr(const u8*& it, const u8* end, DeserializationContext& ctx) {
 	if (it == end || *it++ != AMF_DICTIONARY)
 		throw std::invalid_argument("AmfDictionary: Invalid type marker");
 
@@ -64,7 +81,7 @@ AmfItemPtr AmfDictionary::deserializePtr(v8::const_iterator& it, v8::const_itera
 
 	bool weak = (*it++ == 0x01);
 
-	AmfItemPtr ptr(new AmfDictionary(false, weak));
+	AmfItemPtr ptr = ctx.createItem<AmfDictionary>(false, weak);
 	AmfDictionary & dict = ptr.as<AmfDictionary>();
 	ctx.addPointer(ptr);
 
@@ -78,41 +95,55 @@ AmfItemPtr AmfDictionary::deserializePtr(v8::const_iterator& it, v8::const_itera
 	return ptr;
 }
 
-AmfDictionary AmfDictionary::deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+AmfDictionary AmfDictionary::deserialize(const u8*& it, const u8* end, DeserializationContext& ctx) {
 	return deserializePtr(it, end, ctx).as<AmfDictionary>();
 }
 
-v8 AmfDictionary::serializeKey(const AmfItemPtr& key, SerializationContext& ctx) const {
-	if (!asString)
-		return key->serialize(ctx);
-
-	const AmfInteger* intval = key.asPtr<AmfInteger>();
-	if (intval != nullptr) {
-		std::string strval = std::to_string(intval->value);
-		return AmfString(strval).serialize(ctx);
+// Converts keys that the Flash Player would convert to strings as well (i.e.
+// numbers, booleans, undefined and null) into str. Returns false for other
+// keys.
+static bool key_as_string(const AmfItemPtr& key, std::string& str) {
+	switch (key->typeTag()) {
+		case AMF_INTEGER:
+			str = std::to_string(key.as<AmfInteger>().value);
+			return true;
+		case AMF_DOUBLE: {
+			std::ostringstream stream;
+			stream << std::setprecision(std::numeric_limits<double>::digits10)
+			       << key.as<AmfDouble>().value;
+			str = stream.str();
+			return true;
+		}
+		case AMF_TRUE:
+			str = key.as<AmfBool>().value ? "true" : "false";
+			return true;
+		case AMF_UNDEFINED:
+			str = "undefined";
+			return true;
+		case AMF_NULL:
+			str = "null";
+			return true;
 	}
 
-	const AmfDouble* doubleval = key.asPtr<AmfDouble>();
-	if (doubleval != nullptr) {
-		std::ostringstream str;
-		str << std::setprecision(std::numeric_limits<double>::digits10)
-		    << doubleval->value;
-		return AmfString(str.str()).serialize(ctx);
-	}
+	return false;
+}
 
-	const AmfBool* boolval = key.asPtr<AmfBool>();
-	if (boolval != nullptr)
-		return AmfString(boolval->value ? "true" : "false").serialize(ctx);
+void AmfDictionary::serializeKey(v8& buf, const AmfItemPtr& key, SerializationContext& ctx) const {
+	std::string str;
+	if (asString && key_as_string(key, str)) {
+		AmfString(str).serialize(buf, ctx);
+		return;
+	}
 
-	const AmfUndefined* undefinedval = key.asPtr<AmfUndefined>();
-	if (undefinedval != nullptr)
-		return AmfString("undefined").serialize(ctx);
+	key->serialize(buf, ctx);
+}
 
-	const AmfNull* nullval = key.asPtr<AmfNull>();
-	if (nullval != nullptr)
-		return AmfString("null").serialize(ctx);
+size_t AmfDictionary::keySize(const AmfItemPtr& key, SerializationContext& ctx) const {
+	std::string str;
+	if (asString && key_as_string(key, str))
+		return 1 + AmfString::valueSize(str, ctx);
 
-	return key->serialize(ctx);
+	return key->serializedSize(ctx);
 }
 
 } // namespace amf
@@ -19,7 +19,7 @@ struct AmfDictionaryHash {
 class AmfDictionary : public AmfItem {
 public:
 	AmfDictionary(bool numbersAsStrings, bool weak = false) :
-		asString(numbersAsStrings), weak(weak) { }
+		AmfItem(AMF_DICTIONARY), asString(numbersAsStrings), weak(weak) { }
 
 	bool operator==(const AmfItem& other) const;
 
@@ -40,9 +40,17 @@ public:
 		values.clear();
 	}
 
-	std::vector<u8> serialize(SerializationContext & ctx) const;
-	static AmfItemPtr deserializePtr(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx);
-	static AmfDictionary deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx);
+	using AmfItem::serialize;
+	void serialize(v8& buf, SerializationContext & ctx) const;
+	size_t serializedSize(SerializationContext& ctx) const;
+	static AmfItemPtr deserializePtr(const u8*& it, const u8* end, DeserializationContext& ctx);
+	static AmfItemPtr deserializePtr(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+		return with_pointers(deserializePtr, it, end, ctx);
+	}
+	static AmfDictionary deserialize(const u8*& it, const u8* end, DeserializationContext& ctx);
+	static AmfDictionary deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+		return with_pointers(deserialize, it, end, ctx);
+	}
 
 	bool asString;
 	bool weak;
@@ -61,9 +69,13 @@ private:
 
 	// Flash Player doesn't support deserializing booleans and number types
 	// (AmfInteger/AmfDouble), so we may have to serialize them as strings
-	v8 serializeKey(const AmfItemPtr& key, SerializationContext& ctx) const;
+	void serializeKey(v8& buf, const AmfItemPtr& key, SerializationContext& ctx) const;
+	size_t keySize(const AmfItemPtr& key, SerializationContext& ctx) const;
 };
 
+template<>
+struct AmfItemTypeTag<AmfDictionary> : AmfTaggedType<AMF_DICTIONARY> { };
+
 } // namespace amf
 
 #endif
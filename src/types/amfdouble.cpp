@@ -3,19 +3,16 @@
 namespace amf {
 
 bool AmfDouble::operator==(const AmfItem& other) const {
-	const AmfDouble* p = dynamic_cast<const AmfDouble*>(&other);
+	const AmfDouble* p = item_cast<AmfDouble>(&other);
 	return p != nullptr && value == p->value;
 }
 
-std::vector<u8> AmfDouble::serialize(SerializationContext&) const {
-	std::vector<u8> buf = { AMF_DOUBLE };
-
-	v8 bytes = network_bytes(value);
-	buf.insert(buf.end(), bytes.begin(), bytes.end());
-	return buf;
+void AmfDouble::serialize(v8& buf, SerializationContext&) const {
+	buf.push_back(AMF_DOUBLE);
+	write_network(buf, value);
 }
 
-AmfDouble AmfDouble::deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext&) {
+AmfDouble AmfDouble::deserialize(const u8*& it, const u8* end, DeserializationContext&) {
 	if (it == end || *it++ != AMF_DOUBLE)
 		throw std::invalid_argument("AmfDouble: Invalid type marker");
 
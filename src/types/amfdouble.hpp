@@ -11,17 +11,25 @@ class DeserializationContext;
 
 class AmfDouble : public AmfItem {
 public:
-	AmfDouble() : value(0) { }
-	AmfDouble(double v) : value(v) { }
+	AmfDouble() : AmfItem(AMF_DOUBLE), value(0) { }
+	AmfDouble(double v) : AmfItem(AMF_DOUBLE), value(v) { }
 	operator double() const { return value; }
 
 	bool operator==(const AmfItem& other) const;
-	std::vector<u8> serialize(SerializationContext&) const;
-	static AmfDouble deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext&);
+	using AmfItem::serialize;
+	void serialize(v8& buf, SerializationContext&) const;
+	size_t serializedSize(SerializationContext&) const { return 1 + 8; }
+	static AmfDouble deserialize(const u8*& it, const u8* end, DeserializationContext&);
+	static AmfDouble deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+		return with_pointers(deserialize, it, end, ctx);
+	}
 
 	double value;
 };
 
+template<>
+struct AmfItemTypeTag<AmfDouble> : AmfTaggedType<AMF_DOUBLE> { };
+
 } // namespace amf
 
 #endif
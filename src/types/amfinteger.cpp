@@ -6,68 +6,78 @@
 namespace amf {
 
 bool AmfInteger::operator==(const AmfItem& other) const {
-	const AmfInteger* p = dynamic_cast<const AmfInteger*>(&other);
+	const AmfInteger* p = item_cast<AmfInteger>(&other);
 	return p != nullptr && value == p->value;
 }
 
-std::vector<u8> AmfInteger::serialize(SerializationContext& ctx) const {
+void AmfInteger::serialize(v8& buf, SerializationContext& ctx) const {
 	// According to the spec:
 	// If the value of an unsigned integer (uint) or signed integer (int)
 	// is greater than or equal to 2^28, or if a signed integer (int) is
 	// less than -2^28, it will be serialized using the AMF 3 double type
-	if (value < -0x10000000 || value >= 0x10000000)
-		return AmfDouble(value).serialize(ctx);
-
-	if (value >= 0 && value <= 0x7F) {
-		return std::vector<u8> {
-			AMF_INTEGER,
-			u8(value)
-		};
-	} else if (value > 0x7F && value <= 0x3FFF) {
-		return std::vector<u8> {
-			AMF_INTEGER,
-			u8(value >> 7 | 0x80),
-			u8(value & 0x7F)
-		};
-	} else if (value > 0x3FFF && value <= 0x1FFFFF) {
-		return std::vector<u8> {
-			AMF_INTEGER,
-			u8(value >> 14 | 0x80),
-			u8(((value >> 7) & 0x7F) | 0x80),
-			u8(value & 0x7F)
-		};
-	} else {
-		return std::vector<u8> {
-			AMF_INTEGER,
-			u8(value >> 22 | 0x80),
-			u8(((value >> 15) & 0x7F) | 0x80),
-			u8(((value >> 8 ) & 0x7F) | 0x80),
-			u8(value & 0xFF)
-		};
+	if (value < -0x10000000 || value >= 0x10000000) {
+		AmfDouble(value).serialize(buf, ctx);
+		return;
 	}
+
+	buf.push_back(AMF_INTEGER);
+	write_u29(buf, static_cast<uint32_t>(value));
+}
+
+size_t AmfInteger::serializedSize(SerializationContext&) const {
+	if (value < -0x10000000 || value >= 0x10000000)
+		return 1 + 8;
+
+	return 1 + u29_size(static_cast<uint32_t>(value));
 }
 
 std::vector<u8> AmfInteger::asLength(size_t value, u8 marker) {
+	std::vector<u8> buf { marker };
+	serializeLength(buf, value);
+
+	return buf;
+}
+
+void AmfInteger::serializeLength(v8& buf, size_t value) {
 	// Lengths are serialized as U29, where 1 bit is the sign bit and 1 bit is
 	// used as non-reference marker, which leaves us 27 bits for the actual value.
 	if (value >= (1 << 27))
 		throw std::invalid_argument("Length outside of valid range for AmfInteger.");
 
-	SerializationContext ctx;
-	std::vector<u8> buf = AmfInteger(value << 1 | 1).serialize(ctx);
-	buf[0] = marker;
+	write_u29(buf, static_cast<uint32_t>(value << 1 | 1));
+}
 
-	return buf;
+void AmfInteger::serializeReference(v8& buf, size_t index) {
+	// Like lengths, references are serialized as U29 with 1 sign bit and the
+	// (cleared) reference marker bit, leaving 27 bits for the index.
+	if (index >= (1 << 27))
+		throw std::invalid_argument("Reference index outside of valid range for AmfInteger.");
+
+	write_u29(buf, static_cast<uint32_t>(index << 1));
+}
+
+size_t AmfInteger::lengthSize(size_t value) {
+	if (value >= (1 << 27))
+		throw std::invalid_argument("Length outside of valid range for AmfInteger.");
+
+	return u29_size(static_cast<uint32_t>(value << 1 | 1));
+}
+
+size_t AmfInteger::referenceSize(size_t index) {
+	if (index >= (1 << 27))
+		throw std::invalid_argument("Reference index outside of valid range for AmfInteger.");
+
+	return u29_size(static_cast<uint32_t>(index << 1));
 }
 
-AmfInteger AmfInteger::deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext&) {
+AmfInteger AmfInteger::deserialize(const u8*& it, const u8* end, DeserializationContext&) {
 	if (it == end || *it++ != AMF_INTEGER)
 		throw std::invalid_argument("AmfInteger: Invalid type marker");
 
 	return AmfInteger(deserializeValue(it, end));
 }
 
-int AmfInteger::deserializeValue(v8::const_iterator& it, v8::const_iterator end) {
+int AmfInteger::deserializeValue(const u8*& it, const u8* end) {
 	// Byte counter
 	int i = 0;
 	// Integer value, limited to 29 bits.
@@ -11,19 +11,35 @@ class DeserializationContext;
 
 class AmfInteger : public AmfItem {
 public:
-	AmfInteger() : value(0) { }
-	AmfInteger(int v) : value(v) { }
+	AmfInteger() : AmfItem(AMF_INTEGER), value(0) { }
+	AmfInteger(int v) : AmfItem(AMF_INTEGER), value(v) { }
 	operator int() const { return value; }
 
 	bool operator==(const AmfItem& other) const;
-	std::vector<u8> serialize(SerializationContext&) const;
+	using AmfItem::serialize;
+	void serialize(v8& buf, SerializationContext&) const;
+	size_t serializedSize(SerializationContext&) const;
 	static std::vector<u8> asLength(size_t value, u8 marker);
-	static AmfInteger deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext&);
-	static int deserializeValue(v8::const_iterator& it, v8::const_iterator end);
+	static void serializeLength(v8& buf, size_t value);
+	static void serializeReference(v8& buf, size_t index);
+	// The number of bytes serializeLength and serializeReference append.
+	static size_t lengthSize(size_t value);
+	static size_t referenceSize(size_t index);
+	static AmfInteger deserialize(const u8*& it, const u8* end, DeserializationContext&);
+	static AmfInteger deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+		return with_pointers(deserialize, it, end, ctx);
+	}
+	static int deserializeValue(const u8*& it, const u8* end);
+	static int deserializeValue(v8::const_iterator& it, v8::const_iterator end) {
+		return with_pointers(deserializeValue, it, end);
+	}
 
 	int value;
 };
 
+template<>
+struct AmfItemTypeTag<AmfInteger> : AmfTaggedType<AMF_INTEGER> { };
+
 } // namespace amf
 
 #endif
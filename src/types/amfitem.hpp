@@ -2,6 +2,8 @@
 #ifndef AMFITEM_HPP
 #define AMFITEM_HPP
 
+#include <type_traits>
+#include <typeinfo>
 #include <vector>
 
 #include "amf.hpp"
@@ -29,19 +31,109 @@ enum AmfMarker : u8 {
 	AMF_DICTIONARY
 };
 
+// Type tags of AmfItems that aren't AMF values. AMF values are tagged with
+// their type marker instead (AMF_TRUE for AmfBool).
+enum AmfItemTag : u8 {
+	AMF_ITEM_PACKET_HEADER = 0x80,
+	AMF_ITEM_PACKET_MESSAGE,
+	AMF_ITEM_PACKET,
+	AMF_ITEM_OTHER = 0xff
+};
+
 class SerializationContext;
 
 class AmfItem {
 public:
+	AmfItem() : tag(AMF_ITEM_OTHER) { }
 	virtual ~AmfItem() { };
 
-	virtual std::vector<u8> serialize(SerializationContext& ctx) const = 0;
+	// Compact tag identifying the concrete type, see AmfItemTag.
+	u8 typeTag() const { return tag; }
+
+	// Appends the serialized value to buf.
+	virtual void serialize(v8& buf, SerializationContext& ctx) const = 0;
+
+	std::vector<u8> serialize(SerializationContext& ctx) const {
+		std::vector<u8> buf;
+		serialize(buf, ctx);
+		return buf;
+	}
+
+	// The number of bytes serialize would append, without serializing. Adds
+	// to ctx exactly what serialize would add, so that references are
+	// accounted for. The library's types compute the size directly, other
+	// types serialize into a temporary buffer by default.
+	virtual size_t serializedSize(SerializationContext& ctx) const {
+		return serialize(ctx).size();
+	}
+
 	virtual bool operator==(const AmfItem&) const = 0;
 	virtual bool operator!=(const AmfItem& other) const {
 		return !(*this == other);
 	}
+
+protected:
+	explicit AmfItem(u8 tag) : tag(tag) { }
+
+private:
+	u8 tag;
+};
+
+// Maps the concrete AmfItem types of this library to their type tag, so that
+// item_cast can use a tag comparison and a static_cast for them. Specialized
+// next to each type; any other type (e.g. user-defined subclasses) falls back
+// to dynamic_cast.
+template<typename T>
+struct AmfItemTypeTag {
+	static const bool tagged = false;
+};
+
+template<u8 Tag>
+struct AmfTaggedType {
+	static const bool tagged = true;
+	static const u8 tag = Tag;
 };
 
+template<typename T>
+const T* item_cast(const AmfItem* item, std::true_type) {
+	if (item == nullptr || item->typeTag() != AmfItemTypeTag<T>::tag)
+		return nullptr;
+
+	return static_cast<const T*>(item);
+}
+
+template<typename T>
+const T* item_cast(const AmfItem* item, std::false_type) {
+	return dynamic_cast<const T*>(item);
+}
+
+// Checked downcast, with the same results as dynamic_cast.
+template<typename T>
+const T* item_cast(const AmfItem* item) {
+	static_assert(std::is_base_of<AmfItem, T>::value, "T must extend AmfItem");
+	return item_cast<T>(item,
+		std::integral_constant<bool, AmfItemTypeTag<T>::tagged>());
+}
+
+template<typename T>
+T* item_cast(AmfItem* item) {
+	return const_cast<T*>(item_cast<T>(static_cast<const AmfItem*>(item)));
+}
+
+template<typename T>
+const T& item_cast(const AmfItem& item) {
+	const T* ret = item_cast<T>(&item);
+	if (ret == nullptr)
+		throw std::bad_cast();
+
+	return *ret;
+}
+
+template<typename T>
+T& item_cast(AmfItem& item) {
+	return const_cast<T&>(item_cast<T>(static_cast<const AmfItem&>(item)));
+}
+
 } // namespace amf
 
 #endif
@@ -13,26 +13,35 @@ class DeserializationContext;
 
 class AmfNull : public AmfItem {
 public:
-	AmfNull() { }
+	AmfNull() : AmfItem(AMF_NULL) { }
 
 	bool operator==(const AmfItem& other) const {
-		const AmfNull* p = dynamic_cast<const AmfNull*>(&other);
+		const AmfNull* p = item_cast<AmfNull>(&other);
 		return p != nullptr;
 	}
 
-	std::vector<u8> serialize(SerializationContext&) const {
-		return std::vector<u8>{ AMF_NULL };
+	using AmfItem::serialize;
+	size_t serializedSize(SerializationContext&) const { return 1; }
+	void serialize(v8& buf, SerializationContext&) const {
+		buf.push_back(AMF_NULL);
 	}
 
-	static AmfNull deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext&) {
+	static AmfNull deserialize(const u8*& it, const u8* end, DeserializationContext&) {
 		if (it == end || *it++ != AMF_NULL)
 			throw std::invalid_argument("AmfNull: Invalid type marker");
 
 		return AmfNull();
 	}
 
+	static AmfNull deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+		return with_pointers(deserialize, it, end, ctx);
+	}
+
 };
 
+template<>
+struct AmfItemTypeTag<AmfNull> : AmfTaggedType<AMF_NULL> { };
+
 } // namespace amf
 
 #endif
@@ -9,28 +9,30 @@
 namespace amf {
 
 bool AmfObject::operator==(const AmfItem& other) const {
-	const AmfObject* p = dynamic_cast<const AmfObject*>(&other);
+	const AmfObject* p = item_cast<AmfObject>(&other);
 
 	if (p == nullptr)
 		return false;
 
-	if (traits != p->traits)
+	if (traits != p->traits && *traits != *p->traits)
 		return false;
 
-	if (traits.dynamic && dynamicProperties != p->dynamicProperties)
+	if (traits->dynamic && dynamicProperties != p->dynamicProperties)
 		return false;
 
 	// TODO: only compare properties that are in attributes?
-	if (sealedProperties != p->sealedProperties)
+	// compared slot by slot, with slots of sealed properties that haven't been
+	// set being null
+	if (sealedValues != p->sealedValues)
 		return false;
 
-	if (traits.externalizable && externalizer(this) != p->externalizer(p))
+	if (traits->externalizable && externalizer(this) != p->externalizer(p))
 		return false;
 
 	return true;
 }
 
-std::vector<u8> AmfObject::serialize(SerializationContext& ctx) const {
+void AmfObject::serialize(v8& buf, SerializationContext& ctx) const {
 	/* AmfObject is defined as
 	 * object-marker
 	 * (
@@ -40,83 +42,143 @@ std::vector<u8> AmfObject::serialize(SerializationContext& ctx) const {
 	 *   (U29O-traits class-name *(UTF-8-vr) *(value-type) *(dynamic-member))
 	 * )
 	 */
+	buf.push_back(AMF_OBJECT);
+
 	int index = ctx.getIndex(*this);
-	if (index != -1)
-		return std::vector<u8> { AMF_OBJECT, u8(index << 1) };
+	if (index != -1) {
+		AmfInteger::serializeReference(buf, index);
+		return;
+	}
 	ctx.addObject(*this);
 
-	std::vector<u8> buf = { AMF_OBJECT };
-
-	AmfString className(traits.className);
-	// serialized class name as UTF-8-vr
-	std::vector<u8> name(className.serializeValue(ctx));
-
-	if (traits.externalizable) {
+	if (traits->externalizable) {
 		// TODO: ref?
 		// U29O-traits-ext = 0b0111 = 0x07
 		buf.push_back(0x07);
 		// class-name
-		buf.insert(buf.end(), name.begin(), name.end());
+		AmfString::serializeValue(buf, traits->className, ctx);
 
 		// externalized value = *(U8)
 		// note: this may throw if externalizer is not properly initialized
 		std::vector<u8> externalized(externalizer(this));
 		buf.insert(buf.end(), externalized.begin(), externalized.end());
-		return buf;
+		return;
 	}
 
 	// TODO: what about externalizable?
-	int trait_index = ctx.getIndex(traits);
-	if (trait_index != -1) {
-		buf.push_back(u8((trait_index << 2) | 1));
-	} else {
-		ctx.addTraits(traits);
-
-		// U29-traits = 0b0011 = 0x03
-		size_t traitMarker = traits.getAttriutes().size() << 4 | 0x03;
-		// dynamic marker = 0b1000 = 0x08
-		if (traits.dynamic) traitMarker |= 0x08;
-
-		std::vector<u8> marker(AmfInteger(traitMarker).serialize(ctx));
-		buf.insert(buf.end(), marker.begin() + 1, marker.end());
-
-		// class-name
-		buf.insert(buf.end(), name.begin(), name.end());
-
-		// sealed property names = *(UTF-8-vr)
-		for (const std::string& attribute : traits.getAttriutes()) {
-			std::vector<u8> attr(AmfString(attribute).serializeValue(ctx));
-			buf.insert(buf.end(), attr.begin(), attr.end());
-		}
-	}
+	serializeTraits(buf, *traits, ctx);
 
 	// sealed property values = *(value-type)
-	for (const std::string& attribute : traits.getAttriutes()) {
-		auto s = sealedProperties.at(attribute)->serialize(ctx);
-		buf.insert(buf.end(), s.begin(), s.end());
-	}
+	for (size_t i = 0; i < traits->getAttriutes().size(); ++i)
+		sealedValue(i).serialize(buf, ctx);
 
 	// only encode *(dynamic-member) (including the end marker) if the object
 	// is actually dynamic
-	if (traits.dynamic) {
+	if (traits->dynamic) {
 		// dynamic-members = UTF-8-vr value-type
 		for (const auto& it : dynamicProperties) {
-			AmfString attribute(it.first);
-			const std::vector<u8> name(attribute.serializeValue(ctx));
-			buf.insert(buf.end(), name.begin(), name.end());
-
-			auto s = it.second->serialize(ctx);
-			buf.insert(buf.end(), s.begin(), s.end());
+			AmfString::serializeValue(buf, it.first, ctx);
+			it.second->serialize(buf, ctx);
 		}
 
 		// final dynamic member = UTF-8-empty
 		buf.push_back(0x01);
 	}
+}
+
+size_t AmfObject::serializedSize(SerializationContext& ctx) const {
+	int index = ctx.getIndex(*this);
+	if (index != -1)
+		return 1 + AmfInteger::referenceSize(index);
+	ctx.addObject(*this);
+
+	if (traits->externalizable) {
+		size_t size = 1 + 1 + AmfString::valueSize(traits->className, ctx);
+		return size + externalizer(this).size();
+	}
+
+	size_t size = 1 + traitsSize(*traits, ctx);
+
+	for (size_t i = 0; i < traits->getAttriutes().size(); ++i)
+		size += sealedValue(i).serializedSize(ctx);
+
+	if (traits->dynamic) {
+		for (const auto& it : dynamicProperties) {
+			size += AmfString::valueSize(it.first, ctx);
+			size += it.second->serializedSize(ctx);
+		}
+
+		// UTF-8-empty
+		size += 1;
+	}
+
+	return size;
+}
+
+// The value of a sealed property to serialize. Throws std::out_of_range if
+// it is missing, e.g. for objects created with traits only.
+const AmfItem& AmfObject::sealedValue(size_t slot) const {
+	if (slot >= sealedValues.size() || sealedValues[slot].get() == nullptr)
+		throw std::out_of_range("AmfObject: Missing sealed property");
+
+	return *sealedValues[slot];
+}
+
+// Traits that are interned or shared with other objects must not change, so
+// they are copied before the first modification.
+AmfObjectTraits& AmfObject::mutableTraits() {
+	if (traits->getId() != 0 || traits.use_count() != 1)
+		traits = std::make_shared<AmfObjectTraits>(*traits);
 
-	return buf;
+	// all traits are created by make_shared<AmfObjectTraits>, so they aren't const
+	return const_cast<AmfObjectTraits&>(*traits);
 }
 
-AmfItemPtr AmfObject::deserializePtr(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+void AmfObject::serializeTraits(v8& buf, const AmfObjectTraits& traits, SerializationContext& ctx) {
+	int trait_index = ctx.getIndex(traits);
+	if (trait_index != -1) {
+		// U29O-traits-ref = 0b01, leaving 27 bits for the index
+		write_u29(buf, static_cast<uint32_t>(trait_index << 2 | 0x01));
+		return;
+	}
+
+	ctx.addTraits(traits);
+
+	// U29-traits = 0b0011 = 0x03
+	size_t traitMarker = traits.getAttriutes().size() << 4 | 0x03;
+	// dynamic marker = 0b1000 = 0x08
+	if (traits.dynamic) traitMarker |= 0x08;
+
+	write_u29(buf, static_cast<uint32_t>(traitMarker));
+
+	// class-name
+	AmfString::serializeValue(buf, traits.className, ctx);
+
+	// sealed property names = *(UTF-8-vr)
+	for (const std::string& attribute : traits.getAttriutes())
+		AmfString::serializeValue(buf, attribute, ctx);
+}
+
+size_t AmfObject::traitsSize(const AmfObjectTraits& traits, SerializationContext& ctx) {
+	int trait_index = ctx.getIndex(traits);
+	if (trait_index != -1)
+		return u29_size(static_cast<uint32_t>(trait_index << 2 | 0x01));
+
+	ctx.addTraits(traits);
+
+	size_t traitMarker = traits.getAttriutes().size() << 4 | 0x03;
+	if (traits.dynamic) traitMarker |= 0x08;
+
+	size_t size = u29_size(static_cast<uint32_t>(traitMarker));
+	size += AmfString::valueSize(traits.className, ctx);
+
+	for (const std::string& attribute : traits.getAttriutes())
+		size += AmfString::valueSize(attribute, ctx);
+
+	return size;
+}
+
+AmfItemPtr AmfObject::deserializePtr(const u8*& it, const u8* end, DeserializationContext& ctx) {
 	if (it == end || *it++ != AMF_OBJECT)
 		throw std::invalid_argument("AmfObject: Invalid type marker");
 
@@ -126,55 +188,69 @@ AmfItemPtr AmfObject::deserializePtr(v8::const_iterator& it, v8::const_iterator
 		return ctx.getPointer<AmfObject>(type >> 1);
 	}
 
-	AmfObjectTraits traits("", false, false);
-	if ((type & 0x03) == 0x01) {
-		// 0b..01 == U29O-traits-ref
-		traits = ctx.getTraits(type >> 2);
-	} else {
-		if ((type & 0x07) == 0x07) {
-			// 0b.111 == U29O-traits-ext
-			traits.externalizable = true;
-			traits.className = AmfString::deserializeValue(it, end, ctx);
-		} else if ((type & 0x07) == 0x03) {
-			// 0b.011 == U29O-traits
-			traits.dynamic = ((type & 0x08) == 0x08);
-			traits.className = AmfString::deserializeValue(it, end, ctx);
-			int numSealed = type >> 4;
-			for (int i = 0; i < numSealed; ++i)
-				traits.addAttribute(AmfString::deserializeValue(it, end, ctx));
-		}
+	AmfObjectTraitsPtr traits = ctx.getTraitsPtr(deserializeTraits(type, it, end, ctx));
 
-		ctx.addTraits(traits);
-	}
-
-	AmfItemPtr ptr(new AmfObject(traits));
+	AmfItemPtr ptr = ctx.createItem<AmfObject>(traits);
 	AmfObject & ret = ptr.as<AmfObject>();
 	ctx.addPointer(ptr);
 
-	if (traits.externalizable) {
-		ret = Deserializer::externalDeserializers.at(traits.className)(it, end, ctx);
+	if (traits->externalizable) {
+		// The type deserializers report a missing type marker at the end of
+		// the input as invalid, but it means the input is truncated.
+		try {
+			ret = Deserializer::externalDeserializers.at(traits->className)(it, end, ctx);
+		} catch (const std::invalid_argument&) {
+			if (it == end)
+				throw std::out_of_range("AmfObject: Not enough bytes for externalizable object");
+			throw;
+		}
 		return ptr;
 	}
 
-	for (auto name : traits.getAttriutes()) {
-		AmfItemPtr val = Deserializer::deserialize(it, end, ctx);
-		ret.sealedProperties[name] = val;
-	}
+	for (size_t i = 0; i < ret.sealedValues.size(); ++i)
+		ret.sealedValues[i] = Deserializer::deserialize(it, end, ctx);
 
-	if (traits.dynamic) {
+	if (traits->dynamic) {
 		while (true) {
-			std::string name = AmfString::deserializeValue(it, end, ctx);
-			if (name == "") break;
+			AmfStringView name = AmfString::deserializeView(it, end, ctx);
+			if (name.empty()) break;
 
 			AmfItemPtr val = Deserializer::deserialize(it, end, ctx);
-			ret.dynamicProperties[name] = val;
+			ret.dynamicProperties[AmfAtom(name)] = val;
 		}
 	}
 
 	return ptr;
 }
 
-AmfObject AmfObject::deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+size_t AmfObject::deserializeTraits(int type, const u8*& it, const u8* end, DeserializationContext& ctx) {
+	if ((type & 0x03) == 0x01) {
+		// 0b..01 == U29O-traits-ref
+		size_t index = type >> 2;
+		// throws std::out_of_range for invalid references
+		ctx.getTraits(index);
+		return index;
+	}
+
+	AmfObjectTraits traits("", false, false);
+	if ((type & 0x07) == 0x07) {
+		// 0b.111 == U29O-traits-ext
+		traits.externalizable = true;
+		traits.className = AmfString::deserializeValue(it, end, ctx);
+	} else if ((type & 0x07) == 0x03) {
+		// 0b.011 == U29O-traits
+		traits.dynamic = ((type & 0x08) == 0x08);
+		traits.className = AmfString::deserializeValue(it, end, ctx);
+		int numSealed = type >> 4;
+		for (int i = 0; i < numSealed; ++i)
+			traits.addAttribute(AmfString::deserializeValue(it, end, ctx));
+	}
+
+	ctx.addTraits(traits);
+	return ctx.traitsCount() - 1;
+}
+
+AmfObject AmfObject::deserialize(const u8*& it, const u8* end, DeserializationContext& ctx) {
 	return deserializePtr(it, end, ctx).as<AmfObject>();
 }
 
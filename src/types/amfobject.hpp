@@ -3,10 +3,10 @@
 #define AMFOBJECT_HPP
 
 #include <functional>
-#include <map>
 
 #include "types/amfitem.hpp"
 #include "utils/amfitemptr.hpp"
+#include "utils/amforderedmap.hpp"
 #include "utils/amfobjecttraits.hpp"
 
 namespace amf {
@@ -16,17 +16,34 @@ class DeserializationContext;
 
 class AmfObject : public AmfItem {
 public:
-	AmfObject() : traits("", false, false) { }
+	AmfObject() : AmfItem(AMF_OBJECT),
+		traits(std::make_shared<AmfObjectTraits>("", false, false)) { }
 	AmfObject(std::string className, bool dynamic, bool externalizable) :
-		traits(className, dynamic, externalizable) { }
+		AmfItem(AMF_OBJECT),
+		traits(std::make_shared<AmfObjectTraits>(className, dynamic, externalizable)) { }
+	// Creates an object with the given traits, but no property values yet.
+	explicit AmfObject(const AmfObjectTraits& traits) : AmfItem(AMF_OBJECT),
+		sealedValues(traits.getAttriutes().size()),
+		traits(std::make_shared<AmfObjectTraits>(traits)) { }
+	// Same, but shares the traits instead of copying them.
+	explicit AmfObject(AmfObjectTraitsPtr traits) : AmfItem(AMF_OBJECT),
+		sealedValues(traits->getAttriutes().size()), traits(traits) { }
 
 	bool operator==(const AmfItem& other) const;
-	std::vector<u8> serialize(SerializationContext& ctx) const;
+	using AmfItem::serialize;
+	void serialize(v8& buf, SerializationContext& ctx) const;
+	size_t serializedSize(SerializationContext& ctx) const;
 
 	template<class T>
 	void addSealedProperty(std::string name, const T& value) {
-		traits.addAttribute(name);
-		sealedProperties[name] = AmfItemPtr(new T(value));
+		size_t slot = traits->getAttributeIndex(name);
+		if (slot == traits->getAttriutes().size())
+			mutableTraits().addAttribute(name);
+
+		if (slot >= sealedValues.size())
+			sealedValues.resize(slot + 1);
+
+		sealedValues[slot] = AmfItemPtr(new T(value));
 	}
 
 	template<class T>
@@ -34,12 +51,30 @@ public:
 		dynamicProperties[name] = AmfItemPtr(new T(value));
 	}
 
+	// The slot of a sealed property, i.e. its index in sealedValues. It is the
+	// same for all objects with the same traits, so it can be looked up once
+	// to access the property of many objects without comparing names. Throws
+	// std::out_of_range if the traits have no such property.
+	size_t getSealedSlot(const std::string& name) const {
+		size_t slot = traits->getAttributeIndex(name);
+		if (slot == traits->getAttriutes().size())
+			throw std::out_of_range("AmfObject::getSealedSlot");
+
+		return slot;
+	}
+
+	template<class T>
+	T& getSealedProperty(const std::string& name) {
+		return getSealedProperty<T>(getSealedSlot(name));
+	}
+
 	template<class T>
-	T& getSealedProperty(std::string name) {
-		if (!traits.isAttributeExists(name))
+	T& getSealedProperty(size_t slot) {
+		AmfItemPtr& value = sealedValues.at(slot);
+		if (value.get() == nullptr)
 			throw std::out_of_range("AmfObject::getSealedProperty");
 
-		return sealedProperties.at(name).as<T>();
+		return value.as<T>();
 	}
 
 	template<class T>
@@ -47,24 +82,53 @@ public:
 		return dynamicProperties.at(name).as<T>();
 	}
 
-	static AmfItemPtr deserializePtr(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx);
-	static AmfObject deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx);
+	static AmfItemPtr deserializePtr(const u8*& it, const u8* end, DeserializationContext& ctx);
+	static AmfItemPtr deserializePtr(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+		return with_pointers(deserializePtr, it, end, ctx);
+	}
+	static AmfObject deserialize(const u8*& it, const u8* end, DeserializationContext& ctx);
+	static AmfObject deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+		return with_pointers(deserialize, it, end, ctx);
+	}
+
+	// Writes the U29O-traits-ref or U29O-traits of a non-externalizable
+	// object, i.e. everything between the type marker and the values.
+	static void serializeTraits(v8& buf, const AmfObjectTraits& traits, SerializationContext& ctx);
+	static size_t traitsSize(const AmfObjectTraits& traits, SerializationContext& ctx);
+
+	// Reads the traits of an object after its U29O value type, which must not
+	// be an object reference. New traits are added to ctx, returns the index
+	// of the traits in ctx.
+	static size_t deserializeTraits(int type, const u8*& it, const u8* end, DeserializationContext& ctx);
 
 	const AmfObjectTraits& objectTraits() const {
+		return *traits;
+	}
+
+	// The traits may be shared with other objects, e.g. all objects read by
+	// the Deserializer share the interned traits of their shape.
+	const AmfObjectTraitsPtr& objectTraitsPtr() const {
 		return traits;
 	}
 
-	std::map<std::string, AmfItemPtr> sealedProperties;
-	std::map<std::string, AmfItemPtr> dynamicProperties;
+	// The values of the sealed properties, in the order of the attributes of
+	// the traits.
+	std::vector<AmfItemPtr> sealedValues;
+	// Dynamic properties in the order they were added or deserialized.
+	AmfOrderedMap<AmfItemPtr> dynamicProperties;
 
 	std::function<v8(const AmfObject*)> externalizer;
 
 private:
-	AmfObject(AmfObjectTraits traits) : traits(traits) { }
+	const AmfItem& sealedValue(size_t slot) const;
+	AmfObjectTraits& mutableTraits();
 
-	AmfObjectTraits traits;
+	AmfObjectTraitsPtr traits;
 };
 
+template<>
+struct AmfItemTypeTag<AmfObject> : AmfTaggedType<AMF_OBJECT> { };
+
 } // namespace amf
 
 #endif
@@ -7,52 +7,98 @@
 namespace amf {
 
 bool AmfString::operator==(const AmfItem& other) const {
-	const AmfString* p = dynamic_cast<const AmfString*>(&other);
+	const AmfString* p = item_cast<AmfString>(&other);
 	return p != nullptr && value == p->value;
 }
 
-std::vector<u8> AmfString::serialize(SerializationContext& ctx) const {
+void AmfString::serialize(v8& buf, SerializationContext& ctx) const {
 	// AmfString = string-marker UTF-8-vr
-	std::vector<u8> buf { AMF_STRING };
-
-	// Get the UTF-8-vr and append.
-	std::vector<u8> value = serializeValue(ctx);
-	buf.insert(buf.end(), value.begin(), value.end());
+	buf.push_back(AMF_STRING);
+	serializeValue(buf, value, ctx);
+}
 
+std::vector<u8> AmfString::serializeValue(SerializationContext& ctx) const {
+	std::vector<u8> buf;
+	serializeValue(buf, value, ctx);
 	return buf;
 }
 
-std::vector<u8> AmfString::serializeValue(SerializationContext& ctx) const {
+size_t AmfString::serializedSize(SerializationContext& ctx) const {
+	return 1 + valueSize(value, ctx);
+}
+
+void AmfString::serializeValue(v8& buf, SerializationContext& ctx) const {
+	serializeValue(buf, value, ctx);
+}
+
+// Writes a std::string or an AmfAtom, which the context finds by id.
+template<class S>
+static void serialize_value(v8& buf, const S& value, SerializationContext& ctx) {
+	const std::string& str = value;
+
 	// UTF-8-empty should not be cached.
-	if (value.empty())
-		return std::vector<u8> { 0x01 };
+	if (str.empty()) {
+		buf.push_back(0x01);
+		return;
+	}
 
 	int index = ctx.getIndex(value);
-	if (index != -1)
-		return std::vector<u8> { u8(index << 1) };
+	if (index != -1) {
+		AmfInteger::serializeReference(buf, index);
+		return;
+	}
 	ctx.addString(value);
 
 	// UTF-8-vr = U29S-value *(UTF8-char)
 	// U29S-value encodes the length of the following string
-	std::vector<u8> buf = AmfInteger::asLength(value.size(), AMF_STRING);
-
-	// Get rid of the type marker.
-	buf.erase(buf.begin());
+	AmfInteger::serializeLength(buf, str.size());
 
 	// now, append the actual string.
-	buf.insert(buf.end(), value.begin(), value.end());
+	buf.insert(buf.end(), str.begin(), str.end());
+}
 
-	return buf;
+template<class S>
+static size_t value_size(const S& value, SerializationContext& ctx) {
+	const std::string& str = value;
+	if (str.empty())
+		return 1;
+
+	int index = ctx.getIndex(value);
+	if (index != -1)
+		return AmfInteger::referenceSize(index);
+	ctx.addString(value);
+
+	return AmfInteger::lengthSize(str.size()) + str.size();
+}
+
+void AmfString::serializeValue(v8& buf, const std::string& value, SerializationContext& ctx) {
+	serialize_value(buf, value, ctx);
+}
+
+void AmfString::serializeValue(v8& buf, const AmfAtom& value, SerializationContext& ctx) {
+	serialize_value(buf, value, ctx);
+}
+
+size_t AmfString::valueSize(const std::string& value, SerializationContext& ctx) {
+	return value_size(value, ctx);
 }
 
-AmfString AmfString::deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+size_t AmfString::valueSize(const AmfAtom& value, SerializationContext& ctx) {
+	return value_size(value, ctx);
+}
+
+AmfString AmfString::deserialize(const u8*& it, const u8* end, DeserializationContext& ctx) {
 	if (it == end || *it++ != AMF_STRING)
 		throw std::invalid_argument("AmfString: Invalid type marker");
 
 	return AmfString(deserializeValue(it, end, ctx));
 }
 
-std::string AmfString::deserializeValue(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+std::string AmfString::deserializeValue(const u8*& it, const u8* end, DeserializationContext& ctx) {
+	return deserializeView(it, end, ctx).str();
+}
+
+AmfStringView AmfString::deserializeView(const u8*& it, const u8* end, DeserializationContext& ctx) {
 	int type = AmfInteger::deserializeValue(it, end);
 	if ((type & 0x01) == 0)
 		return ctx.getString(type >> 1);
@@ -61,11 +107,10 @@ std::string AmfString::deserializeValue(v8::const_iterator& it, v8::const_iterat
 	if (end - it < length)
 		throw std::out_of_range("Not enough bytes for AmfString");
 
-	std::string val(it, it + length);
+	AmfStringView val(reinterpret_cast<const char*>(it), length);
 	it += length;
 
-	ctx.addString(val);
-	return val;
+	return ctx.addString(val);
 }
 
 } // namespace amf
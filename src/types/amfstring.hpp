@@ -5,28 +5,53 @@
 #include <string>
 
 #include "types/amfitem.hpp"
+#include "utils/amfstringview.hpp"
 
 namespace amf {
 
+class AmfAtom;
 class SerializationContext;
 class DeserializationContext;
 
 class AmfString : public AmfItem {
 public:
-	AmfString() { }
-	AmfString(const char* v) : value(v == nullptr ? "" : v) { }
-	AmfString(std::string v) : value(v) { }
+	AmfString() : AmfItem(AMF_STRING) { }
+	AmfString(const char* v) : AmfItem(AMF_STRING), value(v == nullptr ? "" : v) { }
+	AmfString(std::string v) : AmfItem(AMF_STRING), value(v) { }
 	operator std::string() const { return value; }
 
 	bool operator==(const AmfItem& other) const;
-	std::vector<u8> serialize(SerializationContext& ctx) const;
+	using AmfItem::serialize;
+	void serialize(v8& buf, SerializationContext& ctx) const;
+	size_t serializedSize(SerializationContext& ctx) const;
 	std::vector<u8> serializeValue(SerializationContext& ctx) const;
-	static AmfString deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx);
-	static std::string deserializeValue(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx);
+	void serializeValue(v8& buf, SerializationContext& ctx) const;
+	static void serializeValue(v8& buf, const std::string& value, SerializationContext& ctx);
+	static size_t valueSize(const std::string& value, SerializationContext& ctx);
+	static void serializeValue(v8& buf, const AmfAtom& value, SerializationContext& ctx);
+	static size_t valueSize(const AmfAtom& value, SerializationContext& ctx);
+	static AmfString deserialize(const u8*& it, const u8* end, DeserializationContext& ctx);
+	static AmfString deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+		return with_pointers(deserialize, it, end, ctx);
+	}
+	static std::string deserializeValue(const u8*& it, const u8* end, DeserializationContext& ctx);
+	static std::string deserializeValue(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+		return with_pointers(deserializeValue, it, end, ctx);
+	}
+	// Like deserializeValue, but without copying the string. The returned view
+	// points into the string table of ctx (and, depending on its storage mode,
+	// into the input buffer), and is only valid as long as both are.
+	static AmfStringView deserializeView(const u8*& it, const u8* end, DeserializationContext& ctx);
+	static AmfStringView deserializeView(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+		return with_pointers(deserializeView, it, end, ctx);
+	}
 
 	std::string value;
 };
 
+template<>
+struct AmfItemTypeTag<AmfString> : AmfTaggedType<AMF_STRING> { };
+
 } // namespace amf
 
 #endif
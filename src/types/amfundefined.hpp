@@ -13,26 +13,35 @@ class DeserializationContext;
 
 class AmfUndefined : public AmfItem {
 public:
-	AmfUndefined() {}
+	AmfUndefined() : AmfItem(AMF_UNDEFINED) { }
 
 	bool operator==(const AmfItem& other) const {
-		const AmfUndefined* p = dynamic_cast<const AmfUndefined*>(&other);
+		const AmfUndefined* p = item_cast<AmfUndefined>(&other);
 		return p != nullptr;
 	}
 
-	std::vector<u8> serialize(SerializationContext&) const {
-		return std::vector<u8>{ AMF_UNDEFINED };
+	using AmfItem::serialize;
+	size_t serializedSize(SerializationContext&) const { return 1; }
+	void serialize(v8& buf, SerializationContext&) const {
+		buf.push_back(AMF_UNDEFINED);
 	}
 
-	static AmfUndefined deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext&) {
+	static AmfUndefined deserialize(const u8*& it, const u8* end, DeserializationContext&) {
 		if (it == end || *it++ != AMF_UNDEFINED)
 			throw std::invalid_argument("AmfUndefined: Invalid type marker");
 
 		return AmfUndefined();
 	}
 
+	static AmfUndefined deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+		return with_pointers(deserialize, it, end, ctx);
+	}
+
 };
 
+template<>
+struct AmfItemTypeTag<AmfUndefined> : AmfTaggedType<AMF_UNDEFINED> { };
+
 } // namespace amf
 
 #endif
@@ -10,38 +10,48 @@ namespace amf {
 
 template<typename T>
 bool AmfVector<T, typename VectorProperties<T>::type>::operator==(const AmfItem& other) const {
-	const AmfVector<T>* p = dynamic_cast<const AmfVector<T>*>(&other);
+	const AmfVector<T>* p = item_cast<AmfVector<T>>(&other);
 	return p != nullptr && fixed == p->fixed && values == p->values;
 }
 
 template<typename T>
-std::vector<u8> AmfVector<T, typename VectorProperties<T>::type>::serialize(SerializationContext& ctx) const {
+void AmfVector<T, typename VectorProperties<T>::type>::serialize(v8& buf, SerializationContext& ctx) const {
+	// copy the marker, as push_back would otherwise odr-use it
+	buf.push_back(u8(VectorProperties<T>::marker));
+
 	int index = ctx.getIndex(*this);
-	if (index != -1)
-		return std::vector<u8> { VectorProperties<T>::marker, u8(index << 1) };
+	if (index != -1) {
+		AmfInteger::serializeReference(buf, index);
+		return;
+	}
 	ctx.addObject(*this);
 
 	// U29V value
-	std::vector<u8> buf = AmfInteger::asLength(values.size(),
-		VectorProperties<T>::marker);
+	AmfInteger::serializeLength(buf, values.size());
 
 	// fixed-vector marker
 	buf.push_back(fixed ? 0x01 : 0x00);
 
-	for (const T& it : values) {
-		// values are encoded in network byte order
-		// ints are encoded as U32, not U29
-		T netvalue = hton(it);
-		const u8* bytes = reinterpret_cast<const u8*>(&netvalue);
-		buf.insert(buf.end(), bytes, bytes + VectorProperties<T>::size);
-	}
+	// values are encoded in network byte order
+	// ints are encoded as U32, not U29
+	for (const T& it : values)
+		write_network(buf, it);
+}
 
-	return buf;
+template<typename T>
+size_t AmfVector<T, typename VectorProperties<T>::type>::serializedSize(SerializationContext& ctx) const {
+	int index = ctx.getIndex(*this);
+	if (index != -1)
+		return 1 + AmfInteger::referenceSize(index);
+	ctx.addObject(*this);
+
+	// marker, U29V value, fixed-vector marker and the values
+	return 1 + AmfInteger::lengthSize(values.size()) + 1 + values.size() * sizeof(T);
 }
 
 template<typename T>
 AmfVector<T> AmfVector<T, typename VectorProperties<T>::type>::deserialize(
-	v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+	const u8*& it, const u8* end, DeserializationContext& ctx) {
 	if (it == end || *it++ != VectorProperties<T>::marker)
 		throw std::invalid_argument("AmfVector: Invalid type marker");
 
@@ -78,36 +88,50 @@ AmfVector<T> AmfVector<T, typename VectorProperties<T>::type>::deserialize(
 }
 
 bool AmfVector<AmfItem>::operator==(const AmfItem& other) const {
-	const AmfVector<AmfItem>* p = dynamic_cast<const AmfVector<AmfItem>*>(&other);
+	const AmfVector<AmfItem>* p = item_cast<AmfVector<AmfItem>>(&other);
 	return p != nullptr && fixed == p->fixed && type == p->type && values == p->values;
 }
 
-std::vector<u8> AmfVector<AmfItem>::serialize(SerializationContext& ctx) const {
+void AmfVector<AmfItem>::serialize(v8& buf, SerializationContext& ctx) const {
+	buf.push_back(AMF_VECTOR_OBJECT);
+
 	int index = ctx.getIndex(*this);
-	if (index != -1)
-		return std::vector<u8> { AMF_VECTOR_OBJECT, u8(index << 1) };
+	if (index != -1) {
+		AmfInteger::serializeReference(buf, index);
+		return;
+	}
 	ctx.addObject(*this);
 
 	// U29V value, encoding the length
-	std::vector<u8> buf = AmfInteger::asLength(values.size(), AMF_VECTOR_OBJECT);
+	AmfInteger::serializeLength(buf, values.size());
 
 	// fixed-vector marker
 	buf.push_back(fixed ? 0x01 : 0x00);
 
 	// object type name
-	std::vector<u8> typeName = AmfString(type).serializeValue(ctx);
-	buf.insert(buf.end(), typeName.begin(), typeName.end());
+	AmfString::serializeValue(buf, type, ctx);
 
-	for (const auto& it : values) {
-		auto s = it->serialize(ctx);
-		buf.insert(buf.end(), s.begin(), s.end());
-	}
+	for (const auto& it : values)
+		it->serialize(buf, ctx);
+}
+
+size_t AmfVector<AmfItem>::serializedSize(SerializationContext& ctx) const {
+	int index = ctx.getIndex(*this);
+	if (index != -1)
+		return 1 + AmfInteger::referenceSize(index);
+	ctx.addObject(*this);
+
+	size_t size = 1 + AmfInteger::lengthSize(values.size()) + 1;
+	size += AmfString::valueSize(type, ctx);
+
+	for (const auto& it : values)
+		size += it->serializedSize(ctx);
 
-	return buf;
+	return size;
 }
 
 AmfItemPtr AmfVector<AmfItem>::deserializePtr(
-	v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+	const u8*& it, const u8* end, DeserializationContext& ctx) {
 	if (it == end || *it++ != AMF_VECTOR_OBJECT)
 		throw std::invalid_argument("AmfVector<Object>: Invalid type marker");
 
@@ -122,7 +146,7 @@ AmfItemPtr AmfVector<AmfItem>::deserializePtr(
 	std::string name = AmfString::deserializeValue(it, end, ctx);
 	int count = type >> 1;
 
-	AmfItemPtr ptr(new AmfVector<AmfItem>(name, fixed));
+	AmfItemPtr ptr = ctx.createItem<AmfVector<AmfItem>>(name, fixed);
 	AmfVector<AmfItem> & vec = ptr.as<AmfVector>();
 	ctx.addPointer(ptr);
 
@@ -135,7 +159,7 @@ AmfItemPtr AmfVector<AmfItem>::deserializePtr(
 }
 
 AmfVector<AmfItem> AmfVector<AmfItem>::deserialize(
-	v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+	const u8*& it, const u8* end, DeserializationContext& ctx) {
 	return deserializePtr(it, end, ctx).as<AmfVector<AmfItem>>();
 }
 
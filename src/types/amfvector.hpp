@@ -43,9 +43,9 @@ struct VectorProperties<double> {
 template<typename T>
 class AmfVector<T, typename VectorProperties<T>::type> : public AmfItem {
 public:
-	AmfVector() : values({}), fixed(false) { }
+	AmfVector() : AmfItem(VectorProperties<T>::marker), values({}), fixed(false) { }
 	AmfVector(std::vector<T> vector, bool fixed = false) :
-		values(vector), fixed(fixed) { }
+		AmfItem(VectorProperties<T>::marker), values(vector), fixed(fixed) { }
 
 	bool operator==(const AmfItem& other) const;
 
@@ -57,8 +57,13 @@ public:
 		return values.at(index);
 	}
 
-	std::vector<u8> serialize(SerializationContext& ctx) const;
-	static AmfVector<T> deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx);
+	using AmfItem::serialize;
+	void serialize(v8& buf, SerializationContext& ctx) const;
+	size_t serializedSize(SerializationContext& ctx) const;
+	static AmfVector<T> deserialize(const u8*& it, const u8* end, DeserializationContext& ctx);
+	static AmfVector<T> deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+		return with_pointers(deserialize, it, end, ctx);
+	}
 
 	std::vector<T> values;
 	bool fixed;
@@ -67,12 +72,21 @@ public:
 template<>
 class AmfVector<AmfItem> : public AmfItem {
 public:
-	AmfVector(std::string type, bool fixed = false) : type(type), fixed(fixed) { }
+	AmfVector(std::string type, bool fixed = false) :
+		AmfItem(AMF_VECTOR_OBJECT), type(type), fixed(fixed) { }
 
 	bool operator==(const AmfItem& other) const;
-	std::vector<u8> serialize(SerializationContext& ctx) const;
-	static AmfItemPtr deserializePtr(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx);
-	static AmfVector<AmfItem> deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx);
+	using AmfItem::serialize;
+	void serialize(v8& buf, SerializationContext& ctx) const;
+	size_t serializedSize(SerializationContext& ctx) const;
+	static AmfItemPtr deserializePtr(const u8*& it, const u8* end, DeserializationContext& ctx);
+	static AmfItemPtr deserializePtr(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+		return with_pointers(deserializePtr, it, end, ctx);
+	}
+	static AmfVector<AmfItem> deserialize(const u8*& it, const u8* end, DeserializationContext& ctx);
+	static AmfVector<AmfItem> deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+		return with_pointers(deserialize, it, end, ctx);
+	}
 
 	template<typename V, typename std::enable_if<std::is_base_of<AmfItem, V>::value, int>::type = 0>
 	AmfVector<V> as() {
@@ -97,7 +111,7 @@ public:
 	}
 
 	bool operator==(const AmfItem& other) const {
-		const AmfVector<T>* p = dynamic_cast<const AmfVector<T>*>(&other);
+		const AmfVector<T>* p = item_cast<AmfVector<T>>(&other);
 		return p != nullptr && fixed == p->fixed && type == p->type && values == p->values;
 	}
 
@@ -109,14 +123,25 @@ public:
 		return values.at(index).template as<T>();
 	}
 
-	static AmfVector<T> deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+	static AmfVector<T> deserialize(const u8*& it, const u8* end, DeserializationContext& ctx) {
 		return AmfVector<AmfItem>::deserialize(it, end, ctx).as<T>();
 	}
 
+	static AmfVector<T> deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+		return with_pointers(deserialize, it, end, ctx);
+	}
+
 private:
-	static AmfItemPtr deserializePtr(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx);
+	static AmfItemPtr deserializePtr(const u8*& it, const u8* end, DeserializationContext& ctx);
 };
 
+template<typename T>
+struct AmfItemTypeTag<AmfVector<T, typename VectorProperties<T>::type>> :
+	AmfTaggedType<VectorProperties<T>::marker> { };
+
+template<>
+struct AmfItemTypeTag<AmfVector<AmfItem>> : AmfTaggedType<AMF_VECTOR_OBJECT> { };
+
 } // namespace amf
 
 #endif
@@ -7,25 +7,36 @@
 namespace amf {
 
 bool AmfXml::operator==(const AmfItem& other) const {
-	const AmfXml* p = dynamic_cast<const AmfXml*>(&other);
+	const AmfXml* p = item_cast<AmfXml>(&other);
 	return p != nullptr && value == p->value;
 }
 
-std::vector<u8> AmfXml::serialize(SerializationContext& ctx) const {
+void AmfXml::serialize(v8& buf, SerializationContext& ctx) const {
+	buf.push_back(AMF_XML);
+
 	int index = ctx.getIndex(*this);
-	if (index != -1)
-		return std::vector<u8> { AMF_XML, u8(index << 1) };
+	if (index != -1) {
+		AmfInteger::serializeReference(buf, index);
+		return;
+	}
 	ctx.addObject(*this);
 
-	std::vector<u8> buf = AmfInteger::asLength(value.size(), AMF_XML);
+	AmfInteger::serializeLength(buf, value.size());
 
 	// the actual data is simply encoded as UTF8-chars
 	buf.insert(buf.end(), value.begin(), value.end());
+}
+
+size_t AmfXml::serializedSize(SerializationContext& ctx) const {
+	int index = ctx.getIndex(*this);
+	if (index != -1)
+		return 1 + AmfInteger::referenceSize(index);
+	ctx.addObject(*this);
 
-	return buf;
+	return 1 + AmfInteger::lengthSize(value.size()) + value.size();
 }
 
-AmfXml AmfXml::deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+AmfXml AmfXml::deserialize(const u8*& it, const u8* end, DeserializationContext& ctx) {
 	if (it == end || *it++ != AMF_XML)
 		throw std::invalid_argument("AmfXml: Invalid type marker");
 
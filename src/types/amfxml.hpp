@@ -13,16 +13,24 @@ class DeserializationContext;
 
 class AmfXml : public AmfItem {
 public:
-	AmfXml() { }
-	AmfXml(std::string value) : value(value) { }
+	AmfXml() : AmfItem(AMF_XML) { }
+	AmfXml(std::string value) : AmfItem(AMF_XML), value(value) { }
 
 	bool operator==(const AmfItem& other) const;
-	std::vector<u8> serialize(SerializationContext& ctx) const;
-	static AmfXml deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx);
+	using AmfItem::serialize;
+	void serialize(v8& buf, SerializationContext& ctx) const;
+	size_t serializedSize(SerializationContext& ctx) const;
+	static AmfXml deserialize(const u8*& it, const u8* end, DeserializationContext& ctx);
+	static AmfXml deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+		return with_pointers(deserialize, it, end, ctx);
+	}
 
 	std::string value;
 };
 
+template<>
+struct AmfItemTypeTag<AmfXml> : AmfTaggedType<AMF_XML> { };
+
 } // namespace amf
 
 #endif
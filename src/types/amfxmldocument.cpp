@@ -8,27 +8,38 @@
 namespace amf {
 
 bool AmfXmlDocument::operator==(const AmfItem& other) const {
-	const AmfXmlDocument* p = dynamic_cast<const AmfXmlDocument*>(&other);
+	const AmfXmlDocument* p = item_cast<AmfXmlDocument>(&other);
 	return p != nullptr && value == p->value;
 }
 
-std::vector<u8> AmfXmlDocument::serialize(SerializationContext& ctx) const {
+void AmfXmlDocument::serialize(v8& buf, SerializationContext& ctx) const {
+	buf.push_back(AMF_XMLDOC);
+
 	int index = ctx.getIndex(*this);
-	if (index != -1)
-		return std::vector<u8> { AMF_XMLDOC, u8(index << 1) };
+	if (index != -1) {
+		AmfInteger::serializeReference(buf, index);
+		return;
+	}
 	ctx.addObject(*this);
 
-	// Encode the type marker + length.
-	std::vector<u8> buf = AmfInteger::asLength(value.size(), AMF_XMLDOC);
+	// Encode the length.
+	AmfInteger::serializeLength(buf, value.size());
 
 	// Encode the data. According to the spec it's encoded as UTF-8 chars.
 	// We leave it up to the caller to ensure that's the case.
 	buf.insert(buf.end(), value.begin(), value.end());
+}
+
+size_t AmfXmlDocument::serializedSize(SerializationContext& ctx) const {
+	int index = ctx.getIndex(*this);
+	if (index != -1)
+		return 1 + AmfInteger::referenceSize(index);
+	ctx.addObject(*this);
 
-	return buf;
+	return 1 + AmfInteger::lengthSize(value.size()) + value.size();
 }
 
-AmfXmlDocument AmfXmlDocument::deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+AmfXmlDocument AmfXmlDocument::deserialize(const u8*& it, const u8* end, DeserializationContext& ctx) {
 	if (it == end || *it++ != AMF_XMLDOC)
 		throw std::invalid_argument("AmfXmlDocument: Invalid type marker");
 
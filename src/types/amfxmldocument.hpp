@@ -13,16 +13,24 @@ class DeserializationContext;
 
 class AmfXmlDocument : public AmfItem {
 public:
-	AmfXmlDocument() { }
-	AmfXmlDocument(std::string value) : value(value) { }
+	AmfXmlDocument() : AmfItem(AMF_XMLDOC) { }
+	AmfXmlDocument(std::string value) : AmfItem(AMF_XMLDOC), value(value) { }
 
 	bool operator==(const AmfItem& other) const;
-	std::vector<u8> serialize(SerializationContext& ctx) const;
-	static AmfXmlDocument deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx);
+	using AmfItem::serialize;
+	void serialize(v8& buf, SerializationContext& ctx) const;
+	size_t serializedSize(SerializationContext& ctx) const;
+	static AmfXmlDocument deserialize(const u8*& it, const u8* end, DeserializationContext& ctx);
+	static AmfXmlDocument deserialize(v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) {
+		return with_pointers(deserialize, it, end, ctx);
+	}
 
 	std::string value;
 };
 
+template<>
+struct AmfItemTypeTag<AmfXmlDocument> : AmfTaggedType<AMF_XMLDOC> { };
+
 } // namespace amf
 
 #endif
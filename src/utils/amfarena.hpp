@@ -0,0 +1,106 @@
+#pragma once
+#ifndef AMFARENA_HPP
+#define AMFARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "types/amfitem.hpp"
+
+namespace amf {
+
+// A monotonic memory region for AmfItems. Items are packed into large blocks
+// and are never freed individually; clear() or the destructor destroys all of
+// them at once and releases the memory.
+//
+// Pointers to items in an arena don't own them, so reference cycles between
+// them can't leak, and copying them never touches a reference count. In turn,
+// nothing keeps the items alive except the arena itself.
+class AmfArena {
+public:
+	explicit AmfArena(size_t blockSize = 4096) :
+		blockSize(blockSize), pos(nullptr), left(0), last(nullptr), count(0) { }
+	~AmfArena() { clear(); }
+
+	AmfArena(const AmfArena&) = delete;
+	AmfArena& operator=(const AmfArena&) = delete;
+
+	template<typename T, typename... Args>
+	T* create(Args&&... args) {
+		static_assert(std::is_base_of<AmfItem, T>::value,
+			"AmfArena can only hold AmfItems");
+
+		Node* node = static_cast<Node*>(allocate(sizeof(Node)));
+		T* item = new (allocate(sizeof(T))) T(std::forward<Args>(args)...);
+
+		node->item = item;
+		node->prev = last;
+		last = node;
+		++count;
+
+		return item;
+	}
+
+	// Destroys all items, in reverse order of creation, and frees all memory.
+	void clear() {
+		for (Node* node = last; node != nullptr; node = node->prev)
+			node->item->~AmfItem();
+
+		blocks.clear();
+		pos = nullptr;
+		left = 0;
+		last = nullptr;
+		count = 0;
+	}
+
+	// The number of items currently held by the arena.
+	size_t size() const { return count; }
+
+private:
+	struct Node {
+		AmfItem* item;
+		Node* prev;
+	};
+
+	static size_t aligned(size_t size) {
+		const size_t align = alignof(std::max_align_t);
+		return (size + align - 1) & ~(align - 1);
+	}
+
+	void* allocate(size_t size) {
+		size = aligned(size);
+
+		if (size > left) {
+			// Oversized allocations get a block of their own, so that we don't
+			// waste the rest of the current block.
+			if (size > blockSize / 4) {
+				blocks.emplace_back(new char[size]);
+				return blocks.back().get();
+			}
+
+			blocks.emplace_back(new char[blockSize]);
+			pos = blocks.back().get();
+			left = blockSize;
+		}
+
+		void* ret = pos;
+		pos += size;
+		left -= size;
+		return ret;
+	}
+
+	size_t blockSize;
+	std::vector<std::unique_ptr<char[]>> blocks;
+	char* pos;
+	size_t left;
+	Node* last;
+	size_t count;
+};
+
+} // namespace amf
+
+#endif
@@ -0,0 +1,294 @@
+#pragma once
+#ifndef AMFDENSEARRAY_HPP
+#define AMFDENSEARRAY_HPP
+
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
+
+#include "types/amfbool.hpp"
+#include "types/amfdouble.hpp"
+#include "types/amfinteger.hpp"
+#include "types/amfstring.hpp"
+#include "utils/amfitemptr.hpp"
+
+namespace amf {
+
+// The dense values of an AmfArray. As long as all values are integers, all
+// are doubles, all are booleans or all are strings, they are stored packed,
+// i.e. as plain values instead of an AmfItem per value, which takes a
+// fraction of the memory. The packed values can be read with integers(),
+// doubles(), bools() and strings().
+//
+// Adding a value of another type or an AmfItemPtr, or accessing the values
+// through non-const AmfItemPtr references, converts the array to AmfItemPtrs
+// for good. Const access never converts the array; for packed arrays it
+// returns new AmfItemPtrs holding copies of the values.
+class AmfDenseArray {
+public:
+	enum Storage {
+		EMPTY,
+		INTEGERS,
+		DOUBLES,
+		BOOLS,
+		STRINGS,
+		ITEMS
+	};
+
+	typedef AmfItemPtr value_type;
+	typedef std::vector<AmfItemPtr>::iterator iterator;
+
+	// Iterates the values as AmfItemPtrs, which are returned by value.
+	class const_iterator {
+	public:
+		typedef std::input_iterator_tag iterator_category;
+		typedef AmfItemPtr value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef void pointer;
+		typedef AmfItemPtr reference;
+
+		const_iterator(const AmfDenseArray* array, size_t index) :
+			array(array), index(index) { }
+
+		AmfItemPtr operator*() const { return array->item(index); }
+
+		const_iterator& operator++() { ++index; return *this; }
+		const_iterator operator++(int) { const_iterator ret(*this); ++index; return ret; }
+
+		bool operator==(const const_iterator& other) const {
+			return array == other.array && index == other.index;
+		}
+
+		bool operator!=(const const_iterator& other) const {
+			return !(*this == other);
+		}
+
+	private:
+		const AmfDenseArray* array;
+		size_t index;
+	};
+
+	AmfDenseArray() : storage(EMPTY), reserved(0) { }
+
+	Storage storageType() const { return storage; }
+	bool packed() const { return storage != ITEMS; }
+
+	size_t size() const {
+		switch (storage) {
+			case INTEGERS: return intValues.size();
+			case DOUBLES: return doubleValues.size();
+			case BOOLS: return boolValues.size();
+			case STRINGS: return stringValues.size();
+			default: return itemValues.size();
+		}
+	}
+
+	bool empty() const { return size() == 0; }
+
+	// Removes all values. The array is packed again afterwards.
+	void clear() {
+		storage = EMPTY;
+		reserved = 0;
+		std::vector<int>().swap(intValues);
+		std::vector<double>().swap(doubleValues);
+		std::vector<bool>().swap(boolValues);
+		std::vector<std::string>().swap(stringValues);
+		std::vector<AmfItemPtr>().swap(itemValues);
+	}
+
+	void reserve(size_t count) {
+		switch (storage) {
+			case EMPTY: reserved = count; break;
+			case INTEGERS: intValues.reserve(count); break;
+			case DOUBLES: doubleValues.reserve(count); break;
+			case BOOLS: boolValues.reserve(count); break;
+			case STRINGS: stringValues.reserve(count); break;
+			case ITEMS: itemValues.reserve(count); break;
+		}
+	}
+
+	// The packed values. Throw std::bad_cast if the array isn't empty and
+	// doesn't hold packed values of that type.
+	const std::vector<int>& integers() const { return packedValues(INTEGERS, intValues); }
+	const std::vector<double>& doubles() const { return packedValues(DOUBLES, doubleValues); }
+	const std::vector<bool>& bools() const { return packedValues(BOOLS, boolValues); }
+	const std::vector<std::string>& strings() const { return packedValues(STRINGS, stringValues); }
+	// The values of an array that isn't packed.
+	const std::vector<AmfItemPtr>& items() const { return packedValues(ITEMS, itemValues); }
+
+	void pushInteger(int value) {
+		if (pack(INTEGERS, intValues))
+			intValues.push_back(value);
+		else
+			itemValues.emplace_back(new AmfInteger(value));
+	}
+
+	void pushDouble(double value) {
+		if (pack(DOUBLES, doubleValues))
+			doubleValues.push_back(value);
+		else
+			itemValues.emplace_back(new AmfDouble(value));
+	}
+
+	void pushBool(bool value) {
+		if (pack(BOOLS, boolValues))
+			boolValues.push_back(value);
+		else
+			itemValues.emplace_back(new AmfBool(value));
+	}
+
+	void pushString(std::string value) {
+		if (pack(STRINGS, stringValues))
+			stringValues.push_back(std::move(value));
+		else
+			itemValues.emplace_back(new AmfString(std::move(value)));
+	}
+
+	void push_back(const AmfInteger& item) { pushInteger(item.value); }
+	void push_back(const AmfDouble& item) { pushDouble(item.value); }
+	void push_back(const AmfBool& item) { pushBool(item.value); }
+	void push_back(const AmfString& item) { pushString(item.value); }
+
+	template<class T, typename std::enable_if<std::is_base_of<AmfItem, T>::value, int>::type = 0>
+	void push_back(const T& item) {
+		unpack();
+		itemValues.emplace_back(new T(item));
+	}
+
+	// The item is stored as is (not packed), so it may be shared.
+	void push_back(const AmfItemPtr& item) {
+		unpack();
+		itemValues.push_back(item);
+	}
+
+	// Mutable element access, which converts packed arrays to AmfItemPtrs.
+	AmfItemPtr& operator[](size_t index) { unpack(); return itemValues[index]; }
+	AmfItemPtr& at(size_t index) { unpack(); return itemValues.at(index); }
+
+	iterator begin() { unpack(); return itemValues.begin(); }
+	iterator end() { unpack(); return itemValues.end(); }
+
+	// Const element access, which leaves packed arrays packed.
+	AmfItemPtr operator[](size_t index) const { return item(index); }
+	AmfItemPtr at(size_t index) const {
+		if (index >= size())
+			throw std::out_of_range("AmfDenseArray::at");
+
+		return item(index);
+	}
+
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, size()); }
+
+	// Compares the values, regardless of whether they are packed.
+	bool operator==(const AmfDenseArray& other) const {
+		if (size() != other.size())
+			return false;
+
+		if (storage == other.storage || storage == EMPTY || other.storage == EMPTY) {
+			switch (storage == EMPTY ? other.storage : storage) {
+				case EMPTY: return true;
+				case INTEGERS: return intValues == other.intValues;
+				case DOUBLES: return doubleValues == other.doubleValues;
+				case BOOLS: return boolValues == other.boolValues;
+				case STRINGS: return stringValues == other.stringValues;
+				case ITEMS: return itemValues == other.itemValues;
+			}
+		}
+
+		for (size_t i = 0; i < size(); ++i) {
+			if (item(i) != other.item(i))
+				return false;
+		}
+
+		return true;
+	}
+
+	bool operator!=(const AmfDenseArray& other) const {
+		return !(*this == other);
+	}
+
+private:
+	template<class V>
+	const std::vector<V>& packedValues(Storage type, const std::vector<V>& values) const {
+		if (storage != type && storage != EMPTY)
+			throw std::bad_cast();
+
+		return values;
+	}
+
+	// Prepares adding a value of type to values. Returns false if the value
+	// has to be added to itemValues instead.
+	template<class V>
+	bool pack(Storage type, std::vector<V>& values) {
+		if (storage == EMPTY) {
+			storage = type;
+			values.reserve(reserved);
+			reserved = 0;
+		}
+
+		if (storage == type)
+			return true;
+
+		unpack();
+		return false;
+	}
+
+	// A value as AmfItemPtr, without converting the array.
+	AmfItemPtr item(size_t index) const {
+		switch (storage) {
+			case INTEGERS: return AmfItemPtr(new AmfInteger(intValues[index]));
+			case DOUBLES: return AmfItemPtr(new AmfDouble(doubleValues[index]));
+			case BOOLS: return AmfItemPtr(new AmfBool(boolValues[index]));
+			case STRINGS: return AmfItemPtr(new AmfString(stringValues[index]));
+			default: return itemValues[index];
+		}
+	}
+
+	void unpack() {
+		if (storage == ITEMS)
+			return;
+
+		size_t count = size();
+		itemValues.reserve(count > reserved ? count : reserved);
+		for (size_t i = 0; i < count; ++i)
+			itemValues.push_back(item(i));
+
+		std::vector<int>().swap(intValues);
+		std::vector<double>().swap(doubleValues);
+		std::vector<bool>().swap(boolValues);
+		std::vector<std::string>().swap(stringValues);
+		storage = ITEMS;
+		reserved = 0;
+	}
+
+	// Only one of the vectors is used, depending on storage.
+	Storage storage;
+	size_t reserved;
+	std::vector<int> intValues;
+	std::vector<double> doubleValues;
+	std::vector<bool> boolValues;
+	std::vector<std::string> stringValues;
+	std::vector<AmfItemPtr> itemValues;
+};
+
+// The type that const access to a dense value of type T returns. Packed
+// values have no AmfItem that could be referred to, so the types which may be
+// packed are returned by value.
+template<class T>
+struct AmfDenseConstRef {
+	typedef const T& type;
+};
+
+template<> struct AmfDenseConstRef<AmfInteger> { typedef AmfInteger type; };
+template<> struct AmfDenseConstRef<AmfDouble> { typedef AmfDouble type; };
+template<> struct AmfDenseConstRef<AmfBool> { typedef AmfBool type; };
+template<> struct AmfDenseConstRef<AmfString> { typedef AmfString type; };
+
+} // namespace amf
+
+#endif
@@ -16,30 +16,44 @@ public:
 	template<typename T, typename std::enable_if<std::is_base_of<AmfItem, T>::value, int>::type = 0>
 	explicit AmfItemPtr(const T& ref) : std::shared_ptr<AmfItem>(new T(ref)) { }
 
+	// Returns a pointer that doesn't own ptr (and has no reference count), e.g.
+	// for items held by an AmfArena. ptr must outlive all copies of it.
+	static AmfItemPtr unowned(AmfItem* ptr) {
+		AmfItemPtr ret;
+		static_cast<std::shared_ptr<AmfItem>&>(ret) =
+			std::shared_ptr<AmfItem>(std::shared_ptr<AmfItem>(), ptr);
+		return ret;
+	}
+
 	template<typename T, typename std::enable_if<std::is_base_of<AmfItem, T>::value, int>::type = 0>
 	T& as() {
-		return dynamic_cast<T&>(*get());;
+		return item_cast<T>(*get());
 	}
 
 	template<typename T, typename std::enable_if<std::is_base_of<AmfItem, T>::value, int>::type = 0>
 	const T& as() const {
-		return dynamic_cast<const T&>(*get());
+		return item_cast<T>(static_cast<const AmfItem&>(*get()));
 	}
 
 	// WARNING: the pointer returned by this and get() is only valid as long as
 	//          the AmfItemPtr is still alive
 	template<typename T, typename std::enable_if<std::is_base_of<AmfItem, T>::value, int>::type = 0>
 	T* asPtr() {
-		return dynamic_cast<T*>(get());
+		return item_cast<T>(get());
 	}
 
 	template<typename T, typename std::enable_if<std::is_base_of<AmfItem, T>::value, int>::type = 0>
 	const T* asPtr() const {
-		return dynamic_cast<const T*>(get());
+		return item_cast<T>(static_cast<const AmfItem*>(get()));
 	}
 
+	// Compares the items pointed to. A null pointer is only equal to another
+	// null pointer.
 	bool operator==(const AmfItemPtr& other) const {
-		return this->get() == other.get() || *this->get() == *other.get();
+		if (this->get() == other.get())
+			return true;
+
+		return this->get() != nullptr && other.get() != nullptr && *this->get() == *other.get();
 	}
 
 	bool operator!=(const AmfItemPtr& other) const {
@@ -2,17 +2,47 @@
 #ifndef AMFOBJECTTRAITS_HPP
 #define AMFOBJECTTRAITS_HPP
 
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace amf {
 
+class AmfObjectTraits;
+
+// Traits shared by all objects of the same shape. Traits returned by
+// AmfObjectTraits::intern are immutable and unique per shape.
+typedef std::shared_ptr<const AmfObjectTraits> AmfObjectTraitsPtr;
+
 class AmfObjectTraits {
 public:
 	AmfObjectTraits(std::string className, bool dynamic, bool externalizable) :
-		className(className), dynamic(dynamic), externalizable(externalizable) { }
+		className(className), dynamic(dynamic), externalizable(externalizable), id(0) { }
+
+	// Copies are never interned, so they may be modified.
+	AmfObjectTraits(const AmfObjectTraits& other) :
+		className(other.className), dynamic(other.dynamic),
+		externalizable(other.externalizable), attributes(other.attributes),
+		slots(other.slots), id(0) { }
+
+	AmfObjectTraits& operator=(const AmfObjectTraits& other) {
+		className = other.className;
+		dynamic = other.dynamic;
+		externalizable = other.externalizable;
+		attributes = other.attributes;
+		slots = other.slots;
+		id = 0;
+		return *this;
+	}
 
 	bool operator==(const AmfObjectTraits& other) const {
+		// interned traits are unique per shape
+		if (id != 0 && other.id != 0)
+			return id == other.id;
+
 		return dynamic == other.dynamic &&
 			externalizable == other.externalizable &&
 			className == other.className &&
@@ -23,27 +53,105 @@ public:
 		return !(*this == other);
 	}
 
-	void addAttribute(const std::string & attr) {
-		if (!isAttributeExists(attr)) {
+	// Adds attr unless it exists already. Returns its index.
+	size_t addAttribute(const std::string & attr) {
+		auto slot = slots.emplace(attr, attributes.size());
+		if (slot.second) {
 			attributes.push_back(attr);
 		}
+
+		return slot.first->second;
 	}
-	
+
+	// The index of attr, or the number of attributes if it doesn't exist.
+	size_t getAttributeIndex(const std::string & attr) const {
+		auto slot = slots.find(attr);
+		return slot == slots.end() ? attributes.size() : slot->second;
+	}
+
 	const std::vector<std::string> & getAttriutes() const {
 		return attributes;
 	}
-	bool isAttributeExists(const std::string & attr) {
-		return std::find(attributes.begin(), attributes.end(), attr) != attributes.end();
+	bool isAttributeExists(const std::string & attr) const {
+		return slots.count(attr) != 0;
 	}
+
+	// A number identifying interned traits, which is never reused within the
+	// process. 0 for traits that aren't interned.
+	size_t getId() const {
+		return id;
+	}
+
+	// Returns the interned traits equal to traits. All callers (in any thread)
+	// get the same instance for the same shape as long as it is in use, so
+	// objects decoded from different packets share their traits.
+	static AmfObjectTraitsPtr intern(const AmfObjectTraits& traits);
+
 	std::string className;
 	
 	bool dynamic;
 	bool externalizable;
 private:
 	std::vector<std::string> attributes;
+	// Maps each attribute to its index.
+	std::unordered_map<std::string, size_t> slots;
+	size_t id;
+};
+
+struct AmfObjectTraitsHash {
+	size_t operator()(const AmfObjectTraits& traits) const {
+		std::hash<std::string> hash;
+		size_t seed = hash(traits.className);
+		seed ^= (traits.dynamic ? 0x01 : 0x00) | (traits.externalizable ? 0x02 : 0x00);
 
+		for (const std::string& attr : traits.getAttriutes())
+			seed ^= hash(attr) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+
+		return seed;
+	}
 };
 
+inline AmfObjectTraitsPtr AmfObjectTraits::intern(const AmfObjectTraits& traits) {
+	// The table only keeps weak pointers, so traits are freed once no object
+	// uses them anymore. Expired entries are removed whenever the table has
+	// doubled in size.
+	struct Table {
+		std::mutex mutex;
+		std::unordered_map<AmfObjectTraits, std::weak_ptr<const AmfObjectTraits>,
+			AmfObjectTraitsHash> entries;
+		size_t nextId = 1;
+		size_t sweepSize = 64;
+	};
+	static Table table;
+
+	std::lock_guard<std::mutex> lock(table.mutex);
+
+	auto it = table.entries.find(traits);
+	if (it != table.entries.end()) {
+		AmfObjectTraitsPtr interned = it->second.lock();
+		if (interned)
+			return interned;
+
+		table.entries.erase(it);
+	}
+
+	if (table.entries.size() >= table.sweepSize) {
+		for (auto entry = table.entries.begin(); entry != table.entries.end(); ) {
+			if (entry->second.expired())
+				entry = table.entries.erase(entry);
+			else
+				++entry;
+		}
+
+		table.sweepSize = std::max<size_t>(64, table.entries.size() * 2);
+	}
+
+	std::shared_ptr<AmfObjectTraits> interned = std::make_shared<AmfObjectTraits>(traits);
+	interned->id = table.nextId++;
+	table.entries.emplace(traits, interned);
+	return interned;
+}
+
 } // namespace amf
 
 #endif
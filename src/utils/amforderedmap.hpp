@@ -0,0 +1,224 @@
+#pragma once
+#ifndef AMFORDEREDMAP_HPP
+#define AMFORDEREDMAP_HPP
+
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "amfatom.hpp"
+
+namespace amf {
+
+// A map from strings to T that iterates in insertion order, used for the
+// dynamic properties of objects and the associative members of arrays, so
+// that they are serialized in the order they were read or added. Keys are
+// stored as AmfAtoms, so names that occur in many maps share their storage.
+//
+// The entries are stored in one vector. Maps with more than a few entries
+// additionally keep an open addressing hash index into that vector, small
+// maps are searched linearly. Keys must not be modified through iterators.
+template<class T>
+class AmfOrderedMap {
+public:
+	typedef AmfAtom key_type;
+	typedef T mapped_type;
+	typedef std::pair<AmfAtom, T> value_type;
+	typedef typename std::vector<value_type>::iterator iterator;
+	typedef typename std::vector<value_type>::const_iterator const_iterator;
+	typedef size_t size_type;
+
+	AmfOrderedMap() { }
+	AmfOrderedMap(std::initializer_list<std::pair<std::string, T>> values) {
+		reserve(values.size());
+		for (const auto& value : values)
+			insert(value);
+	}
+
+	iterator begin() { return entries.begin(); }
+	iterator end() { return entries.end(); }
+	const_iterator begin() const { return entries.begin(); }
+	const_iterator end() const { return entries.end(); }
+
+	size_t size() const { return entries.size(); }
+	bool empty() const { return entries.empty(); }
+
+	void clear() {
+		entries.clear();
+		slots.clear();
+	}
+
+	// Makes room for count entries, so that inserting them doesn't
+	// reallocate or rehash.
+	void reserve(size_t count) {
+		entries.reserve(count);
+		if (count > linearLimit && slots.size() < slotCount(count))
+			rehash(slotCount(count));
+	}
+
+	iterator find(const std::string& key) {
+		size_t index = lookup(key, AmfAtom::hash(key));
+		return index == npos ? entries.end() : entries.begin() + index;
+	}
+
+	const_iterator find(const std::string& key) const {
+		size_t index = lookup(key, AmfAtom::hash(key));
+		return index == npos ? entries.end() : entries.begin() + index;
+	}
+
+	size_t count(const std::string& key) const {
+		return lookup(key, AmfAtom::hash(key)) == npos ? 0 : 1;
+	}
+
+	T& at(const std::string& key) {
+		size_t index = lookup(key, AmfAtom::hash(key));
+		if (index == npos)
+			throw std::out_of_range("AmfOrderedMap::at");
+
+		return entries[index].second;
+	}
+
+	const T& at(const std::string& key) const {
+		size_t index = lookup(key, AmfAtom::hash(key));
+		if (index == npos)
+			throw std::out_of_range("AmfOrderedMap::at");
+
+		return entries[index].second;
+	}
+
+	// Existing keys keep their position.
+	T& operator[](const std::string& key) {
+		size_t index = lookup(key, AmfAtom::hash(key));
+		if (index != npos)
+			return entries[index].second;
+
+		return emplace(AmfAtom(key), T()).first->second;
+	}
+
+	T& operator[](const AmfAtom& key) {
+		return emplace(key, T()).first->second;
+	}
+
+	std::pair<iterator, bool> insert(const value_type& value) {
+		return emplace(value.first, value.second);
+	}
+
+	std::pair<iterator, bool> insert(const std::pair<std::string, T>& value) {
+		return emplace(AmfAtom(value.first), value.second);
+	}
+
+	// Appends key unless it exists already.
+	template<class V>
+	std::pair<iterator, bool> emplace(const AmfAtom& key, V&& value) {
+		size_t index = lookup(key, key.hash());
+		if (index != npos)
+			return std::make_pair(entries.begin() + index, false);
+
+		entries.emplace_back(key, std::forward<V>(value));
+
+		if (!slots.empty() || entries.size() > linearLimit) {
+			if (slots.size() < slotCount(entries.size()))
+				rehash(slotCount(entries.size()) * 2);
+			else
+				link(entries.size() - 1);
+		}
+
+		return std::make_pair(entries.end() - 1, true);
+	}
+
+	// Removes key, keeping the order of the other entries. This takes time
+	// linear in the size of the map.
+	size_t erase(const std::string& key) {
+		size_t index = lookup(key, AmfAtom::hash(key));
+		if (index == npos)
+			return 0;
+
+		entries.erase(entries.begin() + index);
+		if (!slots.empty())
+			rehash(slots.size());
+
+		return 1;
+	}
+
+	// Maps are equal if they contain the same keys and values, regardless of
+	// their order.
+	bool operator==(const AmfOrderedMap& other) const {
+		if (size() != other.size())
+			return false;
+
+		for (size_t i = 0; i < entries.size(); ++i) {
+			size_t index = other.lookup(entries[i].first, entries[i].first.hash());
+			if (index == npos || !(other.entries[index].second == entries[i].second))
+				return false;
+		}
+
+		return true;
+	}
+
+	bool operator!=(const AmfOrderedMap& other) const {
+		return !(*this == other);
+	}
+
+private:
+	static const size_t npos = static_cast<size_t>(-1);
+	// Maps with up to this many entries have no hash index.
+	static const size_t linearLimit = 8;
+
+	// The smallest power of two keeping the index at most half full.
+	static size_t slotCount(size_t count) {
+		size_t slots = 16;
+		while (slots < count * 2)
+			slots *= 2;
+
+		return slots;
+	}
+
+	// Finds a std::string or AmfAtom key, which hashes to keyHash.
+	template<class K>
+	size_t lookup(const K& key, size_t keyHash) const {
+		if (slots.empty()) {
+			for (size_t i = 0; i < entries.size(); ++i) {
+				if (entries[i].first.hash() == keyHash && entries[i].first == key)
+					return i;
+			}
+
+			return npos;
+		}
+
+		size_t mask = slots.size() - 1;
+		for (size_t slot = keyHash & mask; slots[slot] != 0; slot = (slot + 1) & mask) {
+			size_t index = slots[slot] - 1;
+			if (entries[index].first.hash() == keyHash && entries[index].first == key)
+				return index;
+		}
+
+		return npos;
+	}
+
+	// Adds the entry at index to the hash index.
+	void link(size_t index) {
+		size_t mask = slots.size() - 1;
+		size_t slot = entries[index].first.hash() & mask;
+		while (slots[slot] != 0)
+			slot = (slot + 1) & mask;
+
+		slots[slot] = static_cast<uint32_t>(index + 1);
+	}
+
+	void rehash(size_t count) {
+		slots.assign(count, 0);
+		for (size_t i = 0; i < entries.size(); ++i)
+			link(i);
+	}
+
+	std::vector<value_type> entries;
+	// Indices into entries plus one, 0 for empty slots.
+	std::vector<uint32_t> slots;
+};
+
+} // namespace amf
+
+#endif
@@ -0,0 +1,159 @@
+#pragma once
+#ifndef AMFSTRINGVIEW_HPP
+#define AMFSTRINGVIEW_HPP
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace amf {
+
+// A non-owning reference to a string, e.g. in a deserialization input buffer.
+class AmfStringView {
+public:
+	AmfStringView() : ptr(nullptr), len(0) { }
+	AmfStringView(const char* data, size_t size) : ptr(data), len(size) { }
+	explicit AmfStringView(const char* str) : ptr(str), len(std::strlen(str)) { }
+	explicit AmfStringView(const std::string& str) : ptr(str.data()), len(str.size()) { }
+
+	const char* data() const { return ptr; }
+	size_t size() const { return len; }
+	bool empty() const { return len == 0; }
+
+	const char* begin() const { return ptr; }
+	const char* end() const { return ptr + len; }
+
+	std::string str() const { return std::string(ptr, len); }
+
+	bool operator==(const AmfStringView& other) const {
+		return len == other.len &&
+			(len == 0 || ptr == other.ptr || std::memcmp(ptr, other.ptr, len) == 0);
+	}
+
+	bool operator!=(const AmfStringView& other) const {
+		return !(*this == other);
+	}
+
+	bool operator==(const std::string& other) const {
+		return *this == AmfStringView(other);
+	}
+
+	bool operator!=(const std::string& other) const {
+		return !(*this == other);
+	}
+
+	bool operator==(const char* other) const {
+		return *this == AmfStringView(other);
+	}
+
+	bool operator!=(const char* other) const {
+		return !(*this == other);
+	}
+
+private:
+	const char* ptr;
+	size_t len;
+};
+
+inline bool operator==(const std::string& lhs, const AmfStringView& rhs) {
+	return rhs == lhs;
+}
+
+inline bool operator!=(const std::string& lhs, const AmfStringView& rhs) {
+	return rhs != lhs;
+}
+
+inline bool operator==(const char* lhs, const AmfStringView& rhs) {
+	return rhs == lhs;
+}
+
+inline bool operator!=(const char* lhs, const AmfStringView& rhs) {
+	return rhs != lhs;
+}
+
+// Append-only storage for strings. Stored strings are never moved, so views
+// to them stay valid until the slab is cleared or destroyed. Small strings
+// are packed into shared chunks instead of being allocated individually.
+//
+// Copies share the chunks stored so far (so views into them stay valid as
+// long as any copy is alive), but store new strings in separate chunks.
+class AmfStringSlab {
+public:
+	AmfStringSlab() : pos(nullptr), left(0) { }
+	AmfStringSlab(const AmfStringSlab& other) :
+		chunks(other.chunks), pos(nullptr), left(0) { }
+
+	AmfStringSlab& operator=(const AmfStringSlab& other) {
+		chunks = other.chunks;
+		pos = nullptr;
+		left = 0;
+		return *this;
+	}
+
+	AmfStringView store(const char* data, size_t size) {
+		if (size == 0)
+			return AmfStringView();
+
+		char* dest;
+		if (size > CHUNK_SIZE / 4) {
+			// Large strings get a chunk of their own, so that we don't waste
+			// the remainder of the current chunk.
+			dest = allocate(size);
+		} else {
+			if (size > left) {
+				pos = allocate(CHUNK_SIZE);
+				left = CHUNK_SIZE;
+			}
+
+			dest = pos;
+			pos += size;
+			left -= size;
+		}
+
+		std::memcpy(dest, data, size);
+		return AmfStringView(dest, size);
+	}
+
+	void clear() {
+		chunks.clear();
+		pos = nullptr;
+		left = 0;
+	}
+
+	// The state of the slab, to drop the strings stored afterwards with
+	// rewind. Views of the dropped strings are invalidated.
+	struct Mark {
+		size_t chunks;
+		char* pos;
+		size_t left;
+	};
+
+	Mark mark() const {
+		Mark mark = { chunks.size(), pos, left };
+		return mark;
+	}
+
+	// The slab must not have been cleared since the mark was taken.
+	void rewind(const Mark& mark) {
+		chunks.resize(mark.chunks);
+		pos = mark.pos;
+		left = mark.left;
+	}
+
+private:
+	static const size_t CHUNK_SIZE = 4096;
+
+	char* allocate(size_t size) {
+		chunks.emplace_back(new char[size], std::default_delete<char[]>());
+		return chunks.back().get();
+	}
+
+	std::vector<std::shared_ptr<char>> chunks;
+	char* pos;
+	size_t left;
+};
+
+} // namespace amf
+
+#endif
@@ -0,0 +1,89 @@
+#include "amftest.hpp"
+
+#include "amfatom.hpp"
+#include "serializationcontext.hpp"
+#include "types/amfstring.hpp"
+
+TEST(AmfAtomTest, Interning) {
+	AmfAtom foo1("atomTestFoo");
+	AmfAtom foo2(std::string("atomTestFoo"));
+	AmfAtom foo3(AmfStringView("atomTestFoo!", 11));
+	AmfAtom bar("atomTestBar");
+
+	EXPECT_EQ("atomTestFoo", foo1.str());
+	EXPECT_NE(0u, foo1.id());
+	EXPECT_EQ(foo1.id(), foo2.id());
+	EXPECT_EQ(foo1.id(), foo3.id());
+	EXPECT_EQ(&foo1.str(), &foo3.str());
+	EXPECT_NE(foo1.id(), bar.id());
+
+	EXPECT_EQ(foo1, foo2);
+	EXPECT_NE(foo1, bar);
+	EXPECT_EQ(foo1, "atomTestFoo");
+	EXPECT_EQ(std::string("atomTestFoo"), foo1);
+	EXPECT_NE(bar, "atomTestFoo");
+	EXPECT_EQ(AmfAtom::hash("atomTestFoo", 11), foo1.hash());
+}
+
+TEST(AmfAtomTest, Empty) {
+	AmfAtom empty;
+	EXPECT_TRUE(empty.empty());
+	EXPECT_EQ(0u, empty.id());
+	EXPECT_EQ(AmfAtom(""), empty);
+	EXPECT_EQ(AmfAtom::hash("", 0), empty.hash());
+}
+
+TEST(AmfAtomTest, TooLong) {
+	std::string name(65, 'x');
+	AmfAtom atom1(name);
+	AmfAtom atom2(name);
+
+	// Atoms that aren't interned are compared by value.
+	EXPECT_EQ(0u, atom1.id());
+	EXPECT_NE(&atom1.str(), &atom2.str());
+	EXPECT_EQ(atom1, atom2);
+	EXPECT_NE(atom1, AmfAtom(std::string(66, 'x')));
+
+	AmfAtom copy(atom1);
+	atom1 = AmfAtom("x");
+	EXPECT_EQ(name, copy.str());
+}
+
+TEST(AmfAtomTest, Statistics) {
+	AmfAtom::Statistics before = AmfAtom::statistics();
+	AmfAtom first("atomTestStatistics");
+	AmfAtom second("atomTestStatistics");
+	AmfAtom::Statistics after = AmfAtom::statistics();
+
+	EXPECT_EQ(before.atoms + 1, after.atoms);
+	EXPECT_EQ(before.bytes + 18, after.bytes);
+	EXPECT_EQ(before.lookups + 2, after.lookups);
+	EXPECT_EQ(before.hits + 1, after.hits);
+}
+
+TEST(AmfAtomTest, SerializationContext) {
+	SerializationContext ctx;
+	AmfAtom atom("atomTestContext");
+
+	EXPECT_EQ(-1, ctx.getIndex(atom));
+	ctx.addString(std::string("foo"));
+	ctx.addString(atom);
+	EXPECT_EQ(1, ctx.getIndex(atom));
+	EXPECT_EQ(1, ctx.getIndex(std::string("atomTestContext")));
+
+	// Strings and atoms share the string table.
+	ctx.addString(std::string("atomTestContext2"));
+	EXPECT_EQ(2, ctx.getIndex(AmfAtom("atomTestContext2")));
+
+	v8 buf;
+	AmfString::serializeValue(buf, atom, ctx);
+	EXPECT_EQ(v8({ 0x02 }), buf);
+
+	ctx.clear();
+	EXPECT_EQ(-1, ctx.getIndex(atom));
+	buf.clear();
+	AmfString::serializeValue(buf, atom, ctx);
+	AmfString::serializeValue(buf, std::string("atomTestContext"), ctx);
+	EXPECT_EQ(17u, buf.size());
+	EXPECT_EQ(0x00, buf.back());
+}
@@ -0,0 +1,101 @@
+#include "amftest.hpp"
+
+#include "amfpacket.hpp"
+#include "amfpacketbuilder.hpp"
+#include "types/amfarray.hpp"
+#include "types/amfinteger.hpp"
+#include "types/amfstring.hpp"
+
+static AmfPacket deserializePacket(const v8& data) {
+	DeserializationContext ctx;
+	const u8* it = data.data();
+	AmfPacket packet = AmfPacket::deserialize(it, it + data.size(), ctx);
+	EXPECT_EQ(data.data() + data.size(), it);
+	return packet;
+}
+
+TEST(AmfPacketBuilderTest, SinglePacket) {
+	AmfPacket packet;
+	packet.headers.emplace_back("DSId", false, AmfString("1234-abcd"));
+	packet.messages.emplace_back("/1/onResult", "", AmfString("foo"));
+	packet.messages.emplace_back("/2/onResult", "", AmfArray(std::vector<AmfInteger> { 1, 2 }));
+
+	AmfPacketBuilder builder(1024);
+	builder.addHeader(packet.headers[0]);
+	builder.addMessage(packet.messages[0]);
+	builder.addMessage(packet.messages[1]);
+	EXPECT_TRUE(builder.packets().empty());
+
+	builder.flush();
+	ASSERT_EQ(1u, builder.packets().size());
+
+	SerializationContext ctx;
+	EXPECT_EQ(packet.serialize(ctx), builder.packets()[0]);
+
+	// nothing to flush
+	builder.flush();
+	EXPECT_EQ(1u, builder.packets().size());
+	EXPECT_THROW(builder.addHeader(packet.headers[0]), std::invalid_argument);
+}
+
+TEST(AmfPacketBuilderTest, Split) {
+	PacketHeader header("h", false, AmfInteger(1));
+	// 6 bytes framing, 14 bytes header
+	size_t empty = 2 + 2 + 1 + 2 + 1 + 4 + 1 + 2 + 2;
+	// 12 bytes framing, 5 bytes value
+	size_t message = 2 + 2 + 2 + 2 + 4 + 1 + 5;
+
+	AmfPacketBuilder builder(empty + 3 * message);
+	builder.addHeader(header);
+
+	std::vector<PacketMessage> messages;
+	for (int i = 0; i < 7; ++i) {
+		messages.emplace_back("t" + std::to_string(i), "r" + std::to_string(i), AmfString("abc"));
+		builder.addMessage(messages.back());
+	}
+
+	// the seventh message is still in the current packet
+	ASSERT_EQ(2u, builder.packets().size());
+	builder.flush();
+	ASSERT_EQ(3u, builder.packets().size());
+
+	for (size_t p = 0; p < 3; ++p) {
+		const v8& data = builder.packets()[p];
+		EXPECT_EQ(p < 2 ? empty + 3 * message : empty + message, data.size());
+
+		AmfPacket packet = deserializePacket(data);
+		ASSERT_EQ(1u, packet.headers.size());
+		EXPECT_EQ(header, packet.headers[0]);
+		for (size_t m = 0; m < packet.messages.size(); ++m)
+			EXPECT_EQ(messages[p * 3 + m], packet.messages[m]);
+	}
+
+	std::vector<v8> taken;
+	taken.swap(builder.packets());
+	builder.addMessage(messages[0]);
+	builder.flush();
+	ASSERT_EQ(1u, builder.packets().size());
+	EXPECT_EQ(empty + message, builder.packets()[0].size());
+}
+
+TEST(AmfPacketBuilderTest, TooLarge) {
+	EXPECT_THROW(AmfPacketBuilder(5), std::length_error);
+
+	AmfPacketBuilder builder(6 + 2 * 13);
+	EXPECT_THROW(builder.addHeader(PacketHeader("header", false, AmfString(std::string(20, 'x')))),
+		std::length_error);
+
+	// a message that can't fit into any packet is rejected
+	PacketMessage small("t", "r", AmfInteger(1));
+	PacketMessage large("t", "r", AmfString(std::string(20, 'x')));
+	EXPECT_THROW(builder.addMessage(large), std::length_error);
+	builder.addMessage(small);
+	EXPECT_THROW(builder.addMessage(large), std::length_error);
+	builder.addMessage(small);
+	builder.flush();
+
+	ASSERT_EQ(1u, builder.packets().size());
+	AmfPacket packet = deserializePacket(builder.packets()[0]);
+	ASSERT_EQ(2u, packet.messages.size());
+	EXPECT_EQ(small, packet.messages[1]);
+}
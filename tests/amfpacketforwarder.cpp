@@ -0,0 +1,132 @@
+#include "amftest.hpp"
+
+#include "amfpacket.hpp"
+#include "amfpacketforwarder.hpp"
+#include "deserializationcontext.hpp"
+#include "serializationcontext.hpp"
+#include "types/amfarray.hpp"
+#include "types/amfinteger.hpp"
+#include "types/amfstring.hpp"
+
+static AmfPacket makePacket() {
+	AmfPacket packet;
+	packet.headers.emplace_back("DSId", false, AmfString("1234-abcd"));
+	packet.messages.emplace_back("svc.update", "/1", AmfArray(std::vector<AmfString> { "a", "b" }));
+	packet.messages.emplace_back("svc.ping", "/2", AmfInteger(7));
+	return packet;
+}
+
+TEST(AmfPacketForwarderTest, Unchanged) {
+	SerializationContext sctx;
+	v8 data = makePacket().serialize(sctx);
+	v8 input(data);
+	input.push_back(0xff);
+
+	AmfPacketForwarder forwarder(input);
+	v8 output;
+	forwarder.write(output);
+	EXPECT_EQ(data, output);
+}
+
+TEST(AmfPacketForwarderTest, Rewrite) {
+	SerializationContext sctx;
+	v8 data = makePacket().serialize(sctx);
+
+	AmfPacketForwarder forwarder(data);
+	ASSERT_EQ(1u, forwarder.headers.size());
+	EXPECT_EQ("DSId", forwarder.headers[0].name);
+	ASSERT_EQ(2u, forwarder.messages.size());
+	EXPECT_EQ("svc.update", forwarder.messages[0].target);
+	EXPECT_EQ("/2", forwarder.messages[1].response);
+
+	forwarder.headers[0].mustUnderstand = true;
+	forwarder.messages[0].target = "backend-3/svc.update";
+	std::swap(forwarder.messages[0], forwarder.messages[1]);
+	forwarder.messages.pop_back();
+	forwarder.messages.push_back(forwarder.messages[0]);
+	forwarder.messages.back().response = "/3";
+
+	v8 output { 0xff };
+	forwarder.write(output);
+
+	AmfPacket expected;
+	expected.headers.emplace_back("DSId", true, AmfString("1234-abcd"));
+	expected.messages.emplace_back("svc.ping", "/2", AmfInteger(7));
+	expected.messages.emplace_back("svc.ping", "/3", AmfInteger(7));
+
+	DeserializationContext ctx;
+	auto it = output.cbegin() + 1;
+	EXPECT_EQ(expected, AmfPacket::deserialize(it, output.cend(), ctx));
+	EXPECT_EQ(output.cend(), it);
+}
+
+TEST(AmfPacketForwarderTest, Segments) {
+	SerializationContext sctx;
+	v8 data = makePacket().serialize(sctx);
+
+	AmfPacketForwarder forwarder(data);
+	forwarder.messages[1].target = "svc.pong";
+	std::vector<AmfPacketForwarder::Segment> segments = forwarder.segments();
+
+	// framing and value of each entry, the values point into the input
+	ASSERT_EQ(6u, segments.size());
+	EXPECT_EQ(forwarder.headers[0].value, segments[1].data);
+	EXPECT_EQ(forwarder.messages[0].value, segments[3].data);
+	EXPECT_EQ(forwarder.messages[1].value, segments[5].data);
+	EXPECT_EQ(data.data() + data.size() - 2, segments[5].data);
+	EXPECT_EQ(2u, segments[5].size);
+
+	isEqual(v8 {
+		0x00, 0x08, 0x73, 0x76, 0x63, 0x2e, 0x70, 0x6f, 0x6e, 0x67, // target-uri: "svc.pong"
+		0x00, 0x02, 0x2f, 0x32, // response-uri: "/2"
+		0x00, 0x00, 0x00, 0x03, // value length: 3
+		0x11 // AMF3 object marker
+	}, v8(segments[4].data, segments[4].data + segments[4].size));
+
+	// without messages, the framing ends the packet
+	forwarder.messages.clear();
+	segments = forwarder.segments();
+	ASSERT_EQ(3u, segments.size());
+	isEqual(v8 { 0x00, 0x00 }, v8(segments[2].data, segments[2].data + segments[2].size));
+}
+
+TEST(AmfPacketForwarderTest, UnknownLength) {
+	v8 data {
+		0x00, 0x03,
+		0x00, 0x00,
+		0x00, 0x01,
+		0x00, 0x01, 0x74, 0x00, 0x01, 0x72,
+		0xff, 0xff, 0xff, 0xff,
+		0x11, 0x06, 0x0b, 0x76, 0x61, 0x6c, 0x75, 0x65
+	};
+
+	AmfPacketForwarder forwarder(data);
+	v8 output;
+	forwarder.write(output);
+
+	isEqual(v8 {
+		0x00, 0x03,
+		0x00, 0x00,
+		0x00, 0x01,
+		0x00, 0x01, 0x74, 0x00, 0x01, 0x72,
+		0x00, 0x00, 0x00, 0x08, // measured value length
+		0x11, 0x06, 0x0b, 0x76, 0x61, 0x6c, 0x75, 0x65
+	}, output);
+}
+
+TEST(AmfPacketForwarderTest, Invalid) {
+	v8 truncated { 0x00, 0x03, 0x00, 0x01 };
+	EXPECT_THROW(AmfPacketForwarder(truncated.data(), truncated.size()), std::out_of_range);
+
+	SerializationContext sctx;
+	v8 data = makePacket().serialize(sctx);
+	AmfPacketForwarder forwarder(data);
+
+	forwarder.messages[0].target = std::string(65536, 'x');
+	EXPECT_THROW(forwarder.segments(), std::length_error);
+
+	forwarder.messages.resize(65536, forwarder.messages[1]);
+	v8 output;
+	EXPECT_THROW(forwarder.write(output), std::length_error);
+	EXPECT_TRUE(output.empty());
+}
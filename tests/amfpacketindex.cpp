@@ -0,0 +1,197 @@
+#include "amftest.hpp"
+
+#include "amfpacketindex.hpp"
+#include "deserializationcontext.hpp"
+#include "incrementaldeserializer.hpp"
+#include "lazydeserializer.hpp"
+#include "serializationcontext.hpp"
+#include "types/amfarray.hpp"
+#include "types/amfinteger.hpp"
+#include "types/amfobject.hpp"
+#include "types/amfstring.hpp"
+
+static AmfPacket makePacket() {
+	AmfObject call("", true, false);
+	call.addDynamicProperty("method", AmfString("update"));
+	call.addDynamicProperty("args", AmfArray(std::vector<AmfInteger> { 1, 2, 3 }));
+
+	AmfPacket packet;
+	packet.headers.emplace_back("auth", true, AmfString("secret"));
+	packet.headers.emplace_back("DSId", false, AmfString("1234-abcd"));
+	packet.messages.emplace_back("svc.update", "/1", call);
+	packet.messages.emplace_back("svc.ping", "/2", AmfInteger(7));
+	return packet;
+}
+
+TEST(AmfPacketIndexTest, Envelope) {
+	SerializationContext sctx;
+	v8 data = makePacket().serialize(sctx);
+	size_t size = data.size();
+	data.push_back(0xff);
+
+	AmfPacketIndex index(data);
+	EXPECT_EQ(size, index.size());
+
+	ASSERT_EQ(2u, index.headers().size());
+	EXPECT_EQ("auth", index.headers()[0].name);
+	EXPECT_TRUE(index.headers()[0].mustUnderstand);
+	EXPECT_EQ("DSId", index.headers()[1].name);
+	EXPECT_FALSE(index.headers()[1].mustUnderstand);
+
+	ASSERT_EQ(2u, index.messages().size());
+	EXPECT_EQ("svc.update", index.messages()[0].name);
+	EXPECT_EQ("/1", index.messages()[0].response);
+	EXPECT_EQ("svc.ping", index.messages()[1].name);
+	EXPECT_EQ("/2", index.messages()[1].response);
+	EXPECT_FALSE(index.messages()[1].mustUnderstand);
+
+	// version, header count, name length, "auth", must understand flag,
+	// value length, AVMPLUS_OBJECT marker
+	const AmfPacketIndex::Entry& header = index.headers()[0];
+	EXPECT_EQ(4u, header.offset);
+	EXPECT_EQ(4u + 2 + 4 + 1 + 4 + 1, header.valueOffset);
+	EXPECT_EQ(8u, header.valueLength);
+	EXPECT_EQ(header.valueOffset + header.valueLength, index.headers()[1].offset);
+
+	// the last value ends with the packet
+	const AmfPacketIndex::Entry& message = index.messages()[1];
+	EXPECT_EQ(2u, message.valueLength);
+	isEqual(v8 { 0x04, 0x07 }, v8(data.begin() + message.valueOffset,
+		data.begin() + message.valueOffset + message.valueLength));
+	EXPECT_EQ(size, message.valueOffset + message.valueLength);
+}
+
+TEST(AmfPacketIndexTest, Decode) {
+	AmfPacket packet = makePacket();
+	SerializationContext sctx;
+	v8 data = packet.serialize(sctx);
+
+	AmfPacketIndex index(data);
+	DeserializationContext ctx;
+
+	// in any order, each with its own reference tables
+	EXPECT_EQ(packet.messages[1], index.decodeMessage(1, ctx));
+	EXPECT_EQ(packet.headers[1], index.decodeHeader(1, ctx));
+	EXPECT_EQ(packet.messages[0], index.decodeMessage(0, ctx));
+	EXPECT_EQ(packet.headers[0], index.decodeHeader(0, ctx));
+
+	EXPECT_THROW(index.decodeHeader(2, ctx), std::out_of_range);
+	EXPECT_THROW(index.decodeMessage(2, ctx), std::out_of_range);
+}
+
+TEST(AmfPacketIndexTest, UnknownLength) {
+	v8 data {
+		0x00, 0x03,
+		0x00, 0x00,
+		0x00, 0x02,
+		0x00, 0x01, 0x74, 0x00, 0x01, 0x72,
+		0xff, 0xff, 0xff, 0xff,
+		0x11, 0x09, 0x05, 0x01, 0x04, 0x01, 0x04, 0x02,
+		0x00, 0x01, 0x75, 0x00, 0x00,
+		0xff, 0xff, 0xff, 0xff,
+		0x11, 0x06, 0x0b, 0x76, 0x61, 0x6c, 0x75, 0x65
+	};
+
+	AmfPacketIndex index(data);
+	EXPECT_EQ(data.size(), index.size());
+	ASSERT_EQ(2u, index.messages().size());
+	EXPECT_EQ(17u, index.messages()[0].valueOffset);
+	EXPECT_EQ(7u, index.messages()[0].valueLength);
+	EXPECT_EQ(24u, index.messages()[1].offset);
+	EXPECT_EQ("u", index.messages()[1].name);
+	EXPECT_EQ("", index.messages()[1].response);
+	EXPECT_EQ(7u, index.messages()[1].valueLength);
+
+	DeserializationContext ctx;
+	EXPECT_EQ(PacketMessage("u", "", AmfString("value")), index.decodeMessage(1, ctx));
+	EXPECT_EQ(PacketMessage("t", "r", AmfArray(std::vector<AmfInteger> { 1, 2 })),
+		index.decodeMessage(0, ctx));
+}
+
+TEST(AmfPacketIndexTest, SharedFraming) {
+	// The value length of the first message includes a padding byte after
+	// the value, which every reader skips.
+	v8 data {
+		0x00, 0x03,
+		0x00, 0x00,
+		0x00, 0x02,
+		0x00, 0x01, 0x74, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x04,
+		0x11, 0x04, 0x07, 0x00,
+		0x00, 0x01, 0x75, 0x00, 0x00,
+		0xff, 0xff, 0xff, 0xff,
+		0x11, 0x04, 0x08
+	};
+
+	PacketMessage first("t", "", AmfInteger(7));
+	PacketMessage second("u", "", AmfInteger(8));
+
+	AmfPacketIndex index(data);
+	EXPECT_EQ(3u, index.messages()[0].valueLength);
+	EXPECT_EQ(19u, index.messages()[1].offset);
+
+	DeserializationContext ctx;
+	v8::const_iterator it = data.cbegin();
+	AmfPacket packet = AmfPacket::deserialize(it, data.cend(), ctx);
+	EXPECT_EQ(data.cend(), it);
+	ASSERT_EQ(2u, packet.messages.size());
+	EXPECT_EQ(first, packet.messages[0]);
+	EXPECT_EQ(second, packet.messages[1]);
+
+	LazyPacket lazy(data);
+	ASSERT_EQ(2u, lazy.messageCount());
+	EXPECT_EQ(7, lazy.message(0).asInt());
+	EXPECT_EQ("u", lazy.messageTarget(1));
+	EXPECT_EQ(8, lazy.message(1).asInt());
+
+	IncrementalPacketDeserializer incremental;
+	incremental.push(data);
+	PacketMessage message("", "", AmfInteger(0));
+	ASSERT_TRUE(incremental.nextMessage(message));
+	EXPECT_EQ(first, message);
+	ASSERT_TRUE(incremental.nextMessage(message));
+	EXPECT_EQ(second, message);
+	EXPECT_TRUE(incremental.finished());
+}
+
+TEST(AmfPacketIndexTest, Invalid) {
+	SerializationContext sctx;
+	v8 data = makePacket().serialize(sctx);
+
+	// truncated anywhere
+	for (size_t size = 0; size < data.size(); ++size)
+		EXPECT_THROW(AmfPacketIndex(data.data(), size), std::out_of_range) << size;
+
+	v8 version { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+	EXPECT_THROW(AmfPacketIndex(version.data(), version.size()), std::invalid_argument);
+
+	v8 marker {
+		0x00, 0x03,
+		0x00, 0x01,
+		0x00, 0x01, 0x68, 0x00,
+		0x00, 0x00, 0x00, 0x02,
+		0x10, 0x01,
+		0x00, 0x00
+	};
+	EXPECT_THROW(AmfPacketIndex(marker.data(), marker.size()), std::invalid_argument);
+
+	v8 empty {
+		0x00, 0x03,
+		0x00, 0x01,
+		0x00, 0x01, 0x68, 0x00,
+		0x00, 0x00, 0x00, 0x00,
+		0x11, 0x01,
+		0x00, 0x00
+	};
+	EXPECT_THROW(AmfPacketIndex(empty.data(), empty.size()), std::out_of_range);
+
+	v8 malformed {
+		0x00, 0x03,
+		0x00, 0x00,
+		0x00, 0x01,
+		0x00, 0x00, 0x00, 0x00,
+		0xff, 0xff, 0xff, 0xff,
+		0x11, 0x06, 0x00
+	};
+	EXPECT_THROW(AmfPacketIndex(malformed.data(), malformed.size()), std::invalid_argument);
+}
@@ -0,0 +1,125 @@
+#include "amftest.hpp"
+
+#include "amfpacket.hpp"
+#include "amfpacketwriter.hpp"
+#include "types/amfarray.hpp"
+#include "types/amfinteger.hpp"
+#include "types/amfobject.hpp"
+#include "types/amfstring.hpp"
+
+TEST(AmfPacketWriterTest, MatchesSerialize) {
+	AmfObject result("", true, false);
+	result.addDynamicProperty("name", AmfString("foo"));
+
+	AmfPacket packet;
+	packet.headers.emplace_back("DSId", true, AmfString("foo"));
+	packet.headers.emplace_back("empty", false, AmfArray());
+	packet.messages.emplace_back("/1/onResult", "", result);
+	packet.messages.emplace_back("/2/onResult", "", AmfArray(std::vector<AmfInteger> { 1, 2 }));
+
+	SerializationContext ctx;
+	v8 expected = packet.serialize(ctx);
+
+	AmfPacketWriter writer;
+	writer.beginPacket();
+	EXPECT_FALSE(writer.complete());
+
+	writer.beginHeader("DSId", true);
+	writer.writeString("foo");
+	writer.endHeader();
+	writer.writeHeader("empty", false, AmfArray());
+
+	// the string is written again, as every value has its own tables
+	writer.beginMessage("/1/onResult", "");
+	writer.beginObject("", { }, true);
+	writer.writeKey("name");
+	writer.writeString("foo");
+	writer.endObject();
+	writer.endMessage();
+
+	writer.beginMessage("/2/onResult", "");
+	writer.beginArray(2);
+	writer.writeInt(1);
+	writer.writeInt(2);
+	writer.endArray();
+	writer.endMessage();
+
+	writer.endPacket();
+	EXPECT_TRUE(writer.complete());
+	EXPECT_EQ(expected, writer.data());
+}
+
+TEST(AmfPacketWriterTest, Empty) {
+	AmfPacketWriter writer;
+	writer.beginPacket();
+	writer.endPacket();
+
+	isEqual({ 0x00, 0x03, 0x00, 0x00, 0x00, 0x00 }, writer.data());
+
+	// packets are appended
+	writer.beginPacket();
+	writer.writeMessage("t", "r", AmfInteger(1));
+	writer.endPacket();
+
+	isEqual({
+		0x00, 0x03, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x03, // version: AMF 3
+		0x00, 0x00, // header count: 0
+		0x00, 0x01, // message count: 1
+		0x00, 0x01, 0x74, // target-uri: "t"
+		0x00, 0x01, 0x72, // response-uri: "r"
+		0x00, 0x00, 0x00, 0x03, // value length: 3
+		0x11, 0x04, 0x01 // AMF3 object marker, AmfInteger 1
+	}, writer.data());
+
+	writer.clear();
+	EXPECT_TRUE(writer.data().empty());
+	writer.beginPacket();
+	EXPECT_FALSE(writer.complete());
+	writer.clear();
+	EXPECT_TRUE(writer.complete());
+}
+
+TEST(AmfPacketWriterTest, Invalid) {
+	AmfPacketWriter writer;
+	EXPECT_THROW(writer.beginHeader("h", false), std::invalid_argument);
+	EXPECT_THROW(writer.beginMessage("t", "r"), std::invalid_argument);
+	EXPECT_THROW(writer.endPacket(), std::invalid_argument);
+	EXPECT_THROW(writer.writeInt(1), std::invalid_argument);
+
+	writer.beginPacket();
+	EXPECT_THROW(writer.beginPacket(), std::invalid_argument);
+	EXPECT_THROW(writer.writeInt(1), std::invalid_argument);
+	EXPECT_THROW(writer.endHeader(), std::invalid_argument);
+
+	// exactly one value
+	writer.beginHeader("h", false);
+	EXPECT_THROW(writer.endHeader(), std::invalid_argument);
+	EXPECT_THROW(writer.endMessage(), std::invalid_argument);
+	EXPECT_THROW(writer.endPacket(), std::invalid_argument);
+	writer.beginArray(1);
+	EXPECT_THROW(writer.endHeader(), std::invalid_argument);
+	writer.writeInt(1);
+	writer.endArray();
+	EXPECT_THROW(writer.writeInt(2), std::invalid_argument);
+	writer.endHeader();
+
+	writer.writeMessage("t", "r", AmfInteger(1));
+	EXPECT_THROW(writer.beginHeader("h", false), std::invalid_argument);
+	EXPECT_THROW(writer.beginMessage(std::string(65536, 't'), "r"), std::length_error);
+}
+
+TEST(AmfPacketWriterTest, TooManyMessages) {
+	AmfPacketWriter writer;
+	writer.beginPacket();
+	for (int i = 0; i < 65535; ++i)
+		writer.writeMessage("", "", AmfInteger(i));
+
+	EXPECT_THROW(writer.beginMessage("", ""), std::length_error);
+	writer.endPacket();
+
+	const v8& data = writer.data();
+	const u8* it = data.data();
+	DeserializationContext ctx;
+	EXPECT_EQ(65535u, AmfPacket::deserialize(it, it + data.size(), ctx).messages.size());
+}
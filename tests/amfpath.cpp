@@ -0,0 +1,222 @@
+#include "amftest.hpp"
+
+#include "amfpacket.hpp"
+#include "amfpath.hpp"
+#include "deserializer.hpp"
+#include "lazydeserializer.hpp"
+#include "serializationcontext.hpp"
+#include "serializer.hpp"
+#include "types/amfarray.hpp"
+#include "types/amfbool.hpp"
+#include "types/amfdictionary.hpp"
+#include "types/amfinteger.hpp"
+#include "types/amfobject.hpp"
+#include "types/amfstring.hpp"
+#include "types/amfvector.hpp"
+
+static void expectStep(const AmfPath::Step& step, const std::string& key) {
+	EXPECT_FALSE(step.byIndex);
+	EXPECT_EQ(key, step.key);
+}
+
+static void expectStep(const AmfPath::Step& step, size_t index) {
+	EXPECT_TRUE(step.byIndex);
+	EXPECT_EQ(index, step.index);
+}
+
+TEST(AmfPathTest, Parse) {
+	AmfPath path("body[0].user.id");
+	ASSERT_EQ(4u, path.steps().size());
+	expectStep(path.steps()[0], "body");
+	expectStep(path.steps()[1], 0);
+	expectStep(path.steps()[2], "user");
+	expectStep(path.steps()[3], "id");
+
+	AmfPath keys("[\"DS\\\"Id\"]['a.b'][12]._$x");
+	ASSERT_EQ(4u, keys.steps().size());
+	expectStep(keys.steps()[0], "DS\"Id");
+	expectStep(keys.steps()[1], "a.b");
+	expectStep(keys.steps()[2], 12);
+	expectStep(keys.steps()[3], "_$x");
+
+	expectStep(AmfPath("[\"\"]").steps()[0], "");
+}
+
+TEST(AmfPathTest, Invalid) {
+	EXPECT_THROW(AmfPath(""), std::invalid_argument);
+	EXPECT_THROW(AmfPath(".a"), std::invalid_argument);
+	EXPECT_THROW(AmfPath("a."), std::invalid_argument);
+	EXPECT_THROW(AmfPath("a..b"), std::invalid_argument);
+	EXPECT_THROW(AmfPath("a b"), std::invalid_argument);
+	EXPECT_THROW(AmfPath("a[]"), std::invalid_argument);
+	EXPECT_THROW(AmfPath("a[1"), std::invalid_argument);
+	EXPECT_THROW(AmfPath("a[-1]"), std::invalid_argument);
+	EXPECT_THROW(AmfPath("a[b]"), std::invalid_argument);
+	EXPECT_THROW(AmfPath("a[\"b]"), std::invalid_argument);
+	EXPECT_THROW(AmfPath("a[\"b\""), std::invalid_argument);
+	EXPECT_THROW(AmfPath("a]"), std::invalid_argument);
+	EXPECT_THROW(AmfPath("a[99999999999999999999999]"), std::invalid_argument);
+}
+
+static AmfObject makeMessage() {
+	AmfObject user("User", true, false);
+	user.addSealedProperty("id", AmfInteger(7));
+	user.addSealedProperty("name", AmfString("bob"));
+
+	AmfArray body;
+	body.dense.push_back(AmfItemPtr(AmfObject("", true, false)));
+	body.dense[0].as<AmfObject>().addDynamicProperty("user", user);
+	body.dense.push_back(body.dense[0]);
+	body.insert("name", AmfString("args"));
+
+	AmfObject headers("", true, false);
+	headers.addDynamicProperty("DSId", AmfString("1234-abcd"));
+	headers.addDynamicProperty("DSEndpoint", AmfString("amf"));
+
+	AmfDictionary dict(false, false);
+	dict.insert(AmfString("key"), AmfString("by string"));
+	dict.insert(AmfInteger(3), AmfString("by integer"));
+
+	AmfObject message("flex.messaging.messages.RemotingMessage", false, false);
+	message.addSealedProperty("body", body);
+	message.addSealedProperty("dict", dict);
+	message.addSealedProperty("headers", headers);
+	message.addSealedProperty("vector", AmfVector<AmfString>({ "a", "b" }, "String"));
+	return message;
+}
+
+static v8 serializeMessage() {
+	SerializationContext ctx;
+	return makeMessage().serialize(ctx);
+}
+
+TEST(AmfPathTest, Find) {
+	v8 data = serializeMessage();
+	LazyDeserializer d(data);
+	AmfLazyValue message = d.next();
+
+	EXPECT_EQ("1234-abcd", message.find(AmfPath("headers[\"DSId\"]")).asString());
+	EXPECT_EQ("amf", message.find(AmfPath("headers.DSEndpoint")).asString());
+	EXPECT_EQ(7, message.find(AmfPath("body[0].user.id")).asInt());
+	EXPECT_EQ("bob", message.find(AmfPath("body[1].user.name")).asString());
+	EXPECT_EQ("args", message.find(AmfPath("body.name")).asString());
+	EXPECT_EQ("b", message.find(AmfPath("vector[1]")).asString());
+	EXPECT_EQ("by string", message.find(AmfPath("dict.key")).asString());
+	EXPECT_EQ("by integer", message.find(AmfPath("dict[3]")).asString());
+
+	AmfLazyValue user = message.find(AmfPath("body[0].user"));
+	EXPECT_EQ("User", user.objectTraits().className);
+	EXPECT_EQ(7, user.find(AmfPath("id")).asInt());
+	EXPECT_EQ(*Deserializer().deserialize(data), *message.materialize());
+}
+
+TEST(AmfPathTest, NoMatch) {
+	v8 data = serializeMessage();
+	LazyDeserializer d(data);
+	AmfLazyValue message = d.next();
+
+	EXPECT_THROW(message.find(AmfPath("missing")), std::out_of_range);
+	EXPECT_THROW(message.find(AmfPath("[0]")), std::out_of_range);
+	EXPECT_THROW(message.find(AmfPath("body[2]")), std::out_of_range);
+	EXPECT_THROW(message.find(AmfPath("body[0].user.id.value")), std::out_of_range);
+	EXPECT_THROW(message.find(AmfPath("body[0].user[0]")), std::out_of_range);
+	EXPECT_THROW(message.find(AmfPath("vector.length")), std::out_of_range);
+	EXPECT_THROW(message.find(AmfPath("dict[4]")), std::out_of_range);
+	EXPECT_THROW(message.find(AmfPath("dict[\"3\"]")), std::out_of_range);
+
+	// Type mismatches in the path only mean that it doesn't match.
+	EXPECT_EQ("1234-abcd", message.find(AmfPath("headers.DSId")).asString());
+}
+
+TEST(AmfPathTest, OnlyReadsSelectedValues) {
+	v8 data = serializeMessage();
+
+	LazyDeserializer d(data);
+	EXPECT_EQ("args", d.next().find(AmfPath("body.name")).asString());
+	// class name, sealed names, "name" and "args"
+	EXPECT_EQ(7u, d.context().stringsCount());
+	EXPECT_EQ(1u, d.context().traitsCount());
+
+	EXPECT_TRUE(d.finished());
+	EXPECT_LT(6u, d.context().stringsCount());
+}
+
+TEST(AmfPathTest, Indexed) {
+	// Paths through containers that were indexed by the accessors give the
+	// same results.
+	v8 data = serializeMessage();
+	LazyDeserializer d(data);
+	AmfLazyValue message = d.next();
+
+	EXPECT_EQ(2u, message.getSealedProperty("body").size());
+	EXPECT_EQ(2u, message.getSealedProperty("dict").size());
+	EXPECT_EQ(2u, message.getSealedProperty("vector").size());
+	message.getSealedProperty("headers").getDynamicProperty("DSId");
+	message.find(AmfPath("body[0]")).getDynamicProperty("user");
+
+	EXPECT_EQ("1234-abcd", message.find(AmfPath("headers[\"DSId\"]")).asString());
+	EXPECT_EQ(7, message.find(AmfPath("body[1].user.id")).asInt());
+	EXPECT_EQ("args", message.find(AmfPath("body.name")).asString());
+	EXPECT_EQ("b", message.find(AmfPath("vector[1]")).asString());
+	EXPECT_EQ("by string", message.find(AmfPath("dict.key")).asString());
+	EXPECT_EQ("by integer", message.find(AmfPath("dict[3]")).asString());
+	EXPECT_THROW(message.find(AmfPath("body[2]")), std::out_of_range);
+	EXPECT_THROW(message.find(AmfPath("headers[0]")), std::out_of_range);
+}
+
+TEST(AmfPathTest, Packet) {
+	AmfPacket packet;
+	packet.headers.emplace_back("Credentials", true, AmfString("secret"));
+	packet.headers.emplace_back("DSId", false, AmfString("1234-abcd"));
+	packet.messages.emplace_back("null", "/1", AmfArray(std::vector<AmfObject> { makeMessage() }));
+	packet.messages.emplace_back("foo.bar", "/2", AmfString("secret"));
+
+	SerializationContext ctx;
+	v8 data = packet.serialize(ctx);
+
+	LazyPacket lazy(data);
+	EXPECT_EQ(2u, lazy.headerCount());
+	EXPECT_EQ("DSId", lazy.headerName(1));
+	EXPECT_TRUE(lazy.headerMustUnderstand(0));
+	EXPECT_FALSE(lazy.headerMustUnderstand(1));
+	EXPECT_EQ("1234-abcd", lazy.header("DSId").asString());
+	EXPECT_EQ("secret", lazy.header(0).asString());
+	EXPECT_THROW(lazy.header("missing"), std::out_of_range);
+	EXPECT_THROW(lazy.header(2), std::out_of_range);
+
+	EXPECT_EQ(2u, lazy.messageCount());
+	EXPECT_EQ("foo.bar", lazy.messageTarget(1));
+	EXPECT_EQ("/2", lazy.messageResponse(1));
+	// the message repeats the string of the first header with its own tables
+	EXPECT_EQ("secret", lazy.message(1).asString());
+	EXPECT_THROW(lazy.message(2), std::out_of_range);
+
+	EXPECT_EQ("1234-abcd", lazy.find(AmfPath("headers[\"DSId\"]")).asString());
+	EXPECT_EQ("secret", lazy.find(AmfPath("headers[0]")).asString());
+	EXPECT_EQ(7, lazy.find(AmfPath("messages[0][0].body[0].user.id")).asInt());
+	EXPECT_THROW(lazy.find(AmfPath("messages[2]")), std::out_of_range);
+	EXPECT_THROW(lazy.find(AmfPath("messages[\"x\"]")), std::out_of_range);
+	EXPECT_THROW(lazy.find(AmfPath("body")), std::out_of_range);
+	EXPECT_THROW(lazy.find(AmfPath("[0]")), std::out_of_range);
+}
+
+TEST(AmfPathTest, PacketInvalid) {
+	v8 truncated { 0x00 };
+	EXPECT_THROW(LazyPacket(truncated.data(), truncated.size()), std::out_of_range);
+	v8 version { 0x00, 0x00, 0x00, 0x00 };
+	EXPECT_THROW(LazyPacket(version.data(), version.size()), std::invalid_argument);
+
+	// missing message count
+	v8 empty { 0x00, 0x03, 0x00, 0x00 };
+	LazyPacket packet(empty);
+	EXPECT_EQ(0u, packet.headerCount());
+	EXPECT_THROW(packet.messageCount(), std::out_of_range);
+
+	// missing AVM+ marker
+	v8 marker {
+		0x00, 0x03, 0x00, 0x00, 0x00, 0x01,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x01
+	};
+	LazyPacket message(marker);
+	EXPECT_THROW(message.message(0), std::invalid_argument);
+}
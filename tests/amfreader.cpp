@@ -0,0 +1,253 @@
+#include "amftest.hpp"
+
+#include <sstream>
+
+#include "amfreader.hpp"
+#include "deserializer.hpp"
+#include "serializer.hpp"
+#include "types/amfarray.hpp"
+#include "types/amfbool.hpp"
+#include "types/amfbytearray.hpp"
+#include "types/amfdate.hpp"
+#include "types/amfdictionary.hpp"
+#include "types/amfdouble.hpp"
+#include "types/amfinteger.hpp"
+#include "types/amfnull.hpp"
+#include "types/amfobject.hpp"
+#include "types/amfstring.hpp"
+#include "types/amfundefined.hpp"
+#include "types/amfvector.hpp"
+#include "types/amfxml.hpp"
+#include "types/amfxmldocument.hpp"
+
+// Records all events as a single line of text.
+class RecordingHandler : public AmfHandler {
+public:
+	void undefinedValue() { out << "undefined "; }
+	void nullValue() { out << "null "; }
+	void boolValue(bool value) { out << (value ? "true " : "false "); }
+	void integerValue(int value) { out << "int:" << value << " "; }
+	void doubleValue(double value) { out << "double:" << value << " "; }
+	void stringValue(AmfStringView value) { out << "'" << value.str() << "' "; }
+	void xmlValue(AmfStringView value, bool document) {
+		out << (document ? "xmldoc:" : "xml:") << value.str() << " ";
+	}
+	void dateValue(long long value) { out << "date:" << value << " "; }
+	void byteArrayValue(const u8* data, size_t size) {
+		out << "bytes:";
+		for (size_t i = 0; i < size; ++i)
+			out << int(data[i]);
+		out << " ";
+	}
+	void objectReference(size_t index) { out << "ref:" << index << " "; }
+	void beginArray(size_t dense) { out << "[" << dense << " "; }
+	void associativeKey(AmfStringView key) { out << key.str() << "= "; }
+	void endArray() { out << "] "; }
+	void beginObject(const AmfObjectTraits& traits) {
+		out << "{" << traits.className << (traits.dynamic ? " dynamic " : " ");
+	}
+	void propertyName(AmfStringView name) { out << name.str() << ": "; }
+	void endObject() { out << "} "; }
+	void intVector(const AmfVectorRun<int>& run, bool fixed) { vector(run, fixed); }
+	void uintVector(const AmfVectorRun<unsigned int>& run, bool fixed) { vector(run, fixed); }
+	void doubleVector(const AmfVectorRun<double>& run, bool fixed) { vector(run, fixed); }
+	void beginObjectVector(AmfStringView type, size_t count, bool fixed) {
+		out << "<" << type.str() << " " << count << (fixed ? " fixed " : " ");
+	}
+	void endObjectVector() { out << "> "; }
+	void beginDictionary(size_t count, bool weak) {
+		out << "dict(" << count << (weak ? " weak " : " ");
+	}
+	void endDictionary() { out << ") "; }
+
+	template<typename T>
+	void vector(const AmfVectorRun<T>& run, bool fixed) {
+		out << "<";
+		for (size_t i = 0; i < run.size(); ++i)
+			out << run[i] << " ";
+		out << (fixed ? "fixed> " : "> ");
+	}
+
+	std::string events() const {
+		std::string ret = out.str();
+		if (!ret.empty()) ret.pop_back();
+		return ret;
+	}
+
+	std::ostringstream out;
+};
+
+static std::string readAll(const v8& data, AmfReader& reader) {
+	RecordingHandler handler;
+	const u8* it = data.data();
+	const u8* end = it + data.size();
+	while (it != end)
+		reader.read(it, end, handler);
+
+	return handler.events();
+}
+
+static std::string readAll(const v8& data) {
+	AmfReader reader;
+	return readAll(data, reader);
+}
+
+static std::string readAll(const AmfItem& item) {
+	SerializationContext ctx;
+	return readAll(item.serialize(ctx));
+}
+
+TEST(AmfReaderTest, Scalars) {
+	Serializer s;
+	s << AmfUndefined() << AmfNull() << AmfBool(true) << AmfBool(false)
+	  << AmfInteger(-17) << AmfDouble(0.5) << AmfString("foo")
+	  << AmfXml("<a/>") << AmfXmlDocument("<b/>") << AmfDate(1234ll)
+	  << AmfByteArray(v8 { 1, 2, 3 });
+
+	EXPECT_EQ("undefined null true false int:-17 double:0.5 'foo' "
+		"xml:<a/> xmldoc:<b/> date:1234 bytes:123", readAll(s.data()));
+}
+
+TEST(AmfReaderTest, Array) {
+	AmfArray array(std::vector<AmfInteger> { 1, 2 });
+	array.insert("name", AmfString("foo"));
+	array.insert("inner", AmfArray(std::vector<AmfNull> { AmfNull() }));
+
+	EXPECT_EQ("[2 name= 'foo' inner= [1 null ] int:1 int:2 ]", readAll(array));
+}
+
+TEST(AmfReaderTest, Object) {
+	AmfObject point("Point", true, false);
+	point.addSealedProperty("x", AmfInteger(1));
+	point.addSealedProperty("y", AmfDouble(2.5));
+	point.addDynamicProperty("label", AmfString("origin"));
+
+	EXPECT_EQ("{Point dynamic x: int:1 y: double:2.5 label: 'origin' }", readAll(point));
+
+	AmfObject sealed("Point", false, false);
+	sealed.addSealedProperty("x", AmfInteger(3));
+	EXPECT_EQ("{Point x: int:3 }", readAll(sealed));
+}
+
+TEST(AmfReaderTest, Vectors) {
+	EXPECT_EQ("<1 -2 3 fixed>", readAll(AmfVector<int>({ 1, -2, 3 }, true)));
+	EXPECT_EQ("<4294967295 >", readAll(AmfVector<unsigned int>({ 0xffffffffu })));
+	EXPECT_EQ("<0.5 -1.5 >", readAll(AmfVector<double>({ 0.5, -1.5 })));
+	EXPECT_EQ("<String 2 'a' 'b' >",
+		readAll(AmfVector<AmfString>({ "a", "b" }, "String")));
+	EXPECT_EQ("<>", readAll(AmfVector<int>(std::vector<int>())));
+}
+
+TEST(AmfReaderTest, Dictionary) {
+	AmfDictionary dict(false, true);
+	dict.insert(AmfInteger(3), AmfNull());
+
+	EXPECT_EQ("dict(1 weak int:3 null )", readAll(dict));
+}
+
+TEST(AmfReaderTest, References) {
+	// Strings and traits are resolved, objects are reported as references
+	// in the order they were read.
+	AmfObject obj("Point", false, false);
+	obj.addSealedProperty("x", AmfString("foo"));
+
+	AmfByteArray bytes(v8 { 7 });
+	AmfArray array(std::vector<AmfObject> { obj, obj });
+	array.push_back(bytes);
+	array.push_back(bytes);
+	array.push_back(AmfString("foo"));
+	array.push_back(AmfObject(obj));
+
+	SerializationContext ctx(REFERENCE_BY_VALUE);
+	EXPECT_EQ("[6 {Point x: 'foo' } ref:1 bytes:7 ref:2 'foo' ref:1 ]",
+		readAll(array.serialize(ctx)));
+}
+
+TEST(AmfReaderTest, ContextSpansValues) {
+	Serializer s;
+	s << AmfString("foo");
+	v8 data = s.data();
+	// String reference to "foo" and an object reference to the first array.
+	data.insert(data.end(), { 0x06, 0x00, 0x09, 0x01, 0x01, 0x09, 0x00 });
+
+	AmfReader reader;
+	EXPECT_EQ("'foo' 'foo' [0 ] ref:0", readAll(data, reader));
+	EXPECT_EQ(1u, reader.objectCount());
+	EXPECT_EQ("foo", reader.context().getString(0));
+
+	reader.clearContext();
+	EXPECT_EQ(0u, reader.objectCount());
+	EXPECT_THROW(readAll(v8 { 0x09, 0x00 }, reader), std::out_of_range);
+}
+
+TEST(AmfReaderTest, MatchesDeserializer) {
+	// Nested objects adding traits while the traits of their parent are used.
+	AmfObject inner("Inner", false, false);
+	inner.addSealedProperty("a", AmfInteger(1));
+	inner.addSealedProperty("b", AmfInteger(2));
+
+	AmfObject outer("Outer", false, false);
+	outer.addSealedProperty("first", inner);
+	outer.addSealedProperty("second", AmfObject(inner));
+
+	SerializationContext ctx;
+	v8 data = outer.serialize(ctx);
+
+	EXPECT_EQ("{Outer first: {Inner a: int:1 b: int:2 } "
+		"second: {Inner a: int:1 b: int:2 } }", readAll(data));
+	EXPECT_EQ(outer, Deserializer().deserialize(data).as<AmfObject>());
+}
+
+TEST(AmfReaderTest, Externalizable) {
+	Deserializer::externalDeserializers["ext"] = [] (const u8*& it,
+		const u8* end, DeserializationContext& ctx) -> AmfObject {
+		AmfObject obj("ext", true, false);
+		obj.addDynamicProperty("name", AmfString::deserialize(it, end, ctx));
+		return obj;
+	};
+
+	// The default handler skips externalizable objects.
+	v8 data {
+		0x09, 0x05, 0x01,
+		0x0a, 0x07, 0x07, 0x65, 0x78, 0x74,
+		0x06, 0x07, 0x66, 0x6f, 0x6f,
+		0x04, 0x01
+	};
+	EXPECT_EQ("[2 int:1 ]", readAll(data));
+
+	Deserializer::externalDeserializers.erase("ext");
+	EXPECT_THROW(readAll(data), std::out_of_range);
+}
+
+TEST(AmfReaderTest, ExternalizableReferences) {
+	// The external deserializer adds a byte array to the object table, which
+	// shifts the indices of the values after it.
+	Deserializer::externalDeserializers["ext"] = [] (const u8*& it,
+		const u8* end, DeserializationContext& ctx) -> AmfObject {
+		Deserializer::deserialize(it, end, ctx);
+		return AmfObject("ext", true, false);
+	};
+
+	v8 data {
+		0x09, 0x07, 0x01,
+		0x0a, 0x07, 0x07, 0x65, 0x78, 0x74,
+		0x0c, 0x03, 0x07,
+		0x0c, 0x03, 0x08,
+		0x0c, 0x06
+	};
+
+	AmfReader reader;
+	EXPECT_EQ("[3 bytes:8 ref:3 ]", readAll(data, reader));
+	EXPECT_EQ(4u, reader.objectCount());
+
+	Deserializer::externalDeserializers.erase("ext");
+}
+
+TEST(AmfReaderTest, Invalid) {
+	EXPECT_THROW(readAll(v8 { 0x12 }), std::invalid_argument);
+	EXPECT_THROW(readAll(v8 { 0x05, 0x00 }), std::out_of_range);
+	EXPECT_THROW(readAll(v8 { 0x09, 0x05, 0x01, 0x04 }), std::out_of_range);
+	EXPECT_THROW(readAll(v8 { 0x0d, 0x05, 0x00, 0x00 }), std::out_of_range);
+	EXPECT_THROW(readAll(v8 { 0x0a, 0x05 }), std::out_of_range);
+	EXPECT_THROW(readAll(v8 { 0x09, 0xff, 0xff, 0xff, 0xff }), std::invalid_argument);
+}
@@ -0,0 +1,259 @@
+#include "amftest.hpp"
+
+#include <algorithm>
+
+#include "amfscanner.hpp"
+#include "deserializer.hpp"
+#include "serializer.hpp"
+#include "types/amfarray.hpp"
+#include "types/amfbool.hpp"
+#include "types/amfbytearray.hpp"
+#include "types/amfdate.hpp"
+#include "types/amfdictionary.hpp"
+#include "types/amfdouble.hpp"
+#include "types/amfinteger.hpp"
+#include "types/amfnull.hpp"
+#include "types/amfobject.hpp"
+#include "types/amfstring.hpp"
+#include "types/amfvector.hpp"
+#include "types/amfxml.hpp"
+#include "types/amfxmldocument.hpp"
+
+static v8 serializeValues() {
+	AmfObject point("Point", true, false);
+	point.addSealedProperty("x", AmfInteger(1));
+	point.addSealedProperty("y", AmfDouble(2.5));
+	point.addDynamicProperty("label", AmfString("origin"));
+
+	AmfArray array(std::vector<AmfObject> { point, point });
+	array.insert("name", AmfString("points"));
+	array.insert("empty", AmfArray());
+	array.dense.push_back(array.dense[0]);
+
+	AmfDictionary dict(false, true);
+	dict.insert(AmfString("key"), AmfBool(true));
+	dict.insert(AmfInteger(3), AmfNull());
+
+	AmfDate date(1234ll);
+	AmfArray dates(std::vector<AmfDate> { date, date });
+
+	Serializer s;
+	s << AmfInteger(17)
+	  << AmfString("foo")
+	  << AmfString("foo")
+	  << point
+	  << array
+	  << AmfVector<int>({ 1, 2, 3 }, true)
+	  << AmfVector<unsigned int>({ 4 })
+	  << AmfVector<double>({ 0.5 })
+	  << AmfVector<AmfString>({ "a", "b" }, "String")
+	  << dict
+	  << dates
+	  << AmfByteArray(v8 { 1, 2, 3, 4 })
+	  << AmfXml("<a/>")
+	  << AmfXmlDocument("<b/>")
+	  << AmfString(std::string(300, 'x'))
+	  << point;
+
+	return s.data();
+}
+
+TEST(AmfScannerTest, MatchesDeserializer) {
+	v8 data = serializeValues();
+	const u8* end = data.data() + data.size();
+
+	DeserializationContext ctx;
+	AmfScanner scanner;
+	const u8* expected = data.data();
+	const u8* it = data.data();
+	while (expected != end) {
+		Deserializer::deserialize(expected, end, ctx);
+
+		ASSERT_EQ(AmfScanner::VALID, scanner.scan(it, end));
+		EXPECT_EQ(expected, it);
+		EXPECT_EQ(ctx.stringsCount(), scanner.stringsCount());
+		EXPECT_EQ(ctx.traitsCount(), scanner.traitsCount());
+		EXPECT_EQ(ctx.objectsCount(), scanner.objectsCount());
+	}
+
+	EXPECT_EQ(AmfScanner::TRUNCATED, scanner.scan(it, end));
+
+	scanner.clear();
+	EXPECT_EQ(0u, scanner.stringsCount());
+	EXPECT_EQ(0u, scanner.traitsCount());
+	EXPECT_EQ(0u, scanner.objectsCount());
+}
+
+TEST(AmfScannerTest, Truncated) {
+	v8 data = serializeValues();
+
+	// Every proper prefix of the input ends within a value.
+	AmfScanner full;
+	const u8* it = data.data();
+	const u8* end = it + data.size();
+	std::vector<const u8*> ends;
+	while (it != end) {
+		ASSERT_EQ(AmfScanner::VALID, full.scan(it, end));
+		ends.push_back(it);
+	}
+
+	for (size_t size = 0; size < data.size(); ++size) {
+		SCOPED_TRACE(size);
+		AmfScanner scanner;
+		const u8* pos = data.data();
+		const u8* prefixEnd = pos + size;
+		while (scanner.scan(pos, prefixEnd) == AmfScanner::VALID) { }
+
+		EXPECT_TRUE(pos == data.data() || std::find(ends.begin(), ends.end(), pos) != ends.end());
+		size_t strings = scanner.stringsCount();
+		size_t traits = scanner.traitsCount();
+		size_t objects = scanner.objectsCount();
+
+		// nothing is consumed or added by a failed scan
+		const u8* failed = pos;
+		EXPECT_EQ(AmfScanner::TRUNCATED, scanner.scan(failed, prefixEnd));
+		EXPECT_EQ(pos, failed);
+		EXPECT_EQ(strings, scanner.stringsCount());
+		EXPECT_EQ(traits, scanner.traitsCount());
+		EXPECT_EQ(objects, scanner.objectsCount());
+	}
+}
+
+static AmfScanner::Status scan(const v8& data) {
+	AmfScanner scanner;
+	const u8* it = data.data();
+	return scanner.scan(it, it + data.size());
+}
+
+TEST(AmfScannerTest, Malformed) {
+	// invalid type marker
+	EXPECT_EQ(AmfScanner::MALFORMED, scan(v8 { 0x12 }));
+	EXPECT_EQ(AmfScanner::MALFORMED, scan(v8 { 0x09, 0x03, 0x01, 0xff }));
+
+	// unknown string, traits and object references
+	EXPECT_EQ(AmfScanner::MALFORMED, scan(v8 { 0x06, 0x00 }));
+	EXPECT_EQ(AmfScanner::MALFORMED, scan(v8 { 0x0a, 0x01 }));
+	EXPECT_EQ(AmfScanner::MALFORMED, scan(v8 { 0x0a, 0x02 }));
+	EXPECT_EQ(AmfScanner::MALFORMED, scan(v8 { 0x09, 0x03, 0x01, 0x09, 0x02 }));
+
+	// references to objects of a different type
+	EXPECT_EQ(AmfScanner::MALFORMED, scan(v8 { 0x09, 0x03, 0x01, 0x08, 0x00 }));
+	EXPECT_EQ(AmfScanner::MALFORMED, scan(v8 { 0x09, 0x03, 0x01, 0x0a, 0x00 }));
+	EXPECT_EQ(AmfScanner::VALID, scan(v8 { 0x09, 0x03, 0x01, 0x09, 0x00 }));
+
+	// negative length
+	EXPECT_EQ(AmfScanner::MALFORMED, scan(v8 { 0x06, 0xc0, 0x80, 0x80, 0x01 }));
+
+	// A string reference is valid once the string has been read.
+	EXPECT_EQ(AmfScanner::VALID, scan(v8 { 0x09, 0x05, 0x01, 0x06, 0x03, 0x61, 0x06, 0x00 }));
+	EXPECT_EQ(AmfScanner::MALFORMED, scan(v8 { 0x09, 0x05, 0x01, 0x06, 0x01, 0x06, 0x00 }));
+}
+
+TEST(AmfScannerTest, Unsupported) {
+	// externalizable object
+	EXPECT_EQ(AmfScanner::UNSUPPORTED, scan(v8 { 0x0a, 0x07, 0x07, 0x65, 0x78, 0x74 }));
+
+	// nesting
+	v8 nested;
+	for (int i = 0; i < 3; ++i) {
+		nested.push_back(AMF_ARRAY);
+		nested.push_back(0x03);
+		nested.push_back(0x01);
+	}
+	nested.push_back(AMF_NULL);
+
+	AmfScanner shallow(2);
+	const u8* it = nested.data();
+	EXPECT_EQ(AmfScanner::UNSUPPORTED, shallow.scan(it, it + nested.size()));
+	EXPECT_EQ(0u, shallow.objectsCount());
+
+	AmfScanner deep(3);
+	EXPECT_EQ(AmfScanner::VALID, deep.scan(it, it + nested.size()));
+	EXPECT_EQ(nested.data() + nested.size(), it);
+	EXPECT_EQ(3u, deep.objectsCount());
+}
+
+TEST(AmfScannerTest, Resume) {
+	v8 data = serializeValues();
+	const u8* end = data.data() + data.size();
+
+	AmfScanner full;
+	std::vector<size_t> sizes;
+	for (const u8* it = data.data(); it != end; ) {
+		const u8* start = it;
+		ASSERT_EQ(AmfScanner::VALID, full.scan(it, end));
+		sizes.push_back(it - start);
+	}
+
+	// Feeding one byte more on every call finds the same values.
+	AmfScanner scanner;
+	size_t offset = 0;
+	for (size_t size : sizes) {
+		size_t available = 0;
+		AmfScanner::Status status;
+		while ((status = scanner.resume(data.data() + offset, available)) == AmfScanner::TRUNCATED)
+			++available;
+
+		ASSERT_EQ(AmfScanner::VALID, status);
+		EXPECT_EQ(size, scanner.size());
+		EXPECT_EQ(size, available);
+		EXPECT_EQ(AmfScanner::VALID, scanner.resume(data.data() + offset, available));
+
+		offset += size;
+		scanner.next();
+	}
+
+	EXPECT_EQ(full.stringsCount(), scanner.stringsCount());
+	EXPECT_EQ(full.traitsCount(), scanner.traitsCount());
+	EXPECT_EQ(full.objectsCount(), scanner.objectsCount());
+}
+
+TEST(AmfScannerTest, ResumeMalformed) {
+	// array with a string, followed by an unknown string reference
+	v8 data { 0x09, 0x05, 0x01, 0x06, 0x03, 0x61, 0x06, 0x02 };
+
+	AmfScanner scanner;
+	EXPECT_EQ(AmfScanner::TRUNCATED, scanner.resume(data.data(), 7));
+	EXPECT_EQ(1u, scanner.stringsCount());
+	EXPECT_EQ(1u, scanner.objectsCount());
+
+	// The tables are left as they were before the value.
+	EXPECT_EQ(AmfScanner::MALFORMED, scanner.resume(data.data(), data.size()));
+	EXPECT_EQ(AmfScanner::MALFORMED, scanner.resume(data.data(), data.size()));
+	EXPECT_EQ(0u, scanner.stringsCount());
+	EXPECT_EQ(0u, scanner.objectsCount());
+
+	scanner.next();
+	data.back() = 0x00;
+	EXPECT_EQ(AmfScanner::VALID, scanner.resume(data.data(), data.size()));
+	EXPECT_EQ(data.size(), scanner.size());
+}
+
+TEST(AmfScannerTest, Sync) {
+	AmfObject point("Point", false, false);
+	point.addSealedProperty("x", AmfInteger(1));
+
+	Serializer s;
+	s << point;
+	size_t first = s.data().size();
+	s << point;
+	const v8& data = s.data();
+
+	// The second object refers to the string, traits and object of the first.
+	DeserializationContext ctx;
+	const u8* it = data.data();
+	Deserializer::deserialize(it, data.data() + first, ctx);
+
+	AmfScanner scanner;
+	EXPECT_EQ(AmfScanner::MALFORMED, scanner.scan(it, data.data() + data.size()));
+
+	scanner.sync(ctx);
+	EXPECT_EQ(ctx.stringsCount(), scanner.stringsCount());
+	EXPECT_EQ(ctx.traitsCount(), scanner.traitsCount());
+	EXPECT_EQ(ctx.objectsCount(), scanner.objectsCount());
+	EXPECT_EQ(AmfScanner::VALID, scanner.scan(it, data.data() + data.size()));
+
+	ctx.clear();
+	scanner.sync(ctx);
+	EXPECT_EQ(0u, scanner.objectsCount());
+}
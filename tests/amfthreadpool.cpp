@@ -0,0 +1,48 @@
+#include "amftest.hpp"
+
+#include <atomic>
+#include <stdexcept>
+
+#include "amfthreadpool.hpp"
+
+TEST(AmfThreadPoolTest, Run) {
+	AmfThreadPool pool(3);
+	EXPECT_EQ(3u, pool.size());
+
+	// The pool is reused for several batches.
+	for (size_t count : { 0, 1, 5, 100 }) {
+		std::vector<int> calls(count);
+		pool.run(count, [&](size_t i) { ++calls[i]; });
+		EXPECT_EQ(std::vector<int>(count, 1), calls);
+	}
+}
+
+TEST(AmfThreadPoolTest, NoWorkers) {
+	// An explicit size of 0 means one thread less than the hardware has.
+	AmfThreadPool pool;
+
+	std::atomic<size_t> sum(0);
+	pool.run(10, [&](size_t i) { sum += i; });
+	EXPECT_EQ(45u, sum);
+}
+
+TEST(AmfThreadPoolTest, Exceptions) {
+	AmfThreadPool pool(2);
+	std::atomic<size_t> calls(0);
+
+	try {
+		pool.run(20, [&](size_t i) {
+			++calls;
+			if (i == 7 || i == 3)
+				throw std::out_of_range(std::to_string(i));
+		});
+		FAIL() << "Expected std::out_of_range";
+	} catch (const std::out_of_range& e) {
+		EXPECT_EQ(std::string("3"), e.what());
+	}
+
+	// All calls are made, even after an exception.
+	EXPECT_EQ(20u, calls);
+
+	pool.run(1, [](size_t) { });
+}
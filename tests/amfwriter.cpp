@@ -0,0 +1,227 @@
+#include "amftest.hpp"
+
+#include "amfwriter.hpp"
+#include "deserializer.hpp"
+#include "serializer.hpp"
+#include "types/amfarray.hpp"
+#include "types/amfbool.hpp"
+#include "types/amfbytearray.hpp"
+#include "types/amfdate.hpp"
+#include "types/amfdictionary.hpp"
+#include "types/amfdouble.hpp"
+#include "types/amfinteger.hpp"
+#include "types/amfnull.hpp"
+#include "types/amfobject.hpp"
+#include "types/amfstring.hpp"
+#include "types/amfundefined.hpp"
+#include "types/amfvector.hpp"
+
+TEST(AmfWriterTest, Scalars) {
+	Serializer s;
+	s << AmfUndefined() << AmfNull() << AmfBool(true) << AmfBool(false)
+	  << AmfInteger(17) << AmfInteger(0x10000000) << AmfDouble(0.5)
+	  << AmfString("foo") << AmfString("foo") << AmfString("")
+	  << AmfDate(1234ll) << AmfByteArray(v8 { 1, 2, 3 });
+
+	AmfWriter w;
+	v8 bytes { 1, 2, 3 };
+	w.writeUndefined();
+	w.writeNull();
+	w.writeBool(true);
+	w.writeBool(false);
+	w.writeInt(17);
+	w.writeInt(0x10000000);
+	w.writeDouble(0.5);
+	w.writeString("foo");
+	w.writeString("foo");
+	w.writeString("");
+	w.writeDate(1234);
+	w.writeByteArray(bytes.data(), bytes.size());
+
+	isEqual(s.data(), w.data());
+	EXPECT_TRUE(w.complete());
+}
+
+TEST(AmfWriterTest, Array) {
+	AmfArray array(std::vector<AmfInteger> { 1, 2 });
+	array.insert("name", AmfString("foo"));
+
+	AmfWriter w;
+	EXPECT_EQ(0u, w.beginArray(2));
+	w.writeKey("name");
+	w.writeString("foo");
+	w.writeInt(1);
+	w.writeInt(2);
+	w.endArray();
+
+	isEqual(Serializer().operator<<(array).data(), w.data());
+
+	AmfWriter dense;
+	dense.beginArray(1);
+	dense.beginArray(0);
+	dense.endArray();
+	dense.endArray();
+	isEqual(v8 { 0x09, 0x03, 0x01, 0x09, 0x01, 0x01 }, dense.data());
+}
+
+TEST(AmfWriterTest, Object) {
+	AmfObject point("Point", true, false);
+	point.addSealedProperty("x", AmfInteger(1));
+	point.addSealedProperty("y", AmfDouble(2.5));
+	point.addDynamicProperty("label", AmfString("origin"));
+
+	AmfWriter w;
+	w.beginObject("Point", { "x", "y" }, true);
+	w.writeInt(1);
+	w.writeDouble(2.5);
+	w.writeKey("label");
+	w.writeString("origin");
+	w.endObject();
+
+	Serializer s;
+	s << point;
+	isEqual(s.data(), w.data());
+}
+
+TEST(AmfWriterTest, Table) {
+	// Rows of sealed objects share their traits.
+	AmfArray rows;
+	for (int i = 0; i < 3; ++i) {
+		AmfObject row("Row", false, false);
+		row.addSealedProperty("id", AmfInteger(i));
+		row.addSealedProperty("name", AmfString("row"));
+		rows.push_back(row);
+	}
+
+	AmfObjectTraits traits("Row", false, false);
+	traits.addAttribute("id");
+	traits.addAttribute("name");
+
+	AmfWriter w;
+	w.beginArray(3);
+	for (int i = 0; i < 3; ++i) {
+		w.beginObject(traits);
+		w.writeInt(i);
+		w.writeString("row");
+		w.endObject();
+	}
+	w.endArray();
+
+	Serializer s;
+	s << rows;
+	isEqual(s.data(), w.data());
+	EXPECT_EQ(rows, Deserializer().deserialize(w.data()).as<AmfArray>());
+}
+
+TEST(AmfWriterTest, VectorAndDictionary) {
+	AmfWriter w;
+	w.beginObjectVector("String", 2, true);
+	w.writeString("a");
+	w.writeString("b");
+	w.endObjectVector();
+	w.beginDictionary(1, true);
+	w.writeInt(3);
+	w.writeNull();
+	w.endDictionary();
+
+	AmfDictionary dict(false, true);
+	dict.insert(AmfInteger(3), AmfNull());
+
+	Serializer s;
+	s << AmfVector<AmfString>({ "a", "b" }, "String", true) << dict;
+	isEqual(s.data(), w.data());
+}
+
+TEST(AmfWriterTest, References) {
+	AmfWriter w;
+	w.beginArray(4);
+	size_t obj = w.beginObject("Point", { "x" }, false);
+	w.writeInt(1);
+	w.endObject();
+	w.writeReference(AMF_OBJECT, obj);
+	w.writeDate(5);
+	w.writeReference(AMF_DATE, 2);
+	w.endArray();
+
+	EXPECT_EQ(1u, obj);
+
+	AmfArray array = Deserializer().deserialize(w.data()).as<AmfArray>();
+	ASSERT_EQ(4u, array.dense.size());
+	EXPECT_EQ(array.dense[0].get(), array.dense[1].get());
+	EXPECT_EQ(AmfDate(5ll), array.dense[2].as<AmfDate>());
+	EXPECT_EQ(AmfDate(5ll), array.dense[3].as<AmfDate>());
+
+	EXPECT_THROW(w.writeReference(AMF_STRING, 0), std::invalid_argument);
+}
+
+TEST(AmfWriterTest, Items) {
+	// Items and written values share the reference tables.
+	AmfWriter w;
+	w.writeString("foo");
+	w.beginArray(0);
+	w.endArray();
+	w.writeItem(AmfString("foo"));
+	w.writeItem(AmfArray());
+
+	isEqual(v8 {
+		0x06, 0x07, 0x66, 0x6f, 0x6f,
+		0x09, 0x01, 0x01,
+		0x06, 0x00,
+		0x09, 0x01, 0x01
+	}, w.data());
+
+	SerializationContext ctx(REFERENCE_BY_VALUE);
+	AmfWriter byValue(ctx);
+	byValue.beginArray(0);
+	byValue.endArray();
+	byValue.writeItem(AmfDate(1ll));
+	byValue.writeItem(AmfDate(1ll));
+	isEqual(v8 {
+		0x09, 0x01, 0x01,
+		0x08, 0x01, 0x3f, 0xf0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x08, 0x02
+	}, byValue.data());
+}
+
+TEST(AmfWriterTest, Clear) {
+	AmfWriter w;
+	w.writeString("foo");
+	w.beginArray(1);
+	w.clear();
+
+	EXPECT_TRUE(w.complete());
+	w.writeString("foo");
+	isEqual(v8 { 0x06, 0x07, 0x66, 0x6f, 0x6f }, w.data());
+}
+
+TEST(AmfWriterTest, Invalid) {
+	AmfWriter values;
+	values.beginArray(1);
+	values.writeInt(1);
+	EXPECT_THROW(values.writeInt(2), std::invalid_argument);
+	EXPECT_THROW(values.writeKey("key"), std::invalid_argument);
+	EXPECT_THROW(values.endObject(), std::invalid_argument);
+	values.endArray();
+	EXPECT_THROW(values.endArray(), std::invalid_argument);
+
+	AmfWriter missing;
+	missing.beginObject("Point", { "x", "y" }, true);
+	missing.writeInt(1);
+	EXPECT_THROW(missing.writeKey("z"), std::invalid_argument);
+	EXPECT_THROW(missing.endObject(), std::invalid_argument);
+	missing.writeInt(2);
+	EXPECT_THROW(missing.writeKey(""), std::invalid_argument);
+	missing.writeKey("z");
+	EXPECT_THROW(missing.endObject(), std::invalid_argument);
+	missing.writeNull();
+	missing.endObject();
+	EXPECT_TRUE(missing.complete());
+
+	AmfWriter sealed;
+	sealed.beginObject("Point", { }, false);
+	EXPECT_THROW(sealed.writeKey("x"), std::invalid_argument);
+
+	AmfWriter external;
+	EXPECT_THROW(external.beginObject(AmfObjectTraits("ext", false, true)),
+		std::invalid_argument);
+}
@@ -82,6 +82,41 @@ TEST(DeserializationContext, Pointer) {
 	ASSERT_THROW(ctx.getObject<AmfDouble>(1), std::invalid_argument);
 }
 
+TEST(DeserializationContextTest, StringsInContext) {
+	DeserializationContext ctx;
+	EXPECT_EQ(STRINGS_IN_CONTEXT, ctx.stringStorageMode());
+
+	std::string input("foobar");
+	AmfStringView view = ctx.addString(AmfStringView(input));
+	EXPECT_EQ("foobar", view);
+	EXPECT_NE(input.data(), view.data());
+
+	// References resolve to the stored copy.
+	EXPECT_EQ(view.data(), ctx.getString(0).data());
+
+	input = "qux";
+	EXPECT_EQ("foobar", ctx.getString(0));
+}
+
+TEST(DeserializationContextTest, StringsInInput) {
+	DeserializationContext ctx(STRINGS_IN_INPUT);
+	EXPECT_EQ(STRINGS_IN_INPUT, ctx.stringStorageMode());
+
+	std::string input("foobar");
+	AmfStringView view = ctx.addString(AmfStringView(input.data(), 3));
+	EXPECT_EQ("foo", view);
+	EXPECT_EQ(input.data(), view.data());
+	EXPECT_EQ(input.data(), ctx.getString(0).data());
+
+	// Strings that aren't views are still copied.
+	ctx.addString(std::string("bar"));
+	EXPECT_EQ("bar", ctx.getString(1));
+
+	// Empty strings are never stored.
+	EXPECT_TRUE(ctx.addString(AmfStringView()).empty());
+	ASSERT_THROW(ctx.getString(2), std::out_of_range);
+}
+
 TEST(DeserializationContextTest, Clear) {
 	DeserializationContext ctx;
 
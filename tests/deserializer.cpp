@@ -18,6 +18,7 @@
 #include "types/amfxml.hpp"
 #include "types/amfxmldocument.hpp"
 
+#include "utils/amfarena.hpp"
 #include "utils/amfitemptr.hpp"
 
 template<typename T>
@@ -34,6 +35,24 @@ static void deserializesTo(const T& expected, v8 data, int left = 0) {
 		DeserializationContext ctx;
 		T k = Deserializer::deserialize(data, ctx).as<T>();
 		ASSERT_EQ(expected, k);
+
+		Deserializer d2;
+		T l = d2.deserialize(data.data(), data.size()).as<T>();
+		ASSERT_EQ(expected, l);
+
+		Deserializer d3;
+		const u8* ptr = data.data();
+		const u8* end = data.data() + data.size();
+		T m = d3.deserialize(ptr, end).as<T>();
+		ASSERT_EQ(expected, m);
+		ASSERT_EQ(left, end - ptr);
+
+		AmfArena arena;
+		DeserializationContext arenaCtx;
+		arenaCtx.setArena(&arena);
+		T n = Deserializer::deserialize(data, arenaCtx).as<T>();
+		ASSERT_EQ(expected, n);
+		ASSERT_LE(1u, arena.size());
 	} catch(std::exception& e) {
 		FAIL() << "Deserialization threw exception:\n"
 		       << e.what() ;
@@ -98,6 +117,27 @@ TEST(DeserializerTest, Array) {
 		0x09, 0x07, 0x01, 0x04, 0x01, 0x04, 0x02, 0x04, 0x03, 0xff }, 1);
 }
 
+TEST(DeserializerTest, ArrayArena) {
+	// [ self ]
+	v8 data { 0x09, 0x03, 0x01, 0x09, 0x00 };
+
+	AmfArena arena;
+	DeserializationContext ctx;
+	ctx.setArena(&arena);
+	EXPECT_EQ(&arena, ctx.getArena());
+
+	AmfItemPtr ptr = Deserializer::deserialize(data, ctx);
+	const AmfArray& array = ptr.as<AmfArray>();
+	ASSERT_EQ(1u, array.dense.size());
+	EXPECT_EQ(ptr.get(), array.dense[0].get());
+	EXPECT_EQ(1u, arena.size());
+
+	// Resetting the arena after clearing the context frees the cyclic graph.
+	ctx.clear();
+	arena.clear();
+	EXPECT_EQ(0u, arena.size());
+}
+
 TEST(DeserializerTest, Xml) {
 	deserializesTo(AmfXml(""), { 0x0b, 0x01 });
 	deserializesTo(AmfXml(""), { 0x0b, 0x01, 0x0b }, 1);
@@ -194,3 +234,19 @@ TEST(DeserializerTest, IncorrectTypeRef) {
 	ASSERT_EQ(AmfArray(), d.deserialize(v8 { 0x09, 0x00 }).as<AmfArray>());
 	ASSERT_THROW(d.deserialize(v8 { 0x10, 0x00 }), std::invalid_argument);
 }
+
+TEST(DeserializerTest, RawBuffer) {
+	const u8 data[] = { 0x04, 0x7e, 0x06, 0x07, 0x66, 0x6f, 0x6f, 0x06, 0x00 };
+	const u8* it = data;
+	const u8* end = data + sizeof(data);
+
+	Deserializer d;
+	EXPECT_EQ(AmfInteger(0x7e), d.deserialize(it, end).as<AmfInteger>());
+	EXPECT_EQ(data + 2, it);
+	EXPECT_EQ(AmfString("foo"), d.deserialize(it, end).as<AmfString>());
+	EXPECT_EQ(AmfString("foo"), d.deserialize(it, end).as<AmfString>());
+	EXPECT_EQ(end, it);
+
+	ASSERT_THROW(d.deserialize(it, end), std::out_of_range);
+	ASSERT_THROW(d.deserialize(data, 1), std::out_of_range);
+}
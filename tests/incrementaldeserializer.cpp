@@ -0,0 +1,332 @@
+#include "amftest.hpp"
+
+#include "amfpacket.hpp"
+#include "deserializer.hpp"
+#include "incrementaldeserializer.hpp"
+#include "serializer.hpp"
+#include "types/amfarray.hpp"
+#include "types/amfbool.hpp"
+#include "types/amfbytearray.hpp"
+#include "types/amfdate.hpp"
+#include "types/amfdictionary.hpp"
+#include "types/amfdouble.hpp"
+#include "types/amfinteger.hpp"
+#include "types/amfnull.hpp"
+#include "types/amfobject.hpp"
+#include "types/amfstring.hpp"
+#include "types/amfvector.hpp"
+#include "types/amfxml.hpp"
+
+static v8 serializeValues() {
+	AmfObject point("Point", true, false);
+	point.addSealedProperty("x", AmfInteger(1));
+	point.addSealedProperty("y", AmfDouble(2.5));
+	point.addDynamicProperty("label", AmfString("origin"));
+
+	AmfObject point2("Point", false, false);
+	point2.addSealedProperty("x", AmfInteger(3));
+	point2.addSealedProperty("y", AmfDouble(-1));
+
+	AmfArray array(std::vector<AmfObject> { point, point2 });
+	array.insert("name", AmfString("points"));
+	array.insert("empty", AmfArray());
+
+	AmfDictionary dict(false, true);
+	dict.insert(AmfString("key"), AmfBool(true));
+	dict.insert(AmfInteger(3), AmfNull());
+
+	Serializer s;
+	s << AmfInteger(17)
+	  << AmfString("foo")
+	  << AmfString("foo")
+	  << point
+	  << array
+	  << AmfVector<int>({ 1, 2, 3 }, true)
+	  << AmfVector<double>({ 0.5 })
+	  << AmfVector<AmfString>({ "a", "b" }, "String")
+	  << dict
+	  << AmfDate(1234567890000ll)
+	  << AmfByteArray(v8 { 1, 2, 3, 4 })
+	  << AmfXml("<a/>")
+	  << AmfString(std::string(300, 'x'))
+	  << point2;
+
+	return s.data();
+}
+
+static std::vector<AmfItemPtr> deserializeAll(const v8& data) {
+	std::vector<AmfItemPtr> items;
+	Deserializer d;
+	const u8* it = data.data();
+	const u8* end = it + data.size();
+	while (it != end)
+		items.push_back(d.deserialize(it, end));
+
+	return items;
+}
+
+TEST(IncrementalDeserializerTest, Chunked) {
+	v8 data = serializeValues();
+	std::vector<AmfItemPtr> expected = deserializeAll(data);
+
+	for (size_t chunk : { 1, 2, 3, 5, 64, 1000 }) {
+		SCOPED_TRACE(chunk);
+
+		IncrementalDeserializer d;
+		std::vector<AmfItemPtr> items;
+		for (size_t i = 0; i < data.size(); i += chunk) {
+			d.push(data.data() + i, std::min(chunk, data.size() - i));
+
+			AmfItemPtr item;
+			while (d.next(item))
+				items.push_back(item);
+		}
+
+		ASSERT_EQ(expected.size(), items.size());
+		for (size_t i = 0; i < items.size(); ++i)
+			EXPECT_EQ(*expected[i], *items[i]) << "value " << i;
+
+		EXPECT_EQ(0u, d.buffered());
+		EXPECT_EQ(0u, d.available());
+	}
+}
+
+TEST(IncrementalDeserializerTest, ValueAvailableWhenComplete) {
+	AmfArray array(std::vector<AmfString> { "foo", "bar" });
+	Serializer s;
+	s << array << AmfInteger(5);
+	const v8& data = s.data();
+
+	IncrementalDeserializer d;
+	AmfItemPtr item;
+
+	// Everything but the last string.
+	d.push(data.data(), 8);
+	EXPECT_FALSE(d.next(item));
+	EXPECT_EQ(8u, d.buffered());
+
+	// The rest of the array and the first byte of the integer.
+	d.push(data.data() + 8, 6);
+	ASSERT_TRUE(d.next(item));
+	EXPECT_EQ(array, *item);
+	EXPECT_FALSE(d.next(item));
+	EXPECT_EQ(1u, d.buffered());
+
+	d.push(data.data() + 14, 1);
+	ASSERT_TRUE(d.next(item));
+	EXPECT_EQ(AmfInteger(5), *item);
+}
+
+TEST(IncrementalDeserializerTest, SharedContext) {
+	// String, traits and object references span values.
+	DeserializationContext ctx;
+	ctx.addString("foo");
+
+	IncrementalDeserializer d(ctx);
+	d.push(v8 { 0x06, 0x00, 0x06, 0x07, 0x62, 0x61, 0x72, 0x06, 0x02 });
+
+	AmfItemPtr item;
+	ASSERT_TRUE(d.next(item));
+	EXPECT_EQ(AmfString("foo"), *item);
+	ASSERT_TRUE(d.next(item));
+	EXPECT_EQ(AmfString("bar"), *item);
+	ASSERT_TRUE(d.next(item));
+	EXPECT_EQ(AmfString("bar"), *item);
+	EXPECT_EQ("bar", d.context().getString(1));
+}
+
+TEST(IncrementalDeserializerTest, Externalizable) {
+	Deserializer::externalDeserializers["ext"] = [] (const u8*& it,
+		const u8* end, DeserializationContext& ctx) -> AmfObject {
+		AmfObject obj("ext", true, false);
+		obj.addDynamicProperty("name", AmfString::deserialize(it, end, ctx));
+		return obj;
+	};
+
+	v8 data {
+		// externalizable object "ext" with AmfString "foo"
+		0x0a, 0x07, 0x07, 0x65, 0x78, 0x74,
+		0x06, 0x07, 0x66, 0x6f, 0x6f,
+		// AmfString reference to "foo"
+		0x06, 0x02
+	};
+
+	IncrementalDeserializer d;
+	for (u8 byte : data)
+		d.push(&byte, 1);
+
+	AmfObject expected("ext", true, false);
+	expected.addDynamicProperty("name", AmfString("foo"));
+
+	AmfItemPtr item;
+	ASSERT_TRUE(d.next(item));
+	EXPECT_EQ(expected, *item);
+	ASSERT_TRUE(d.next(item));
+	EXPECT_EQ(AmfString("foo"), *item);
+	EXPECT_FALSE(d.next(item));
+
+	Deserializer::externalDeserializers.erase("ext");
+}
+
+TEST(IncrementalDeserializerTest, ExternalizableInvalid) {
+	Deserializer::externalDeserializers["ext"] = [] (const u8*& it,
+		const u8* end, DeserializationContext& ctx) -> AmfObject {
+		AmfObject obj("ext", true, false);
+		obj.addDynamicProperty("name", AmfString::deserialize(it, end, ctx));
+		return obj;
+	};
+
+	// Malformed externalizable values are reported instead of being buffered
+	// as incomplete input.
+	v8 data {
+		// externalizable object "ext" with an AmfInteger instead of a string
+		0x0a, 0x07, 0x07, 0x65, 0x78, 0x74,
+		0x04, 0x01
+	};
+
+	IncrementalDeserializer d;
+	EXPECT_THROW(d.push(data), std::invalid_argument);
+
+	// Failed attempts leave no trace in the context.
+	IncrementalDeserializer partial;
+	partial.push(v8 { 0x0a, 0x07, 0x07, 0x65, 0x78, 0x74, 0x06, 0x07, 0x66 });
+	EXPECT_EQ(0u, partial.context().stringsCount());
+	EXPECT_EQ(0u, partial.context().objectsCount());
+	partial.push(v8 { 0x6f, 0x6f });
+	EXPECT_EQ(1u, partial.available());
+	EXPECT_EQ(2u, partial.context().stringsCount());
+
+	Deserializer::externalDeserializers.erase("ext");
+}
+
+TEST(IncrementalDeserializerTest, MaxBuffered) {
+	Serializer s;
+	s << AmfInteger(17) << AmfString(std::string(300, 'a'));
+	v8 data = s.data();
+	data.pop_back();
+
+	// The integer is decoded, the incomplete string doesn't fit.
+	IncrementalDeserializer d(DeserializationContext(), 100);
+	EXPECT_THROW(d.push(data), std::length_error);
+	EXPECT_EQ(1u, d.available());
+
+	IncrementalDeserializer large(DeserializationContext(), data.size());
+	large.push(data);
+	EXPECT_EQ(data.size() - 2, large.buffered());
+
+	// also applies to packets
+	AmfPacket packet;
+	packet.messages.emplace_back("svc", "/1", AmfString(std::string(300, 'a')));
+	SerializationContext sctx;
+	v8 packetData = packet.serialize(sctx);
+	packetData.pop_back();
+
+	IncrementalPacketDeserializer p(DeserializationContext(), 100);
+	EXPECT_THROW(p.push(packetData), std::length_error);
+}
+
+TEST(IncrementalDeserializerTest, Invalid) {
+	IncrementalDeserializer d;
+	EXPECT_THROW(d.push(v8 { 0x04, 0x01, 0xff }), std::invalid_argument);
+
+	IncrementalDeserializer length;
+	EXPECT_THROW(length.push(v8 { 0x06, 0xff, 0xff, 0xff, 0xff }), std::invalid_argument);
+
+	IncrementalDeserializer traits;
+	EXPECT_THROW(traits.push(v8 { 0x0a, 0x05 }), std::invalid_argument);
+
+	EXPECT_THROW(IncrementalDeserializer((DeserializationContext(STRINGS_IN_INPUT))),
+		std::invalid_argument);
+}
+
+static AmfPacket makePacket() {
+	AmfPacket packet;
+	packet.headers.emplace_back("auth", true, AmfString("token"));
+	packet.headers.emplace_back("id", false, AmfInteger(7));
+
+	AmfObject obj("Point", false, false);
+	obj.addSealedProperty("x", AmfInteger(1));
+	packet.messages.emplace_back("svc.first", "/1", obj);
+	packet.messages.emplace_back("svc.second", "/2", AmfArray(std::vector<AmfObject> { obj, obj }));
+	packet.messages.emplace_back("svc.third", "/3", AmfString("token"));
+	return packet;
+}
+
+static void packetDeserializesTo(const AmfPacket& expected, const v8& data) {
+	for (size_t chunk : { 1, 2, 7, 1000 }) {
+		SCOPED_TRACE(chunk);
+
+		IncrementalPacketDeserializer d;
+		AmfPacket packet;
+		for (size_t i = 0; i < data.size(); i += chunk) {
+			EXPECT_FALSE(d.finished());
+			d.push(data.data() + i, std::min(chunk, data.size() - i));
+
+			PacketHeader header("", false, AmfNull());
+			while (d.nextHeader(header))
+				packet.headers.push_back(header);
+
+			PacketMessage message("", "", AmfNull());
+			while (d.nextMessage(message))
+				packet.messages.push_back(message);
+		}
+
+		EXPECT_TRUE(d.finished());
+		EXPECT_EQ(0u, d.buffered());
+		EXPECT_EQ(expected, packet);
+	}
+}
+
+TEST(IncrementalPacketDeserializerTest, Chunked) {
+	AmfPacket packet = makePacket();
+	SerializationContext ctx;
+	packetDeserializesTo(packet, packet.serialize(ctx));
+}
+
+TEST(IncrementalPacketDeserializerTest, UnknownLength) {
+	AmfPacket packet;
+	packet.headers.emplace_back("h", false, AmfArray(std::vector<AmfInteger> { 1, 2 }));
+	packet.messages.emplace_back("t", "r", AmfString("value"));
+
+	v8 data {
+		0x00, 0x03,
+		0x00, 0x01,
+		0x00, 0x01, 0x68, 0x00,
+		0xff, 0xff, 0xff, 0xff,
+		0x11, 0x09, 0x05, 0x01, 0x04, 0x01, 0x04, 0x02,
+		0x00, 0x01,
+		0x00, 0x01, 0x74, 0x00, 0x01, 0x72,
+		0xff, 0xff, 0xff, 0xff,
+		0x11, 0x06, 0x0b, 0x76, 0x61, 0x6c, 0x75, 0x65
+	};
+
+	packetDeserializesTo(packet, data);
+}
+
+TEST(IncrementalPacketDeserializerTest, MessageAvailableWhenComplete) {
+	AmfPacket packet = makePacket();
+	SerializationContext sctx;
+	v8 data = packet.serialize(sctx);
+
+	// Push everything but the last byte, which belongs to the last message.
+	IncrementalPacketDeserializer d;
+	d.push(data.data(), data.size() - 1);
+
+	PacketMessage message("", "", AmfNull());
+	ASSERT_TRUE(d.nextMessage(message));
+	EXPECT_EQ(packet.messages[0], message);
+	ASSERT_TRUE(d.nextMessage(message));
+	EXPECT_EQ(packet.messages[1], message);
+	EXPECT_FALSE(d.nextMessage(message));
+	EXPECT_FALSE(d.finished());
+
+	d.push(&data.back(), 1);
+	ASSERT_TRUE(d.nextMessage(message));
+	EXPECT_EQ(packet.messages[2], message);
+	EXPECT_TRUE(d.finished());
+}
+
+TEST(IncrementalPacketDeserializerTest, Invalid) {
+	IncrementalPacketDeserializer d;
+	EXPECT_THROW(d.push(v8 { 0x00, 0x00 }), std::invalid_argument);
+}
@@ -0,0 +1,237 @@
+#include "amftest.hpp"
+
+#include <typeinfo>
+
+#include "deserializer.hpp"
+#include "lazydeserializer.hpp"
+#include "serializer.hpp"
+#include "types/amfarray.hpp"
+#include "types/amfbool.hpp"
+#include "types/amfbytearray.hpp"
+#include "types/amfdate.hpp"
+#include "types/amfdictionary.hpp"
+#include "types/amfdouble.hpp"
+#include "types/amfinteger.hpp"
+#include "types/amfnull.hpp"
+#include "types/amfobject.hpp"
+#include "types/amfstring.hpp"
+#include "types/amfvector.hpp"
+#include "types/amfxml.hpp"
+
+static AmfObject makeUser(int id, std::string name) {
+	AmfObject user("User", true, false);
+	user.addSealedProperty("id", AmfInteger(id));
+	user.addSealedProperty("name", AmfString(name));
+	user.addDynamicProperty("tags", AmfArray(std::vector<AmfString> { "admin", name }));
+	return user;
+}
+
+static AmfObject makeRequest() {
+	AmfArray body;
+	for (int i = 0; i < 5; ++i)
+		body.push_back(makeUser(i, "user" + std::to_string(i % 2)));
+	body.insert("count", AmfInteger(5));
+
+	AmfObject request("Request", false, false);
+	request.addSealedProperty("body", body);
+	request.addSealedProperty("user", makeUser(42, "bob"));
+	request.addSealedProperty("ratio", AmfDouble(0.25));
+	return request;
+}
+
+TEST(LazyDeserializerTest, Access) {
+	AmfObject request = makeRequest();
+	Serializer s;
+	s << request;
+
+	LazyDeserializer d(s.data());
+	AmfLazyValue value = d.next();
+	EXPECT_EQ(AMF_OBJECT, value.type());
+	EXPECT_EQ("Request", value.objectTraits().className);
+
+	// Accessing a later member first reads the members before it, so that
+	// string and traits references resolve.
+	AmfLazyValue user = value.getSealedProperty("user");
+	EXPECT_EQ(42, user.getSealedProperty("id").asInt());
+	EXPECT_EQ("bob", user.getSealedProperty("name").asString());
+	EXPECT_EQ("bob", user.getDynamicProperty("tags").at(1).asString());
+	EXPECT_EQ(0.25, value.getSealedProperty("ratio").asDouble());
+
+	AmfLazyValue body = value.getSealedProperty("body");
+	EXPECT_EQ(5u, body.size());
+	EXPECT_EQ(5, body.at("count").asInt());
+	EXPECT_EQ(3, body.at(3).getSealedProperty("id").asInt());
+	EXPECT_EQ("user1", body.at(3).getSealedProperty("name").asString());
+	EXPECT_EQ("User", body.at(4).objectTraits().className);
+
+	EXPECT_EQ(request, value.as<AmfObject>());
+	EXPECT_EQ(makeUser(2, "user0"), body.at(2).as<AmfObject>());
+}
+
+TEST(LazyDeserializerTest, Materialize) {
+	AmfDictionary dict(false, true);
+	dict.insert(AmfString("key"), AmfBool(true));
+
+	AmfXml xml("<a/>");
+	AmfArray array(std::vector<AmfXml> { xml, xml });
+	array.push_back(AmfVector<int>({ 1, 2 }));
+	array.push_back(AmfVector<double>({ 0.5 }));
+	array.push_back(AmfVector<AmfString>({ "a", "b" }, "String", true));
+	array.push_back(dict);
+	array.push_back(AmfDate(1234ll));
+	array.push_back(AmfByteArray(v8 { 1, 2 }));
+	array.push_back(AmfNull());
+	array.push_back(AmfBool(false));
+
+	Serializer s;
+	s << AmfString("a") << array << AmfInteger(-3) << makeRequest() << makeRequest();
+	const v8& data = s.data();
+
+	std::vector<AmfItemPtr> expected;
+	Deserializer deserializer;
+	const u8* it = data.data();
+	while (it != data.data() + data.size())
+		expected.push_back(deserializer.deserialize(it, data.data() + data.size()));
+
+	LazyDeserializer d(data);
+	for (size_t i = 0; i < expected.size(); ++i) {
+		SCOPED_TRACE(i);
+		ASSERT_FALSE(d.finished());
+		EXPECT_EQ(*expected[i], *d.next().materialize());
+	}
+	EXPECT_TRUE(d.finished());
+	EXPECT_THROW(d.next(), std::out_of_range);
+}
+
+TEST(LazyDeserializerTest, MaterializePacked) {
+	AmfArray ints(std::vector<AmfInteger> { 1, 2, 3 });
+	AmfArray strings(std::vector<AmfString> { "a", "b", "a" });
+	AmfArray mixed(std::vector<AmfInteger> { 1 });
+	mixed.push_back(AmfDouble(0.5));
+
+	Serializer s;
+	s << ints << strings << mixed;
+
+	// Arrays of scalars of the same type are materialized packed, just like
+	// they are deserialized.
+	LazyDeserializer d(s.data());
+	AmfItemPtr value = d.next().materialize();
+	EXPECT_EQ(std::vector<int>({ 1, 2, 3 }), value.as<AmfArray>().dense.integers());
+	EXPECT_EQ(ints, value.as<AmfArray>());
+
+	value = d.next().materialize();
+	EXPECT_EQ(std::vector<std::string>({ "a", "b", "a" }), value.as<AmfArray>().dense.strings());
+	EXPECT_EQ(strings, value.as<AmfArray>());
+
+	value = d.next().materialize();
+	EXPECT_FALSE(value.as<AmfArray>().dense.packed());
+	EXPECT_EQ(mixed, value.as<AmfArray>());
+}
+
+TEST(LazyDeserializerTest, Vectors) {
+	Serializer s;
+	s << AmfVector<unsigned int>({ 1, 2, 3 }) << AmfVector<AmfString>({ "a", "b" }, "String");
+
+	LazyDeserializer d(s.data());
+	EXPECT_EQ(3u, d.next().size());
+
+	AmfLazyValue vec = d.next();
+	EXPECT_EQ(2u, vec.size());
+	EXPECT_EQ("b", vec.at(1).asString());
+}
+
+TEST(LazyDeserializerTest, Dictionary) {
+	AmfDictionary dict(false, false);
+	dict.insert(AmfInteger(1), AmfString("one"));
+
+	SerializationContext ctx;
+	v8 data = dict.serialize(ctx);
+	LazyDeserializer d(data);
+	AmfLazyValue value = d.next();
+	EXPECT_EQ(1u, value.size());
+	EXPECT_EQ(1, value.keyAt(0).asInt());
+	EXPECT_EQ("one", value.valueAt(0).asString());
+	EXPECT_THROW(value.keyAt(1), std::out_of_range);
+}
+
+TEST(LazyDeserializerTest, References) {
+	AmfObject user = makeUser(1, "bob");
+	AmfArray array;
+	array.dense.push_back(AmfItemPtr(user));
+	array.dense.push_back(array.dense[0]);
+
+	SerializationContext ctx;
+	v8 data = array.serialize(ctx);
+	LazyDeserializer d(data);
+	AmfLazyValue value = d.next();
+
+	// Both the reference and the referenced value give the same object.
+	EXPECT_EQ("bob", value.at(1).getSealedProperty("name").asString());
+	AmfItemPtr first = value.at(0).materialize();
+	EXPECT_EQ(first.get(), value.at(1).materialize().get());
+	EXPECT_EQ(user, first.as<AmfObject>());
+}
+
+TEST(LazyDeserializerTest, OnlyReadsAccessedValues) {
+	Serializer s;
+	s << AmfString("foo") << makeRequest();
+	v8 data = s.data();
+	// The last value is malformed, but never accessed.
+	data.push_back(0xff);
+
+	LazyDeserializer d(data);
+	EXPECT_EQ("foo", d.next().asString());
+	EXPECT_EQ(1u, d.context().stringsCount());
+
+	AmfLazyValue request = d.next();
+	EXPECT_EQ(1u, d.context().stringsCount());
+	EXPECT_EQ(0u, d.context().traitsCount());
+
+	EXPECT_EQ(0.25, request.getSealedProperty("ratio").asDouble());
+	EXPECT_LT(1u, d.context().stringsCount());
+
+	EXPECT_FALSE(d.finished());
+	EXPECT_THROW(d.next().type(), std::invalid_argument);
+}
+
+TEST(LazyDeserializerTest, Invalid) {
+	Serializer s;
+	s << AmfString("foo") << makeUser(1, "bob");
+
+	LazyDeserializer d(s.data());
+	AmfLazyValue str = d.next();
+	EXPECT_THROW(str.asInt(), std::bad_cast);
+	EXPECT_THROW(str.at(0), std::bad_cast);
+	EXPECT_THROW(str.objectTraits(), std::bad_cast);
+
+	AmfLazyValue user = d.next();
+	EXPECT_THROW(user.getSealedProperty("tags"), std::out_of_range);
+	EXPECT_THROW(user.getDynamicProperty("id"), std::out_of_range);
+	EXPECT_THROW(user.at(0), std::bad_cast);
+
+	// externalizable object
+	v8 external { 0x0a, 0x07, 0x07, 0x65, 0x78, 0x74, 0x06, 0x01 };
+	LazyDeserializer ext(external);
+	EXPECT_THROW(ext.next().materialize(), std::invalid_argument);
+
+	// object reference without object
+	v8 reference { 0x09, 0x03, 0x01, 0x09, 0x02 };
+	LazyDeserializer ref(reference);
+	EXPECT_THROW(ref.next().at(0), std::out_of_range);
+
+	// Forward string and traits references are rejected, like the
+	// Deserializer does, even if the context already knows the strings and
+	// traits defined later in the input (as when re-reading a position).
+	v8 forward { 0x09, 0x03, 0x01, 0x06, 0x00 };
+	LazyDeserializer strings(forward);
+	strings.context().addString(std::string("a"));
+	EXPECT_THROW(strings.next().at(0).asString(), std::out_of_range);
+
+	Deserializer eager;
+	EXPECT_THROW(eager.deserialize(forward), std::out_of_range);
+
+	v8 forwardTraits { 0x09, 0x03, 0x01, 0x0a, 0x01 };
+	LazyDeserializer traits(forwardTraits);
+	traits.context().addTraits(AmfObjectTraits("a", false, false));
+	EXPECT_THROW(traits.next().at(0).objectTraits(), std::out_of_range);
+}
@@ -2,6 +2,8 @@
 
 #include "amf.hpp"
 #include "amfpacket.hpp"
+#include "amfthreadpool.hpp"
+#include "deserializationcontext.hpp"
 #include "types/amfarray.hpp"
 #include "types/amfbool.hpp"
 #include "types/amfdouble.hpp"
@@ -245,6 +247,30 @@ TEST(PacketTest, HeaderAndMessage) {
 	}, packet);
 }
 
+TEST(PacketTest, SeparateReferenceTables) {
+	// Every value starts with empty reference tables, so strings aren't
+	// referenced across headers and messages.
+	AmfPacket packet;
+	packet.headers.emplace_back("h", false, AmfString("bar"));
+	packet.messages.emplace_back("t", "r", AmfString("bar"));
+
+	isEqual({
+		0x00, 0x03, // version: AMF 3
+		0x00, 0x01, // header count: 1
+		0x00, 0x01, 0x68, // name: "h"
+		0x00, // must understand: false
+		0x00, 0x00, 0x00, 0x06, // value length: 6
+		0x11, // AMF3 object marker
+		0x06, 0x07, 0x62, 0x61, 0x72, // AmfString "bar"
+		0x00, 0x01, // message count: 1
+		0x00, 0x01, 0x74, // target-uri: "t"
+		0x00, 0x01, 0x72, // response-uri: "r"
+		0x00, 0x00, 0x00, 0x06, // value length: 6
+		0x11, // AMF3 object marker
+		0x06, 0x07, 0x62, 0x61, 0x72 // AmfString "bar", not a reference
+	}, packet);
+}
+
 TEST(PacketTest, TooManyHeaders) {
 	AmfPacket p;
 	SerializationContext ctx;
@@ -538,6 +564,27 @@ TEST(PacketDeserialization, MessageAndHeader) {
 	});
 }
 
+TEST(PacketDeserialization, SeparateReferenceTables) {
+	DeserializationContext ctx;
+	v8 data {
+		0x00, 0x03, // version: AMF 3
+		0x00, 0x01, // header count: 1
+		0x00, 0x01, 0x68, // name: "h"
+		0x00, // must understand: false
+		0x00, 0x00, 0x00, 0x06, // value length: 6
+		0x11, // AMF3 object marker
+		0x06, 0x07, 0x62, 0x61, 0x72, // AmfString "bar"
+		0x00, 0x01, // message count: 1
+		0x00, 0x01, 0x74, // target-uri: "t"
+		0x00, 0x01, 0x72, // response-uri: "r"
+		0x00, 0x00, 0x00, 0x03, // value length: 3
+		0x11, // AMF3 object marker
+		0x06, 0x00 // reference to the string of the header
+	};
+	auto it = data.cbegin();
+	ASSERT_THROW(AmfPacket::deserialize(it, data.cend(), ctx), std::out_of_range);
+}
+
 TEST(PacketDeserialization, FlexMessage) {
 	AmfObject value("flex.messaging.messages.RemotingMessage", true, false);
 	value.addDynamicProperty("body", AmfArray(std::vector<AmfString> { "first_arg", "second_arg" }));
@@ -1048,3 +1095,137 @@ TEST(MessageDeserialization, InvalidValueMarker) {
 	auto it = data.cbegin();
 	ASSERT_THROW(PacketMessage::deserialize(it, data.cend(), ctx), std::invalid_argument);
 }
+
+static AmfPacket makeBatch(size_t calls) {
+	AmfPacket packet;
+	packet.headers.emplace_back("DSId", false, AmfString("1234-abcd"));
+
+	for (size_t i = 0; i < calls; ++i) {
+		AmfObject user("User", false, false);
+		user.addSealedProperty("id", AmfInteger(i));
+		user.addSealedProperty("name", AmfString("user" + std::to_string(i % 3)));
+
+		AmfArray body(std::vector<AmfObject> { user, user });
+		body.insert("method", AmfString("update"));
+		packet.messages.emplace_back("svc.update", "/" + std::to_string(i), body);
+	}
+
+	return packet;
+}
+
+TEST(PacketParallel, Serialize) {
+	AmfPacket packet = makeBatch(50);
+	AmfThreadPool pool(3);
+
+	SerializationContext ctx;
+	v8 expected = packet.serialize(ctx);
+
+	v8 parallel { 0xff };
+	packet.serializeParallel(parallel, SerializationContext(), pool);
+	parallel.erase(parallel.begin());
+	EXPECT_EQ(expected, parallel);
+
+	// options of the context are used by every value
+	SerializationContext byValue(REFERENCE_BY_VALUE);
+	v8 serial;
+	packet.serialize(serial, byValue);
+	v8 parallelByValue;
+	packet.serializeParallel(parallelByValue, byValue, pool);
+	EXPECT_EQ(serial, parallelByValue);
+}
+
+TEST(PacketParallel, Deserialize) {
+	AmfPacket packet = makeBatch(50);
+	SerializationContext sctx;
+	v8 data = packet.serialize(sctx);
+	data.push_back(0xff);
+
+	AmfThreadPool pool(3);
+	const u8* it = data.data();
+	DeserializationContext ctx;
+	EXPECT_EQ(packet, AmfPacket::deserializeParallel(it, data.data() + data.size(), ctx, pool));
+	EXPECT_EQ(data.data() + data.size() - 1, it);
+}
+
+TEST(PacketParallel, UnknownLength) {
+	AmfPacket packet;
+	packet.headers.emplace_back("h", false, AmfArray(std::vector<AmfInteger> { 1, 2 }));
+	packet.messages.emplace_back("t", "r", AmfString("value"));
+
+	v8 data {
+		0x00, 0x03,
+		0x00, 0x01,
+		0x00, 0x01, 0x68, 0x00,
+		0xff, 0xff, 0xff, 0xff,
+		0x11, 0x09, 0x05, 0x01, 0x04, 0x01, 0x04, 0x02,
+		0x00, 0x01,
+		0x00, 0x01, 0x74, 0x00, 0x01, 0x72,
+		0xff, 0xff, 0xff, 0xff,
+		0x11, 0x06, 0x0b, 0x76, 0x61, 0x6c, 0x75, 0x65
+	};
+
+	AmfThreadPool pool(2);
+	const u8* it = data.data();
+	DeserializationContext ctx;
+	EXPECT_EQ(packet, AmfPacket::deserializeParallel(it, data.data() + data.size(), ctx, pool));
+	EXPECT_EQ(data.data() + data.size(), it);
+}
+
+TEST(PacketParallel, Invalid) {
+	AmfPacket packet = makeBatch(4);
+	SerializationContext sctx;
+	v8 data = packet.serialize(sctx);
+
+	AmfThreadPool pool(2);
+	DeserializationContext ctx;
+	const u8* it = data.data();
+	EXPECT_THROW(AmfPacket::deserializeParallel(it, it + data.size() - 1, ctx, pool),
+		std::out_of_range);
+
+	// the last message ends in the middle of a string length
+	data.back() = 0xff;
+	it = data.data();
+	EXPECT_THROW(AmfPacket::deserializeParallel(it, it + data.size(), ctx, pool),
+		std::out_of_range);
+	EXPECT_EQ(data.data(), it);
+
+	AmfArena arena;
+	ctx.setArena(&arena);
+	EXPECT_THROW(AmfPacket::deserializeParallel(it, it + data.size(), ctx, pool),
+		std::invalid_argument);
+}
+
+TEST(PacketParallel, ValueLength) {
+	// The message value "value" is declared 2 bytes long, i.e. the marker and
+	// the string header only.
+	v8 data {
+		0x00, 0x03,
+		0x00, 0x00,
+		0x00, 0x01,
+		0x00, 0x01, 0x74, 0x00, 0x01, 0x72,
+		0x00, 0x00, 0x00, 0x02,
+		0x11, 0x06, 0x0b, 0x76, 0x61, 0x6c, 0x75, 0x65
+	};
+
+	// Both paths bound the value by its length.
+	AmfThreadPool pool(2);
+	DeserializationContext ctx;
+	const u8* it = data.data();
+	EXPECT_THROW(AmfPacket::deserialize(it, it + data.size(), ctx), std::out_of_range);
+	it = data.data();
+	EXPECT_THROW(AmfPacket::deserializeParallel(it, it + data.size(), ctx, pool),
+		std::out_of_range);
+
+	// Bytes after the value within its length are skipped by both.
+	data[15] = 0x09;
+	data.push_back(0x01);
+	AmfPacket expected;
+	expected.messages.emplace_back("t", "r", AmfString("value"));
+
+	it = data.data();
+	EXPECT_EQ(expected, AmfPacket::deserialize(it, it + data.size(), ctx));
+	EXPECT_EQ(data.data() + data.size(), it);
+	it = data.data();
+	EXPECT_EQ(expected, AmfPacket::deserializeParallel(it, it + data.size(), ctx, pool));
+	EXPECT_EQ(data.data() + data.size(), it);
+}
@@ -0,0 +1,213 @@
+#include "amftest.hpp"
+
+#include "serializationcontext.hpp"
+#include "serializer.hpp"
+#include "types/amfarray.hpp"
+#include "types/amfnull.hpp"
+#include "types/amfstring.hpp"
+
+TEST(SerializationContextTest, String) {
+	SerializationContext ctx;
+
+	EXPECT_EQ(-1, ctx.getIndex(std::string("foo")));
+
+	ctx.addString("foo");
+	EXPECT_EQ(0, ctx.getIndex(std::string("foo")));
+	EXPECT_EQ(-1, ctx.getIndex(std::string("bar")));
+
+	ctx.addString("bar");
+	EXPECT_EQ(0, ctx.getIndex(std::string("foo")));
+	EXPECT_EQ(1, ctx.getIndex(std::string("bar")));
+
+	ctx.clear();
+	EXPECT_EQ(-1, ctx.getIndex(std::string("foo")));
+	ctx.addString("bar");
+	EXPECT_EQ(0, ctx.getIndex(std::string("bar")));
+}
+
+TEST(SerializationContextTest, ManyStrings) {
+	SerializationContext ctx;
+
+	for (int i = 0; i < 10000; ++i)
+		ctx.addString(std::to_string(i));
+
+	EXPECT_EQ(0, ctx.getIndex(std::string("0")));
+	EXPECT_EQ(1234, ctx.getIndex(std::string("1234")));
+	EXPECT_EQ(9999, ctx.getIndex(std::string("9999")));
+	EXPECT_EQ(-1, ctx.getIndex(std::string("10000")));
+}
+
+TEST(SerializationContextTest, MinStringReferenceLength) {
+	SerializationContext ctx;
+	ctx.setMinStringReferenceLength(3);
+
+	ctx.addString("ab");
+	ctx.addString("abc");
+	ctx.addString("ab");
+	ctx.addString("abcd");
+
+	// Short strings are never found, but still take up an index.
+	EXPECT_EQ(-1, ctx.getIndex(std::string("ab")));
+	EXPECT_EQ(1, ctx.getIndex(std::string("abc")));
+	EXPECT_EQ(3, ctx.getIndex(std::string("abcd")));
+
+	// The policy survives clearing the context.
+	ctx.clear();
+	ctx.addString("ab");
+	EXPECT_EQ(-1, ctx.getIndex(std::string("ab")));
+}
+
+TEST(SerializationContextTest, MinStringReferenceLengthSerialization) {
+	SerializationContext ctx;
+	ctx.setMinStringReferenceLength(3);
+	Serializer s(ctx);
+
+	s << AmfString("ab") << AmfString("abc") << AmfString("ab") << AmfString("abc");
+
+	v8 expected {
+		0x06, 0x05, 0x61, 0x62,
+		0x06, 0x07, 0x61, 0x62, 0x63,
+		0x06, 0x05, 0x61, 0x62,
+		// "abc" still has index 1, even though "ab" was sent inline twice.
+		0x06, 0x02
+	};
+	ASSERT_EQ(expected, s.data());
+}
+
+TEST(SerializationContextTest, ObjectTraits) {
+	SerializationContext ctx;
+
+	AmfObjectTraits o1("foo", true, false);
+	AmfObjectTraits o2("foo", false, false);
+	AmfObjectTraits o3("foo", false, false);
+	o3.addAttribute("attr");
+
+	EXPECT_EQ(-1, ctx.getIndex(o1));
+
+	ctx.addTraits(o1);
+	ctx.addTraits(o2);
+	EXPECT_EQ(0, ctx.getIndex(o1));
+	EXPECT_EQ(1, ctx.getIndex(o2));
+	EXPECT_EQ(-1, ctx.getIndex(o3));
+
+	ctx.addTraits(o3);
+	EXPECT_EQ(2, ctx.getIndex(o3));
+	EXPECT_EQ(0, ctx.getIndex(AmfObjectTraits("foo", true, false)));
+
+	ctx.clear();
+	EXPECT_EQ(-1, ctx.getIndex(o1));
+}
+
+TEST(SerializationContextTest, InternedObjectTraits) {
+	SerializationContext ctx;
+
+	AmfObjectTraits traits("InternedObjectTraits", false, false);
+	traits.addAttribute("attr");
+	AmfObjectTraitsPtr interned = AmfObjectTraits::intern(traits);
+
+	// Interned and plain traits refer to the same entry.
+	ctx.addTraits(traits);
+	EXPECT_EQ(0, ctx.getIndex(*interned));
+	EXPECT_EQ(0, ctx.getIndex(*interned));
+
+	ctx.addTraits(AmfObjectTraits("foo", false, false));
+	AmfObjectTraitsPtr other = AmfObjectTraits::intern(AmfObjectTraits("bar", false, false));
+	EXPECT_EQ(-1, ctx.getIndex(*other));
+	ctx.addTraits(*other);
+	EXPECT_EQ(2, ctx.getIndex(*other));
+
+	SerializationContext::Checkpoint checkpoint = { 0, 2, 0 };
+	ctx.rollback(checkpoint);
+	EXPECT_EQ(-1, ctx.getIndex(*other));
+	EXPECT_EQ(0, ctx.getIndex(*interned));
+
+	ctx.clear();
+	EXPECT_EQ(-1, ctx.getIndex(*interned));
+}
+
+TEST(SerializationContextTest, ObjectIdentity) {
+	SerializationContext ctx;
+	EXPECT_EQ(REFERENCE_BY_IDENTITY, ctx.referenceMode());
+
+	AmfArray a1, a2;
+	EXPECT_EQ(-1, ctx.getIndex(a1));
+
+	ctx.addObject(a1);
+	EXPECT_EQ(0, ctx.getIndex(a1));
+	EXPECT_EQ(-1, ctx.getIndex(a2));
+
+	ctx.addObject(a2);
+	EXPECT_EQ(1, ctx.getIndex(a2));
+
+	// Released objects keep counting towards the indices.
+	ctx.releaseObjects();
+	EXPECT_EQ(-1, ctx.getIndex(a1));
+	AmfArray a3;
+	ctx.addObject(a3);
+	EXPECT_EQ(2, ctx.getIndex(a3));
+
+	ctx.clear();
+	ctx.addObject(a1);
+	EXPECT_EQ(0, ctx.getIndex(a1));
+}
+
+TEST(SerializationContextTest, ObjectValue) {
+	SerializationContext ctx(REFERENCE_BY_VALUE);
+	EXPECT_EQ(REFERENCE_BY_VALUE, ctx.referenceMode());
+
+	AmfArray a1, a2;
+	a2.push_back(AmfNull());
+
+	ctx.addObject(a1);
+	EXPECT_EQ(0, ctx.getIndex(a1));
+	EXPECT_EQ(0, ctx.getIndex(AmfArray()));
+	EXPECT_EQ(-1, ctx.getIndex(a2));
+
+	ctx.addObject(a2);
+	ctx.releaseObjects();
+	EXPECT_EQ(1, ctx.getIndex(a2));
+}
+
+TEST(SerializationContextTest, Rollback) {
+	SerializationContext ctx;
+	ctx.addString("foo");
+	ctx.addTraits(AmfObjectTraits("foo", true, false));
+	AmfArray a1, a2;
+	ctx.addObject(a1);
+
+	SerializationContext::Checkpoint checkpoint = ctx.checkpoint();
+	ctx.addString("bar");
+	ctx.addTraits(AmfObjectTraits("bar", true, false));
+	ctx.addObject(a2);
+	ctx.addAnonymousObject();
+	ctx.rollback(checkpoint);
+
+	EXPECT_EQ(0, ctx.getIndex(std::string("foo")));
+	EXPECT_EQ(-1, ctx.getIndex(std::string("bar")));
+	EXPECT_EQ(0, ctx.getIndex(AmfObjectTraits("foo", true, false)));
+	EXPECT_EQ(-1, ctx.getIndex(AmfObjectTraits("bar", true, false)));
+	EXPECT_EQ(0, ctx.getIndex(a1));
+	EXPECT_EQ(-1, ctx.getIndex(a2));
+
+	// indices continue from the checkpoint
+	ctx.addString("baz");
+	EXPECT_EQ(1, ctx.getIndex(std::string("baz")));
+	ctx.addObject(a2);
+	EXPECT_EQ(1, ctx.getIndex(a2));
+}
+
+TEST(SerializationContextTest, RollbackByValue) {
+	SerializationContext ctx(REFERENCE_BY_VALUE);
+	AmfArray a1, a2;
+	a2.push_back(AmfNull());
+	ctx.addObject(a1);
+
+	SerializationContext::Checkpoint checkpoint = ctx.checkpoint();
+	ctx.addObject(a2);
+	ctx.rollback(checkpoint);
+
+	EXPECT_EQ(0, ctx.getIndex(a1));
+	EXPECT_EQ(-1, ctx.getIndex(a2));
+	ctx.addObject(a2);
+	EXPECT_EQ(1, ctx.getIndex(a2));
+}
@@ -0,0 +1,162 @@
+#include "amftest.hpp"
+
+#include "amfpacket.hpp"
+#include "deserializer.hpp"
+#include "serializer.hpp"
+#include "types/amfarray.hpp"
+#include "types/amfbool.hpp"
+#include "types/amfbytearray.hpp"
+#include "types/amfdate.hpp"
+#include "types/amfdictionary.hpp"
+#include "types/amfdouble.hpp"
+#include "types/amfinteger.hpp"
+#include "types/amfnull.hpp"
+#include "types/amfobject.hpp"
+#include "types/amfstring.hpp"
+#include "types/amfundefined.hpp"
+#include "types/amfvector.hpp"
+#include "types/amfxml.hpp"
+#include "types/amfxmldocument.hpp"
+
+// Checks that serializedSize matches serialize, and adds the same references
+// to the context, so that the next item is serialized the same.
+static void sizeMatches(const AmfItem& item, ObjectReferenceMode mode) {
+	SerializationContext sizeCtx(mode), serializeCtx(mode);
+
+	for (int i = 0; i < 2; ++i) {
+		size_t size = item.serializedSize(sizeCtx);
+		v8 data = item.serialize(serializeCtx);
+		EXPECT_EQ(data.size(), size);
+	}
+
+	v8 next, expected;
+	item.serialize(next, sizeCtx);
+	item.serialize(expected, serializeCtx);
+	EXPECT_EQ(expected, next);
+}
+
+static void sizeMatches(const AmfItem& item) {
+	sizeMatches(item, REFERENCE_BY_IDENTITY);
+	sizeMatches(item, REFERENCE_BY_VALUE);
+}
+
+TEST(SerializedSizeTest, Simple) {
+	sizeMatches(AmfUndefined());
+	sizeMatches(AmfNull());
+	sizeMatches(AmfBool(true));
+	sizeMatches(AmfDouble(0.5));
+	for (int value : { 0, 0x7f, 0x80, 0x3fff, 0x4000, 0x1fffff, 0x200000, 0xfffffff, 0x10000000, -1, -0x10000000, -0x10000001 })
+		sizeMatches(AmfInteger(value));
+
+	sizeMatches(AmfString(""));
+	sizeMatches(AmfString("foo"));
+	sizeMatches(AmfString(std::string(200, 'x')));
+	sizeMatches(AmfDate(136969002755210ll));
+	sizeMatches(AmfByteArray(v8 { 1, 2, 3 }));
+	sizeMatches(AmfXml("<a/>"));
+	sizeMatches(AmfXmlDocument(""));
+	sizeMatches(AmfVector<int>({ 1, 2, 3 }, true));
+	sizeMatches(AmfVector<unsigned int>({ 1 }, false));
+	sizeMatches(AmfVector<double>({ 0.5, 1.5 }, false));
+}
+
+TEST(SerializedSizeTest, Complex) {
+	AmfObject point("Point", true, false);
+	point.addSealedProperty("x", AmfInteger(1));
+	point.addSealedProperty("y", AmfString("foo"));
+	point.addDynamicProperty("label", AmfString("foo"));
+
+	AmfArray array(std::vector<AmfObject> { point, point });
+	array.insert("name", AmfString("points"));
+	array.push_back(AmfDate(0ll));
+	sizeMatches(point);
+	sizeMatches(array);
+
+	AmfDictionary strings(true, false);
+	strings.insert(AmfInteger(3), AmfString("3"));
+	strings.insert(AmfDouble(-0.5), AmfString("-0.5"));
+	strings.insert(AmfBool(true), AmfNull());
+	strings.insert(AmfUndefined(), AmfNull());
+	strings.insert(AmfNull(), array);
+	strings.insert(AmfString("3"), AmfString("-0.5"));
+	sizeMatches(strings);
+
+	AmfDictionary objects(false, true);
+	objects.insert(AmfInteger(3), AmfString("3"));
+	objects.insert(point, array);
+	sizeMatches(objects);
+
+	AmfVector<AmfObject> points({ point, point }, "Point", false);
+	sizeMatches(points);
+
+	AmfObject external("foo", false, true);
+	external.externalizer = [] (const AmfObject*) -> v8 {
+		return v8 { 1, 2, 3 };
+	};
+	sizeMatches(external);
+
+	// references to the same instance
+	AmfItemPtr ptr(new AmfObject(point));
+	AmfArray shared;
+	shared.dense.push_back(ptr);
+	shared.dense.push_back(ptr);
+	sizeMatches(shared);
+}
+
+TEST(SerializedSizeTest, Packet) {
+	AmfObject body("", true, false);
+	body.addDynamicProperty("name", AmfString("foo"));
+
+	AmfPacket packet;
+	packet.headers.emplace_back("DSId", true, AmfString("foo"));
+	packet.messages.emplace_back("/1/onResult", "", body);
+	packet.messages.emplace_back("/2/onResult", "/2", AmfString("foo"));
+	sizeMatches(packet);
+}
+
+TEST(SerializedSizeTest, Measure) {
+	AmfString str("foo");
+	AmfArray arr;
+	arr.push_back(str);
+
+	Serializer s;
+	s << str;
+	EXPECT_EQ(5u, s.measure(arr));
+	EXPECT_EQ(2u, s.measure(str));
+
+	// measuring doesn't change the reference tables
+	s.reserve(s.data().size() + s.measure(arr));
+	s << arr;
+	v8 expected {
+		0x06, 0x07, 0x66, 0x6f, 0x6f,
+		0x09, 0x03, 0x01, 0x06, 0x00
+	};
+	EXPECT_EQ(expected, s.data());
+}
+
+TEST(SerializedSizeTest, MeasurePacket) {
+	AmfObject a("A", false, false);
+	a.addSealedProperty("x", AmfInteger(1));
+	AmfObject b1("B1", false, false);
+	b1.addSealedProperty("y", AmfInteger(2));
+	AmfObject b2("B2", false, false);
+	b2.addSealedProperty("z", AmfInteger(3));
+
+	AmfPacket packet;
+	packet.messages.emplace_back("/1/onResult", "", b1);
+
+	// packet values are sized with empty reference tables of their own,
+	// which mustn't replace the tables of the surrounding serializer
+	Serializer s;
+	s << a;
+	EXPECT_LT(0u, s.measure(packet));
+	s << b1 << b2;
+
+	Deserializer d;
+	const v8& data = s.data();
+	auto it = data.cbegin();
+	EXPECT_EQ(AmfItemPtr(a), d.deserialize(it, data.cend()));
+	EXPECT_EQ(AmfItemPtr(b1), d.deserialize(it, data.cend()));
+	EXPECT_EQ(AmfItemPtr(b2), d.deserialize(it, data.cend()));
+	EXPECT_EQ(data.cend(), it);
+}
@@ -73,7 +73,7 @@ TEST(SerializerTest, MultipleMixedValues) {
 }
 
 TEST(SerializerTest, SerializationContext) {
-	Serializer s;
+	Serializer s((SerializationContext(REFERENCE_BY_VALUE)));
 	AmfString str("foo");
 	AmfArray arr;
 	AmfObject obj("foo", true, false);
@@ -93,6 +93,43 @@ TEST(SerializerTest, SerializationContext) {
 	ASSERT_EQ(expected, s.data());
 }
 
+TEST(SerializerTest, IdentityReferencesPerItem) {
+	Serializer s;
+	AmfItemPtr inner((AmfArray()));
+	AmfArray arr;
+	arr.dense.push_back(inner);
+	arr.dense.push_back(inner);
+
+	// Within one item, the shared array is serialized as reference. Across
+	// items, only strings are referenced, as the array may have been a
+	// temporary that was destroyed in between.
+	s << arr << arr;
+	v8 expected {
+		0x09, 0x05, 0x01,
+			0x09, 0x01, 0x01,
+			0x09, 0x02,
+		0x09, 0x05, 0x01,
+			0x09, 0x01, 0x01,
+			0x09, 0x06,
+	};
+	ASSERT_EQ(expected, s.data());
+}
+
+TEST(SerializerTest, IdentityTemporaries) {
+	Serializer s;
+	for (int i = 0; i < 2; ++i) {
+		AmfArray arr;
+		arr.push_back(AmfInteger(i));
+		s << arr;
+	}
+
+	v8 expected {
+		0x09, 0x03, 0x01, 0x04, 0x00,
+		0x09, 0x03, 0x01, 0x04, 0x01
+	};
+	ASSERT_EQ(expected, s.data());
+}
+
 TEST(SerializerTest, SerializationContextClear) {
 	Serializer s;
 	AmfString str("foo");
@@ -110,3 +147,60 @@ TEST(SerializerTest, SerializationContextClear) {
 	data = { 0x06, 0x07, 0x66, 0x6f, 0x6f };
 	ASSERT_EQ(data, s.data());
 }
+
+TEST(SerializerTest, AppendToBuffer) {
+	SerializationContext ctx;
+	v8 buf { 0xAA };
+
+	AmfArray arr;
+	arr.push_back(AmfString("bar"));
+	arr.push_back(AmfInteger(0x3ff));
+	arr.serialize(buf, ctx);
+	AmfString("bar").serialize(buf, ctx);
+
+	v8 expected {
+		0xAA,
+		0x09, 0x05, 0x01,
+		0x06, 0x07, 0x62, 0x61, 0x72,
+		0x04, 0x87, 0x7F,
+		0x06, 0x00
+	};
+	ASSERT_EQ(expected, buf);
+}
+
+TEST(SerializerTest, AppendMatchesVectorApi) {
+	AmfObject obj("foo", true, false);
+	obj.addSealedProperty("a", AmfDouble(0.5));
+	obj.addDynamicProperty("b", AmfString("bar"));
+
+	SerializationContext ctx;
+	v8 expected = obj.serialize(ctx);
+
+	Serializer s;
+	s.reserve(expected.size());
+	s << obj;
+	ASSERT_EQ(expected, s.data());
+}
+
+TEST(SerializerTest, Rollback) {
+	Serializer s;
+	s << AmfString("foo");
+	Serializer::Checkpoint checkpoint = s.checkpoint();
+
+	AmfArray arr;
+	arr.push_back(AmfString("bar"));
+	s << arr << AmfString("bar");
+	s.rollback(checkpoint);
+
+	ASSERT_EQ(v8({ 0x06, 0x07, 0x66, 0x6f, 0x6f }), s.data());
+
+	// "bar" and the array are serialized as if they never were
+	s << AmfString("bar") << AmfString("foo") << arr;
+	v8 expected {
+		0x06, 0x07, 0x66, 0x6f, 0x6f,
+		0x06, 0x07, 0x62, 0x61, 0x72,
+		0x06, 0x00,
+		0x09, 0x03, 0x01, 0x06, 0x02
+	};
+	ASSERT_EQ(expected, s.data());
+}
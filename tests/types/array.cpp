@@ -121,6 +121,24 @@ TEST(ArraySerializationTest, AssociativeDenseArrayUtilityFunctions) {
 
 }
 
+TEST(ArraySerializationTest, AssociativeInsertionOrder) {
+	AmfArray array;
+	array.insert("foo", AmfInteger(1));
+	array.insert("bar", AmfInteger(2));
+	array.insert("foo", AmfInteger(3));
+
+	isEqual(v8 {
+		0x09, // AMF_ARRAY
+		0x01, // 0 dense elements
+		// assoc-values in insertion order
+		0x07, 0x66, 0x6f, 0x6f, // UTF-8-vr "foo"
+		0x04, 0x03, // AmfInteger 3
+		0x07, 0x62, 0x61, 0x72, // UTF-8-vr "bar"
+		0x04, 0x02, // AmfInteger 2
+		0x01 // end of assoc-values
+	}, array);
+}
+
 TEST(ArraySerializationTest, ArrayOfArrays) {
 	AmfInteger v0(0xbeef);
 	AmfString v1("foobar");
@@ -133,6 +151,9 @@ TEST(ArraySerializationTest, ArrayOfArrays) {
 	outerArray.push_back(array);
 	outerArray.push_back(array);
 
+	// outerArray holds two separate copies of array, which are only
+	// serialized as reference when comparing by value.
+	SerializationContext ctx(REFERENCE_BY_VALUE);
 	isEqual(v8 {
 		// AMF_ARRAY
 		0x09,
@@ -154,7 +175,7 @@ TEST(ArraySerializationTest, ArrayOfArrays) {
 			0x09,
 			// reference to array with index 1
 			0x02
-	}, outerArray);
+	}, outerArray, &ctx);
 }
 
 TEST(ArraySerializationTest, SelfReference) {
@@ -173,7 +194,7 @@ TEST(ArraySerializationTest, SelfReference) {
 }
 
 TEST(ArraySerializationTest, ArrayReference) {
-	SerializationContext ctx;
+	SerializationContext ctx(REFERENCE_BY_VALUE);
 	AmfArray arr;
 	AmfArray inner;
 	inner.insert("x", AmfNull());
@@ -188,8 +209,71 @@ TEST(ArraySerializationTest, ArrayReference) {
 	}, arr, &ctx);
 }
 
-TEST(ArraySerializationTest, ArrayReferenceOrder) {
+TEST(ArraySerializationTest, ArrayIdentityReference) {
+	SerializationContext ctx;
+	AmfArray arr;
+	AmfArray inner;
+	inner.insert("x", AmfNull());
+
+	// Equal, but distinct arrays.
+	arr.push_back(inner);
+	arr.push_back(inner);
+
+	// The same array twice.
+	AmfItemPtr shared((AmfArray()));
+	arr.dense.push_back(shared);
+	arr.dense.push_back(shared);
+
+	isEqual(v8 {
+		0x09, 0x09,
+			0x01,
+			0x09, 0x01, 0x03, 0x78, 0x01, 0x01,
+			0x09, 0x01, 0x00, 0x01, 0x01,
+			0x09, 0x01, 0x01,
+			0x09, 0x06
+	}, arr, &ctx);
+}
+
+TEST(ArraySerializationTest, CyclicIdentityReference) {
+	SerializationContext ctx;
+	AmfItemPtr outer((AmfArray()));
+	AmfItemPtr inner((AmfArray()));
+	outer.as<AmfArray>().dense.push_back(inner);
+	inner.as<AmfArray>().dense.push_back(outer);
+
+	isEqual(v8 {
+		0x09, 0x03, 0x01,
+			0x09, 0x03, 0x01,
+				0x09, 0x00
+	}, outer.as<AmfArray>(), &ctx);
+
+	// Clean up the cycle.
+	inner.as<AmfArray>().dense.clear();
+}
+
+TEST(ArraySerializationTest, ArrayLargeReferenceIndex) {
 	SerializationContext ctx;
+	AmfArray arr;
+	for (int i = 0; i < 200; ++i)
+		arr.push_back(AmfArray());
+
+	// Reference the element with index 151 (array itself has index 0).
+	arr.dense.push_back(arr.dense[150]);
+
+	v8 data = arr.serialize(ctx);
+	v8 expected { 0x09, 0x82, 0x2E };
+	ASSERT_TRUE(std::equal(expected.begin(), expected.end(), data.end() - 3));
+
+	DeserializationContext dctx;
+	auto it = data.cbegin();
+	AmfArray result = AmfArray::deserialize(it, data.cend(), dctx);
+	EXPECT_EQ(data.cend(), it);
+	ASSERT_EQ(201u, result.dense.size());
+	EXPECT_EQ(result.dense[150].get(), result.dense[200].get());
+}
+
+TEST(ArraySerializationTest, ArrayReferenceOrder) {
+	SerializationContext ctx(REFERENCE_BY_VALUE);
 	AmfItemPtr ptr((AmfArray()));
 	ptr.as<AmfArray>().associative["x"] = ptr;
 	ptr.as<AmfArray>().insert("y", AmfArray());
@@ -207,7 +291,7 @@ TEST(ArraySerializationTest, ArrayReferenceOrder) {
 }
 
 TEST(ArraySerializationTest, Utf8VrReference) {
-	SerializationContext ctx;
+	SerializationContext ctx(REFERENCE_BY_VALUE);
 	AmfArray array;
 	array.insert("x", AmfString("x"));
 
@@ -334,6 +418,49 @@ TEST(ArrayDeserialization, IntDenseArray) {
 	deserializesTo(a, data, 0);
 }
 
+TEST(ArrayDeserialization, PackedDenseArray) {
+	v8 data {
+		0x09, 0x09, 0x01,
+			0x06, 0x07, 0x66, 0x6f, 0x6f, // "foo"
+			0x06, 0x07, 0x62, 0x61, 0x72, // "bar"
+			0x06, 0x00, // reference to "foo"
+			0x06, 0x01 // ""
+	};
+
+	DeserializationContext ctx;
+	auto it = data.cbegin();
+	AmfArray a = AmfArray::deserialize(it, data.cend(), ctx);
+	EXPECT_EQ(std::vector<std::string>({ "foo", "bar", "foo", "" }), a.dense.strings());
+
+	// Packed values are serialized directly.
+	SerializationContext sctx;
+	EXPECT_EQ(data, a.serialize(sctx));
+	SerializationContext measured;
+	EXPECT_EQ(data.size(), a.serializedSize(measured));
+	EXPECT_TRUE(a.dense.packed());
+
+	v8 numbers {
+		0x09, 0x07, 0x01, 0x05, 0x3f, 0xf8, 0, 0, 0, 0, 0, 0,
+			0x05, 0xc0, 0x04, 0, 0, 0, 0, 0, 0,
+			0x04, 0x01 // integer, so the array isn't packed from here on
+	};
+	it = numbers.cbegin();
+	AmfArray mixed = AmfArray::deserialize(it, numbers.cend(), ctx);
+	EXPECT_EQ(AmfDenseArray::ITEMS, mixed.dense.storageType());
+	EXPECT_EQ(AmfDouble(1.5), mixed.at<AmfDouble>(0));
+	EXPECT_EQ(AmfDouble(-2.5), mixed.at<AmfDouble>(1));
+	EXPECT_EQ(AmfInteger(1), mixed.at<AmfInteger>(2));
+	sctx.clear();
+	EXPECT_EQ(numbers, mixed.serialize(sctx));
+}
+
+TEST(ArrayDeserialization, PackedDenseArrayTruncated) {
+	DeserializationContext ctx;
+	v8 data { 0x09, 0x07, 0x01, 0x04, 0x01, 0x03 };
+	auto it = data.cbegin();
+	EXPECT_THROW(AmfArray::deserialize(it, data.cend(), ctx), std::out_of_range);
+}
+
 TEST(ArrayDeserialization, MixedDenseArray) {
 	AmfArray a;
 	a.push_back(AmfInteger(1));
@@ -376,6 +503,22 @@ TEST(ArrayDeserialization, SparseArray) {
 	deserializesTo(a, data, 0);
 }
 
+TEST(ArrayDeserialization, AssociativeWireOrder) {
+	v8 data {
+		0x09, 0x01, 0x07, 0x66, 0x6f, 0x6f, 0x04, 0x01, 0x07, 0x62, 0x61, 0x72,
+		0x04, 0x02, 0x01
+	};
+
+	DeserializationContext ctx;
+	auto it = data.cbegin();
+	AmfArray a = AmfArray::deserialize(it, data.cend(), ctx);
+	ASSERT_EQ(2u, a.associative.size());
+	EXPECT_EQ("foo", a.associative.begin()->first);
+
+	SerializationContext sctx;
+	EXPECT_EQ(data, a.serialize(sctx));
+}
+
 TEST(ArrayDeserialization, SparseArrayStringCache) {
 	AmfArray a;
 	a.insert("foo", AmfInteger(1));
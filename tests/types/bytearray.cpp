@@ -65,7 +65,7 @@ TEST(ByteArraySerializationTest, ExplicitVectorCtor) {
 }
 
 TEST(ByteArraySerializationTest, ObjectReferences) {
-	SerializationContext ctx;
+	SerializationContext ctx(REFERENCE_BY_VALUE);
 	isEqual({0x0c, 0x07, 0x01, 0x02, 0x03}, AmfByteArray {v8 {1, 2, 3}}, &ctx);
 	isEqual({0x0c, 0x00}, AmfByteArray {v8 {1, 2, 3}}, &ctx);
 	isEqual({0x0c, 0x07, 0x04, 0x05, 0x06}, AmfByteArray {v8 {4, 5, 6}}, &ctx);
@@ -42,7 +42,7 @@ TEST(DateSerializationTest, Epoch) {
 }
 
 TEST(DateSerializationTest, ObjectCache) {
-	SerializationContext ctx;
+	SerializationContext ctx(REFERENCE_BY_VALUE);
 	isEqual({ 0x08, 0x01, 0x42, 0xdf, 0x24, 0xa5, 0x30, 0x49, 0x22, 0x80 }, AmfDate(136969002755210ll), &ctx);
 	isEqual({ 0x08, 0x00 }, AmfDate(136969002755210ll), &ctx);
 	isEqual({ 0x08, 0x00 }, AmfDate(136969002755210ll), &ctx);
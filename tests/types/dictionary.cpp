@@ -446,7 +446,7 @@ TEST(DictionarySerializationTest, ReferenceMembers) {
 		0x09, 0x04, 0x11, 0x02
 	};
 
-	SerializationContext ctx;
+	SerializationContext ctx(REFERENCE_BY_VALUE);
 	auto s = d.serialize(ctx);
 	ASSERT_TRUE(s == data1 || s == data2);
 }
@@ -239,3 +239,21 @@ TEST(IntegerDeserializationTest, NotEnoughBytes) {
 	it = data.cbegin();
 	ASSERT_NO_THROW(AmfInteger::deserialize(it, data.cend(), ctx));
 }
+
+TEST(IntegerSerializationTest, AppendToBuffer) {
+	SerializationContext ctx;
+	v8 buf { 0x01 };
+
+	AmfInteger(0x3ff).serialize(buf, ctx);
+	AmfInteger(0x10000000).serialize(buf, ctx);
+	AmfInteger::serializeLength(buf, 0x7f);
+
+	v8 expected {
+		0x01,
+		0x04, 0x87, 0x7F,
+		0x05, 0x41, 0xB0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x81, 0x7F
+	};
+	ASSERT_EQ(expected, buf);
+	ASSERT_THROW(AmfInteger::serializeLength(buf, 1 << 27), std::invalid_argument);
+}
@@ -177,7 +177,7 @@ TEST(ObjectSerializationTest, SerializeOnlyPropsInTraits) {
 	obj.addSealedProperty("sealedProp", AmfInteger(0x05ffeffe));
 
 	// this should not be serialized as it's not part of the trait attributes
-	obj.sealedProperties["unusedProp"] = AmfItemPtr(new AmfString("unused"));
+	obj.sealedValues.push_back(AmfItemPtr(new AmfString("unused")));
 
 	isEqual(v8 {
 		0x0a, // AMF_OBJECT
@@ -288,7 +288,7 @@ TEST(ObjectSerializationTest, OnlySerializeDynamicPropsOnDynamicObjects) {
 
 TEST(ObjectSerializationTest, Externalizable) {
 	auto externalizer = [] (const AmfObject* o) -> v8 {
-		return v8 { u8(o->sealedProperties.size() * 3) };
+		return v8 { u8(o->sealedValues.size() * 3) };
 	};
 
 	AmfObject obj("foo", false, true);
@@ -391,7 +391,7 @@ TEST(ObjectSerialization, PropertyCache) {
 	obj.addDynamicProperty("foo", inner);
 	obj.addSealedProperty("bar", inner);
 
-	SerializationContext ctx;
+	SerializationContext ctx(REFERENCE_BY_VALUE);
 	isEqual({
 		0x0a, 0x1b, 0x01,
 		0x07, 0x62, 0x61, 0x72,
@@ -420,6 +420,19 @@ TEST(ObjectSerialization, TraitRefs) {
 		AmfObject("foo", true, false).serialize(ctx));
 }
 
+TEST(ObjectSerialization, TraitRefsLargeIndex) {
+	SerializationContext ctx;
+	for (int i = 0; i < 100; ++i) {
+		AmfObject("c" + std::to_string(i), false, false).serialize(ctx);
+		ctx.releaseObjects();
+	}
+
+	// (40 << 2) | 1 = 161
+	isEqual(
+		{ 0x0a, 0x81, 0x21 },
+		AmfObject("c40", false, false).serialize(ctx));
+}
+
 TEST(ObjectSerialization, SelfReference) {
 	AmfItemPtr ptr(AmfObject("", true, false));
 	ptr.as<AmfObject>().dynamicProperties["f"] = ptr;
@@ -439,7 +452,7 @@ TEST(ObjectSerialization, ReferenceOrder) {
 	obj.addDynamicProperty("a", ba);
 	obj.addDynamicProperty("b", ba);
 
-	SerializationContext ctx;
+	SerializationContext ctx(REFERENCE_BY_VALUE);
 	isEqual({
 		0x0a, 0x0b, 0x01,
 		0x03, 0x61, 0x0c, 0x03, 0x01,
@@ -555,7 +568,7 @@ TEST(ObjectEquality, CheckOnlyPropsInTraits) {
 	AmfObject o1, o2;
 
 	o1.addSealedProperty("foo", AmfInteger(1));
-	o2.sealedProperties["foo"] = AmfItemPtr(AmfInteger(1));
+	o2.sealedValues.push_back(AmfItemPtr(AmfInteger(1)));
 	EXPECT_NE(o1, o2);
 
 	o2.addSealedProperty("foo", AmfInteger(1));
@@ -585,6 +598,136 @@ TEST(ObjectEquality, MixedTypes) {
 	EXPECT_NE(o, u);
 }
 
+TEST(ObjectProperties, SealedSlots) {
+	AmfObject obj("Point", false, false);
+	obj.addSealedProperty("x", AmfInteger(1));
+	obj.addSealedProperty("y", AmfInteger(2));
+	obj.addSealedProperty("x", AmfInteger(3));
+
+	EXPECT_EQ(0u, obj.getSealedSlot("x"));
+	EXPECT_EQ(1u, obj.getSealedSlot("y"));
+	EXPECT_THROW(obj.getSealedSlot("z"), std::out_of_range);
+	EXPECT_EQ(2u, obj.sealedValues.size());
+
+	// slots are the same for all objects with the same traits
+	AmfObject other(obj.objectTraits());
+	other.sealedValues[1] = AmfItemPtr(new AmfInteger(4));
+
+	size_t y = obj.getSealedSlot("y");
+	EXPECT_EQ(3, obj.getSealedProperty<AmfInteger>(0).value);
+	EXPECT_EQ(2, obj.getSealedProperty<AmfInteger>(y).value);
+	EXPECT_EQ(4, other.getSealedProperty<AmfInteger>(y).value);
+	EXPECT_EQ(4, other.getSealedProperty<AmfInteger>("y").value);
+	EXPECT_THROW(obj.getSealedProperty<AmfInteger>(2), std::out_of_range);
+	EXPECT_THROW(obj.getSealedProperty<AmfString>(y), std::bad_cast);
+}
+
+TEST(ObjectProperties, MissingSealedValue) {
+	AmfObjectTraits traits("Point", false, false);
+	traits.addAttribute("x");
+	AmfObject obj(traits);
+
+	EXPECT_THROW(obj.getSealedProperty<AmfInteger>("x"), std::out_of_range);
+	SerializationContext ctx;
+	EXPECT_THROW(obj.serialize(ctx), std::out_of_range);
+
+	obj.addSealedProperty("x", AmfInteger(1));
+	EXPECT_EQ(1, obj.getSealedProperty<AmfInteger>("x").value);
+}
+
+TEST(ObjectProperties, MissingSealedValueEquality) {
+	AmfObject full("Point", false, false);
+	full.addSealedProperty("x", AmfInteger(1));
+	full.addSealedProperty("y", AmfInteger(2));
+
+	AmfObject empty(full.objectTraits());
+	EXPECT_FALSE(empty == full);
+	EXPECT_FALSE(full == empty);
+	EXPECT_TRUE(empty == AmfObject(full.objectTraits()));
+
+	AmfObject partial(full.objectTraits());
+	partial.addSealedProperty("x", AmfInteger(1));
+	EXPECT_FALSE(partial == full);
+	EXPECT_FALSE(partial == empty);
+
+	partial.addSealedProperty("y", AmfInteger(2));
+	EXPECT_TRUE(partial == full);
+}
+
+TEST(ObjectProperties, DynamicInsertionOrder) {
+	AmfObject obj("", true, false);
+	for (int i = 0; i < 20; ++i)
+		obj.addDynamicProperty(std::string(1, static_cast<char>('z' - i)), AmfInteger(i));
+
+	int i = 0;
+	for (const auto& it : obj.dynamicProperties) {
+		EXPECT_EQ(std::string(1, static_cast<char>('z' - i)), it.first);
+		EXPECT_EQ(i++, it.second.as<AmfInteger>().value);
+	}
+	EXPECT_EQ(19, obj.getDynamicProperty<AmfInteger>("g").value);
+
+	v8 data {
+		0x0a, 0x0b, 0x01,
+			0x03, 0x62, 0x04, 0x01, // b: 1
+			0x03, 0x61, 0x04, 0x02, // a: 2
+			0x01
+	};
+	DeserializationContext ctx;
+	auto it = data.cbegin();
+	AmfObject deserialized = AmfObject::deserialize(it, data.cend(), ctx);
+	EXPECT_EQ("b", deserialized.dynamicProperties.begin()->first);
+
+	// Objects are re-serialized in wire order, but compare equal in any order.
+	SerializationContext sctx;
+	EXPECT_EQ(data, deserialized.serialize(sctx));
+
+	AmfObject sorted("", true, false);
+	sorted.addDynamicProperty("a", AmfInteger(2));
+	sorted.addDynamicProperty("b", AmfInteger(1));
+	EXPECT_EQ(sorted, deserialized);
+}
+
+TEST(ObjectProperties, SharedTraits) {
+	AmfObjectTraits traits("Point", false, false);
+	traits.addAttribute("x");
+	AmfObject obj(AmfObjectTraits::intern(traits));
+	AmfObject copy(obj);
+	EXPECT_EQ(obj.objectTraitsPtr(), copy.objectTraitsPtr());
+
+	// Adding a property copies shared traits instead of modifying them.
+	copy.addSealedProperty("y", AmfInteger(1));
+	EXPECT_EQ(1u, obj.objectTraits().getAttriutes().size());
+	EXPECT_EQ(2u, copy.objectTraits().getAttriutes().size());
+	EXPECT_EQ(0u, copy.objectTraits().getId());
+	EXPECT_NE(obj.objectTraitsPtr(), copy.objectTraitsPtr());
+}
+
+TEST(ObjectDeserialization, SharedTraits) {
+	v8 data {
+		0x09, 0x05, 0x01,
+			0x0a, 0x13, 0x0b, 0x50, 0x6f, 0x69, 0x6e, 0x74, 0x03, 0x78, 0x04, 0x01,
+			0x0a, 0x01, 0x04, 0x02
+	};
+
+	DeserializationContext ctx;
+	auto it = data.cbegin();
+	AmfArray array = AmfArray::deserialize(it, data.cend(), ctx);
+	const AmfObject& first = array.at<AmfObject>(0);
+	const AmfObject& second = array.at<AmfObject>(1);
+	EXPECT_EQ(first.objectTraitsPtr(), second.objectTraitsPtr());
+	EXPECT_NE(0u, first.objectTraits().getId());
+
+	// Objects of the same shape share their traits across contexts.
+	DeserializationContext other;
+	it = data.cbegin();
+	AmfArray again = AmfArray::deserialize(it, data.cend(), other);
+	EXPECT_EQ(first.objectTraitsPtr(), again.at<AmfObject>(0).objectTraitsPtr());
+
+	// Serializing the objects writes a traits reference for the second one.
+	SerializationContext sctx;
+	EXPECT_EQ(data, array.serialize(sctx));
+}
+
 TEST(ObjectDeserialization, EmptyDynamicAnonymousObject) {
 	deserialize(AmfObject("", true, false), { 0x0a, 0x0b, 0x01, 0x01 });
 	deserialize(AmfObject("", true, false), { 0x0a, 0x0b, 0x01, 0x01, 0x0a }, 1);
@@ -823,7 +966,7 @@ TEST(ObjectDeserialization, ComplexNestedObject) {
 }
 
 TEST(ObjectDeserialization, Externalizable) {
-	auto ext = [] (v8::const_iterator&, v8::const_iterator, DeserializationContext&) -> AmfObject {
+	auto ext = [] (const u8*&, const u8*, DeserializationContext&) -> AmfObject {
 		return AmfObject("foobar", true, false);
 	};
 	Deserializer::externalDeserializers["asd"] = ext;
@@ -833,7 +976,7 @@ TEST(ObjectDeserialization, Externalizable) {
 }
 
 TEST(ObjectDeserialization, ExternalizableFromData) {
-	auto ext = [] (v8::const_iterator& it, v8::const_iterator end, DeserializationContext& ctx) -> AmfObject {
+	auto ext = [] (const u8*& it, const u8* end, DeserializationContext& ctx) -> AmfObject {
 		AmfString className = AmfString::deserializeValue(it, end, ctx);
 		return AmfObject(className, false, false);
 	};
@@ -861,7 +1004,7 @@ TEST(ObjectDeserialization, MissingExternalDeserializer) {
 TEST(ObjectDeserialization, ExternalizableInContext) {
 	std::string name("foo");
 	// first time this is called, it returns AmfObject("foo"), afterwards AmfObject("bar");
-	auto ext = [&name] (v8::const_iterator&, v8::const_iterator, DeserializationContext&) -> AmfObject {
+	auto ext = [&name] (const u8*&, const u8*, DeserializationContext&) -> AmfObject {
 		auto ret = AmfObject(name, false, false);
 		name = "bar";
 		return ret;
@@ -94,6 +94,19 @@ TEST(StringSerializationTest, SerializeValueCache) {
 	isEqual(v8 { 0x06, 0x02 }, AmfString("boofar").serialize(ctx));
 }
 
+TEST(StringSerializationTest, SerializeValueCacheLargeIndex) {
+	SerializationContext ctx;
+	for (int i = 0; i < 20000; ++i)
+		AmfString(std::to_string(i)).serializeValue(ctx);
+
+	isEqual(v8 { 0x00 }, AmfString("0").serializeValue(ctx));
+	isEqual(v8 { 0x7E }, AmfString("63").serializeValue(ctx));
+	isEqual(v8 { 0x81, 0x00 }, AmfString("64").serializeValue(ctx));
+	isEqual(v8 { 0x82, 0x2C }, AmfString("150").serializeValue(ctx));
+	isEqual(v8 { 0x81, 0x80, 0x00 }, AmfString("8192").serializeValue(ctx));
+	isEqual(v8 { 0x06, 0x82, 0xB8, 0x3E }, AmfString("19999").serialize(ctx));
+}
+
 TEST(StringSerializationTest, EmtpyStringNotCached) {
 	SerializationContext ctx;
 	isEqual(v8 { 0x01 }, AmfString("").serializeValue(ctx));
@@ -250,6 +263,48 @@ TEST(StringDeserialization, StringContext) {
 	deserializesTo("qux", { 0x06, 0x04 }, 0, &ctx);
 }
 
+TEST(StringDeserialization, DeserializeView) {
+	v8 data { 0x07, 0x62, 0x61, 0x72, 0x07, 0x71, 0x75, 0x78, 0x00, 0x01 };
+	const u8* begin = data.data();
+	const u8* it = begin;
+	const u8* end = begin + data.size();
+	const char* chars = reinterpret_cast<const char*>(begin);
+
+	DeserializationContext ctx(STRINGS_IN_INPUT);
+	AmfStringView bar = AmfString::deserializeView(it, end, ctx);
+	EXPECT_EQ("bar", bar);
+	EXPECT_EQ(chars + 1, bar.data());
+
+	AmfStringView qux = AmfString::deserializeView(it, end, ctx);
+	EXPECT_EQ("qux", qux);
+	EXPECT_EQ(chars + 5, qux.data());
+
+	// References resolve to the same view without copying.
+	AmfStringView ref = AmfString::deserializeView(it, end, ctx);
+	EXPECT_EQ(bar.data(), ref.data());
+	EXPECT_EQ(3u, ref.size());
+
+	EXPECT_TRUE(AmfString::deserializeView(it, end, ctx).empty());
+	EXPECT_EQ(end, it);
+}
+
+TEST(StringDeserialization, DeserializeViewCopy) {
+	v8 data { 0x07, 0x62, 0x61, 0x72, 0x00 };
+	const u8* it = data.data();
+	const u8* end = it + data.size();
+
+	DeserializationContext ctx;
+	AmfStringView bar = AmfString::deserializeView(it, end, ctx);
+	AmfStringView ref = AmfString::deserializeView(it, end, ctx);
+	EXPECT_EQ("bar", bar);
+	EXPECT_EQ(bar.data(), ref.data());
+
+	// The context owns its copy, so the input can go away.
+	data.clear();
+	data.shrink_to_fit();
+	EXPECT_EQ("bar", ctx.getString(0));
+}
+
 TEST(StringDeserialization, EmtpyStringNotCached) {
 	DeserializationContext ctx;
 	deserializesTo("", { 0x06, 0x01 }, 0, &ctx);
@@ -504,7 +504,7 @@ TEST(VectorSerialization, VectorObjectCache) {
 	v.push_back(o);
 	v.push_back(o);
 
-	SerializationContext ctx;
+	SerializationContext ctx(REFERENCE_BY_VALUE);
 	isEqual({
 		0x10, 0x05, 0x00,
 		0x07, 0x46, 0x6f, 0x6f,
@@ -533,7 +533,7 @@ TEST(VectorSerialization, VectorIntVector) {
 	AmfVector<AmfVector<int>> v({ AmfVector<int> { {1, 2, 3 }, false } }, "", false);
 	AmfVector<AmfVector<int>> v2({ AmfVector<int> { {1, 2, 3 }, false } }, "", true);
 
-	SerializationContext ctx;
+	SerializationContext ctx(REFERENCE_BY_VALUE);
 	isEqual({
 		0x10, 0x03, 0x00, 0x01,
 		0x0d, 0x07, 0x00,
@@ -82,7 +82,7 @@ TEST(XmlSerializationTest, MultiByteLengthString) {
 }
 
 TEST(XmlSerializationTest, SerializationCache) {
-	SerializationContext ctx;
+	SerializationContext ctx(REFERENCE_BY_VALUE);
 	isEqual(v8 { 0x0b, 0x01 }, AmfXml("").serialize(ctx));
 	isEqual(v8 { 0x0b, 0x07, 0x66, 0x6f, 0x6f }, AmfXml("foo").serialize(ctx));
 	isEqual(v8 { 0x0b, 0x00 }, AmfXml("").serialize(ctx));
@@ -94,7 +94,7 @@ TEST(XmlSerializationTest, SerializationCache) {
 }
 
 TEST(XmlSerializationTest, SerializationCacheNotShared) {
-	SerializationContext ctx;
+	SerializationContext ctx(REFERENCE_BY_VALUE);
 	isEqual(v8 { 0x0b, 0x01 }, AmfXml("").serialize(ctx));
 	isEqual(v8 { 0x0b, 0x07, 0x66, 0x6f, 0x6f }, AmfXml("foo").serialize(ctx));
 	isEqual(v8 { 0x0b, 0x00 }, AmfXml("").serialize(ctx));
@@ -83,7 +83,7 @@ TEST(XmlDocumentSerializationTest, MultiByteLengthString) {
 }
 
 TEST(XmlDocumentSerializationTest, SerializationCache) {
-	SerializationContext ctx;
+	SerializationContext ctx(REFERENCE_BY_VALUE);
 	isEqual(v8 { 0x07, 0x01 }, AmfXmlDocument("").serialize(ctx));
 	isEqual(v8 { 0x07, 0x07, 0x66, 0x6f, 0x6f }, AmfXmlDocument("foo").serialize(ctx));
 	isEqual(v8 { 0x07, 0x00 }, AmfXmlDocument("").serialize(ctx));
@@ -95,7 +95,7 @@ TEST(XmlDocumentSerializationTest, SerializationCache) {
 }
 
 TEST(XmlDocumentSerializationTest, SerializationCacheNotShared) {
-	SerializationContext ctx;
+	SerializationContext ctx(REFERENCE_BY_VALUE);
 	isEqual(v8 { 0x07, 0x01 }, AmfXmlDocument("").serialize(ctx));
 	isEqual(v8 { 0x07, 0x07, 0x66, 0x6f, 0x6f }, AmfXmlDocument("foo").serialize(ctx));
 	isEqual(v8 { 0x07, 0x00 }, AmfXmlDocument("").serialize(ctx));
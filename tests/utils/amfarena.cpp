@@ -0,0 +1,95 @@
+#include "amftest.hpp"
+
+#include "types/amfarray.hpp"
+#include "types/amfinteger.hpp"
+#include "types/amfstring.hpp"
+#include "utils/amfarena.hpp"
+
+namespace {
+
+class CountedItem : public AmfInteger {
+public:
+	CountedItem(int value, int* alive) : AmfInteger(value), alive(alive) { ++*alive; }
+	~CountedItem() { --*alive; }
+
+	int* alive;
+};
+
+} // namespace
+
+TEST(AmfArenaTest, Create) {
+	AmfArena arena;
+	EXPECT_EQ(0u, arena.size());
+
+	AmfInteger* i = arena.create<AmfInteger>(17);
+	AmfString* s = arena.create<AmfString>("foo");
+	EXPECT_EQ(AmfInteger(17), *i);
+	EXPECT_EQ(AmfString("foo"), *s);
+	EXPECT_EQ(2u, arena.size());
+
+	EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(i) % alignof(AmfInteger));
+	EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(s) % alignof(AmfString));
+}
+
+TEST(AmfArenaTest, ManyItems) {
+	AmfArena arena(256);
+	std::vector<AmfInteger*> items;
+
+	for (int i = 0; i < 1000; ++i)
+		items.push_back(arena.create<AmfInteger>(i));
+
+	for (int i = 0; i < 1000; ++i)
+		EXPECT_EQ(AmfInteger(i), *items[i]);
+}
+
+TEST(AmfArenaTest, OversizedItems) {
+	// Items larger than the block size get a block of their own.
+	AmfArena arena(16);
+	AmfArray* a = arena.create<AmfArray>();
+	AmfArray* b = arena.create<AmfArray>();
+	a->push_back(AmfInteger(1));
+	b->push_back(AmfInteger(2));
+	EXPECT_EQ(AmfInteger(1), a->at<AmfInteger>(0));
+	EXPECT_EQ(AmfInteger(2), b->at<AmfInteger>(0));
+}
+
+TEST(AmfArenaTest, Clear) {
+	int alive = 0;
+	AmfArena arena;
+	arena.create<CountedItem>(1, &alive);
+	arena.create<CountedItem>(2, &alive);
+	EXPECT_EQ(2, alive);
+
+	arena.clear();
+	EXPECT_EQ(0, alive);
+	EXPECT_EQ(0u, arena.size());
+
+	// The arena is still usable after clearing.
+	arena.create<CountedItem>(3, &alive);
+	EXPECT_EQ(1, alive);
+	EXPECT_EQ(1u, arena.size());
+}
+
+TEST(AmfArenaTest, Destructor) {
+	int alive = 0;
+	{
+		AmfArena arena;
+		for (int i = 0; i < 100; ++i)
+			arena.create<CountedItem>(i, &alive);
+		EXPECT_EQ(100, alive);
+	}
+	EXPECT_EQ(0, alive);
+}
+
+TEST(AmfArenaTest, Cycles) {
+	AmfArena arena;
+	AmfArray* a = arena.create<AmfArray>();
+	AmfArray* b = arena.create<AmfArray>();
+	a->dense.push_back(AmfItemPtr::unowned(b));
+	b->dense.push_back(AmfItemPtr::unowned(a));
+
+	EXPECT_EQ(b, a->dense[0].get());
+	EXPECT_EQ(a, b->dense[0].get());
+	// Destroying the arena frees both arrays despite the cycle; leak checkers
+	// (e.g. valgrind) verify this.
+}
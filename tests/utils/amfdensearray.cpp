@@ -0,0 +1,139 @@
+#include "amftest.hpp"
+
+#include "types/amfnull.hpp"
+#include "utils/amfdensearray.hpp"
+
+TEST(AmfDenseArrayTest, Packed) {
+	AmfDenseArray ints;
+	EXPECT_EQ(AmfDenseArray::EMPTY, ints.storageType());
+	EXPECT_TRUE(ints.empty());
+	EXPECT_TRUE(ints.integers().empty());
+
+	ints.push_back(AmfInteger(1));
+	ints.pushInteger(2);
+	EXPECT_EQ(AmfDenseArray::INTEGERS, ints.storageType());
+	EXPECT_EQ(std::vector<int>({ 1, 2 }), ints.integers());
+	EXPECT_EQ(2u, ints.size());
+	EXPECT_THROW(ints.doubles(), std::bad_cast);
+
+	AmfDenseArray doubles;
+	doubles.push_back(AmfDouble(0.5));
+	EXPECT_EQ(std::vector<double>({ 0.5 }), doubles.doubles());
+
+	AmfDenseArray bools;
+	bools.push_back(AmfBool(true));
+	bools.pushBool(false);
+	EXPECT_EQ(std::vector<bool>({ true, false }), bools.bools());
+
+	AmfDenseArray strings;
+	strings.push_back(AmfString("foo"));
+	EXPECT_EQ(std::vector<std::string>({ "foo" }), strings.strings());
+	EXPECT_THROW(strings.integers(), std::bad_cast);
+}
+
+TEST(AmfDenseArrayTest, Fallback) {
+	AmfDenseArray dense;
+	dense.pushInteger(1);
+	dense.pushDouble(2.5);
+	EXPECT_EQ(AmfDenseArray::ITEMS, dense.storageType());
+	EXPECT_FALSE(dense.packed());
+	EXPECT_THROW(dense.integers(), std::bad_cast);
+
+	// Values of the packed type aren't packed anymore either.
+	dense.pushInteger(3);
+	dense.push_back(AmfNull());
+	ASSERT_EQ(4u, dense.size());
+	EXPECT_EQ(AmfInteger(1), dense[0].as<AmfInteger>());
+	EXPECT_EQ(AmfDouble(2.5), dense[1].as<AmfDouble>());
+	EXPECT_EQ(AmfInteger(3), dense.at(2).as<AmfInteger>());
+	EXPECT_THROW(dense.at(4), std::out_of_range);
+
+	dense.clear();
+	dense.pushInteger(4);
+	EXPECT_EQ(AmfDenseArray::INTEGERS, dense.storageType());
+}
+
+TEST(AmfDenseArrayTest, ElementAccess) {
+	AmfDenseArray dense;
+	dense.pushString("foo");
+	dense.pushString("bar");
+
+	// Accessing the values as AmfItemPtrs converts the array, so that they
+	// can be modified.
+	dense[1].as<AmfString>().value = "baz";
+	EXPECT_EQ(AmfDenseArray::ITEMS, dense.storageType());
+	EXPECT_EQ(AmfString("foo"), dense[0].as<AmfString>());
+	EXPECT_EQ(AmfString("baz"), dense[1].as<AmfString>());
+
+	AmfDenseArray ints;
+	ints.pushInteger(1);
+	ints.pushInteger(2);
+	int sum = 0;
+	for (const AmfItemPtr& it : ints)
+		sum += it.as<AmfInteger>().value;
+	EXPECT_EQ(3, sum);
+	EXPECT_FALSE(ints.packed());
+}
+
+TEST(AmfDenseArrayTest, ConstAccess) {
+	AmfDenseArray ints;
+	ints.pushInteger(1);
+	ints.pushInteger(2);
+
+	// Const access returns copies of packed values and keeps them packed.
+	const AmfDenseArray& ref = ints;
+	EXPECT_EQ(AmfInteger(1), ref[0].as<AmfInteger>());
+	EXPECT_EQ(AmfInteger(2), ref.at(1).as<AmfInteger>());
+	EXPECT_THROW(ref.at(2), std::out_of_range);
+	int sum = 0;
+	for (const AmfItemPtr& it : ref)
+		sum += it.as<AmfInteger>().value;
+	EXPECT_EQ(3, sum);
+	EXPECT_EQ(AmfDenseArray::INTEGERS, ints.storageType());
+	EXPECT_THROW(ref.items(), std::bad_cast);
+
+	// Items are returned as they are.
+	AmfItemPtr item(new AmfNull());
+	AmfDenseArray items;
+	items.push_back(item);
+	const AmfDenseArray& itemsRef = items;
+	EXPECT_EQ(item.get(), itemsRef[0].get());
+	EXPECT_EQ(item.get(), (*itemsRef.begin()).get());
+	EXPECT_EQ(1u, itemsRef.items().size());
+}
+
+TEST(AmfDenseArrayTest, SharedItems) {
+	AmfItemPtr item(new AmfInteger(1));
+	AmfDenseArray dense;
+	dense.push_back(item);
+	EXPECT_EQ(AmfDenseArray::ITEMS, dense.storageType());
+
+	item.as<AmfInteger>().value = 2;
+	EXPECT_EQ(2, dense[0].as<AmfInteger>().value);
+}
+
+TEST(AmfDenseArrayTest, Equality) {
+	AmfDenseArray packed;
+	packed.pushInteger(1);
+	packed.pushInteger(2);
+
+	AmfDenseArray items;
+	items.push_back(AmfItemPtr(new AmfInteger(1)));
+	items.push_back(AmfItemPtr(new AmfInteger(2)));
+
+	AmfDenseArray other;
+	other.pushInteger(1);
+	other.pushInteger(3);
+
+	EXPECT_EQ(packed, items);
+	EXPECT_EQ(items, packed);
+	EXPECT_NE(packed, other);
+	EXPECT_NE(items, other);
+	EXPECT_TRUE(packed.packed());
+
+	AmfDenseArray doubles;
+	doubles.pushDouble(1);
+	doubles.pushDouble(2);
+	EXPECT_NE(packed, doubles);
+	EXPECT_EQ(AmfDenseArray(), AmfDenseArray());
+}
@@ -1,7 +1,19 @@
 #include "amftest.hpp"
 
+#include "types/amfarray.hpp"
+#include "types/amfbool.hpp"
+#include "types/amfbytearray.hpp"
+#include "types/amfdate.hpp"
+#include "types/amfdictionary.hpp"
 #include "types/amfdouble.hpp"
 #include "types/amfinteger.hpp"
+#include "types/amfnull.hpp"
+#include "types/amfobject.hpp"
+#include "types/amfstring.hpp"
+#include "types/amfundefined.hpp"
+#include "types/amfvector.hpp"
+#include "types/amfxml.hpp"
+#include "types/amfxmldocument.hpp"
 #include "utils/amfitemptr.hpp"
 
 TEST(AmfItemPtrTest, Construction) {
@@ -55,3 +67,78 @@ TEST(AmfItemPtrTest, Equality) {
 	EXPECT_EQ(i1, i2);
 	EXPECT_NE(i1, d1);
 }
+
+TEST(AmfItemPtrTest, Unowned) {
+	AmfInteger i(17);
+	{
+		AmfItemPtr ptr = AmfItemPtr::unowned(&i);
+		EXPECT_EQ(&i, ptr.get());
+		EXPECT_EQ(AmfInteger(17), ptr.as<AmfInteger>());
+
+		AmfItemPtr copy(ptr);
+		EXPECT_EQ(&i, copy.get());
+	}
+
+	// Destroying the pointers must not have deleted i.
+	EXPECT_EQ(17, i.value);
+}
+
+namespace {
+
+class DerivedInteger : public AmfInteger {
+public:
+	DerivedInteger(int v) : AmfInteger(v) { }
+};
+
+} // namespace
+
+TEST(AmfItemPtrTest, TypeTags) {
+	EXPECT_EQ(AMF_UNDEFINED, AmfUndefined().typeTag());
+	EXPECT_EQ(AMF_NULL, AmfNull().typeTag());
+	EXPECT_EQ(AMF_TRUE, AmfBool(false).typeTag());
+	EXPECT_EQ(AMF_INTEGER, AmfInteger(1).typeTag());
+	EXPECT_EQ(AMF_DOUBLE, AmfDouble(1.0).typeTag());
+	EXPECT_EQ(AMF_STRING, AmfString("foo").typeTag());
+	EXPECT_EQ(AMF_XMLDOC, AmfXmlDocument("").typeTag());
+	EXPECT_EQ(AMF_DATE, AmfDate(0ll).typeTag());
+	EXPECT_EQ(AMF_ARRAY, AmfArray().typeTag());
+	EXPECT_EQ(AMF_OBJECT, AmfObject().typeTag());
+	EXPECT_EQ(AMF_XML, AmfXml("").typeTag());
+	EXPECT_EQ(AMF_BYTEARRAY, AmfByteArray().typeTag());
+	EXPECT_EQ(AMF_VECTOR_INT, AmfVector<int>().typeTag());
+	EXPECT_EQ(AMF_VECTOR_UINT, AmfVector<unsigned int>().typeTag());
+	EXPECT_EQ(AMF_VECTOR_DOUBLE, AmfVector<double>().typeTag());
+	EXPECT_EQ(AMF_VECTOR_OBJECT, AmfVector<AmfItem>("foo").typeTag());
+	EXPECT_EQ(AMF_VECTOR_OBJECT, AmfVector<AmfInteger>({}, "foo").typeTag());
+	EXPECT_EQ(AMF_DICTIONARY, AmfDictionary(false).typeTag());
+
+	// Copies keep the tag.
+	AmfByteArray ba;
+	EXPECT_EQ(AMF_BYTEARRAY, AmfByteArray(ba).typeTag());
+	AmfItemPtr ptr(ba);
+	EXPECT_EQ(AMF_BYTEARRAY, ptr->typeTag());
+}
+
+TEST(AmfItemPtrTest, ItemCast) {
+	AmfItemPtr ptr(new AmfInteger(17));
+	EXPECT_EQ(ptr.get(), item_cast<AmfInteger>(ptr.get()));
+	EXPECT_EQ(nullptr, item_cast<AmfDouble>(ptr.get()));
+	EXPECT_EQ(nullptr, item_cast<AmfInteger>(static_cast<AmfItem*>(nullptr)));
+	EXPECT_EQ(nullptr, item_cast<DerivedInteger>(ptr.get()));
+	EXPECT_THROW(item_cast<AmfDouble>(*ptr), std::bad_cast);
+
+	// Subclasses of library types cast to both.
+	AmfItemPtr derived(new DerivedInteger(42));
+	EXPECT_EQ(AMF_INTEGER, derived->typeTag());
+	EXPECT_EQ(AmfInteger(42), derived.as<AmfInteger>());
+	EXPECT_EQ(42, derived.as<DerivedInteger>().value);
+	EXPECT_EQ(nullptr, derived.asPtr<AmfDouble>());
+
+	// Typed object vectors are object vectors, but not vice versa.
+	AmfItemPtr vec(new AmfVector<AmfItem>("foo"));
+	AmfItemPtr typed(new AmfVector<AmfInteger>({ 1 }, "foo"));
+	EXPECT_NE(nullptr, typed.asPtr<AmfVector<AmfItem>>());
+	EXPECT_NE(nullptr, typed.asPtr<AmfVector<AmfInteger>>());
+	EXPECT_EQ(nullptr, vec.asPtr<AmfVector<AmfInteger>>());
+	EXPECT_EQ(nullptr, vec.asPtr<AmfVector<int>>());
+}
@@ -35,3 +35,71 @@ TEST(AmfObjectTraitsTest, Equality) {
 	obj1.addAttribute("attr");
 	EXPECT_EQ(obj1, obj1e);
 }
+
+TEST(AmfObjectTraitsTest, Hash) {
+	AmfObjectTraitsHash hash;
+	AmfObjectTraits obj1("foo", false, true);
+	AmfObjectTraits obj2("foo", false, true);
+	EXPECT_EQ(hash(obj1), hash(obj2));
+
+	obj1.addAttribute("a");
+	obj1.addAttribute("b");
+	obj2.addAttribute("a");
+	obj2.addAttribute("b");
+	EXPECT_EQ(hash(obj1), hash(obj2));
+
+	// Attribute order is significant.
+	AmfObjectTraits obj3("foo", false, true);
+	obj3.addAttribute("b");
+	obj3.addAttribute("a");
+	EXPECT_NE(hash(obj1), hash(obj3));
+}
+
+TEST(AmfObjectTraitsTest, AttributeIndex) {
+	AmfObjectTraits obj("foo", false, false);
+	EXPECT_EQ(0u, obj.addAttribute("a"));
+	EXPECT_EQ(1u, obj.addAttribute("b"));
+	EXPECT_EQ(0u, obj.addAttribute("a"));
+
+	EXPECT_EQ(0u, obj.getAttributeIndex("a"));
+	EXPECT_EQ(1u, obj.getAttributeIndex("b"));
+	EXPECT_EQ(2u, obj.getAttributeIndex("c"));
+	EXPECT_TRUE(obj.isAttributeExists("b"));
+	EXPECT_FALSE(obj.isAttributeExists("c"));
+}
+
+TEST(AmfObjectTraitsTest, Intern) {
+	AmfObjectTraits obj1("foo", false, false);
+	obj1.addAttribute("a");
+	AmfObjectTraits obj2(obj1);
+	AmfObjectTraits obj3("foo", false, false);
+	obj3.addAttribute("b");
+	EXPECT_EQ(0u, obj1.getId());
+
+	AmfObjectTraitsPtr interned1 = AmfObjectTraits::intern(obj1);
+	AmfObjectTraitsPtr interned2 = AmfObjectTraits::intern(obj2);
+	AmfObjectTraitsPtr interned3 = AmfObjectTraits::intern(obj3);
+	EXPECT_EQ(interned1, interned2);
+	EXPECT_NE(interned1, interned3);
+	EXPECT_EQ(obj1, *interned1);
+	EXPECT_NE(0u, interned1->getId());
+	EXPECT_NE(interned1->getId(), interned3->getId());
+	EXPECT_NE(*interned1, *interned3);
+
+	// Copies of interned traits may be modified.
+	AmfObjectTraits copy(*interned1);
+	EXPECT_EQ(0u, copy.getId());
+	EXPECT_EQ(copy, *interned1);
+	copy.addAttribute("b");
+	EXPECT_NE(copy, *interned1);
+}
+
+TEST(AmfObjectTraitsTest, InternReleased) {
+	AmfObjectTraits obj("InternReleased", true, false);
+	size_t id = AmfObjectTraits::intern(obj)->getId();
+
+	// Ids aren't reused, even if the interned traits have been freed.
+	AmfObjectTraitsPtr interned = AmfObjectTraits::intern(obj);
+	EXPECT_NE(id, interned->getId());
+	EXPECT_EQ(interned, AmfObjectTraits::intern(obj));
+}
@@ -0,0 +1,97 @@
+#include "amftest.hpp"
+
+#include "utils/amforderedmap.hpp"
+
+static std::vector<std::string> keys(const AmfOrderedMap<int>& map) {
+	std::vector<std::string> ret;
+	for (const auto& it : map)
+		ret.push_back(it.first);
+
+	return ret;
+}
+
+TEST(AmfOrderedMapTest, InsertionOrder) {
+	AmfOrderedMap<int> map;
+	EXPECT_TRUE(map.empty());
+
+	map["b"] = 1;
+	map["a"] = 2;
+	map["c"] = 3;
+	EXPECT_EQ(3u, map.size());
+	EXPECT_EQ(std::vector<std::string>({ "b", "a", "c" }), keys(map));
+
+	// Existing keys keep their position.
+	map["b"] = 4;
+	EXPECT_FALSE(map.insert(std::make_pair(std::string("a"), 5)).second);
+	EXPECT_EQ(std::vector<std::string>({ "b", "a", "c" }), keys(map));
+	EXPECT_EQ(4, map.at("b"));
+	EXPECT_EQ(2, map.at("a"));
+}
+
+TEST(AmfOrderedMapTest, Lookup) {
+	AmfOrderedMap<int> map { { "foo", 1 }, { "bar", 2 } };
+
+	EXPECT_EQ(1, map.at("foo"));
+	EXPECT_EQ(1u, map.count("bar"));
+	EXPECT_EQ(0u, map.count("baz"));
+	EXPECT_EQ(map.end(), map.find("baz"));
+	EXPECT_EQ("bar", map.find("bar")->first);
+	EXPECT_THROW(map.at("baz"), std::out_of_range);
+
+	const AmfOrderedMap<int>& cmap = map;
+	EXPECT_EQ(2, cmap.at("bar"));
+	EXPECT_THROW(cmap.at("baz"), std::out_of_range);
+}
+
+TEST(AmfOrderedMapTest, ManyKeys) {
+	AmfOrderedMap<int> map;
+	for (int i = 0; i < 1000; ++i)
+		map[std::to_string(999 - i)] = i;
+
+	EXPECT_EQ(1000u, map.size());
+	for (int i = 0; i < 1000; ++i)
+		EXPECT_EQ(999 - i, map.at(std::to_string(i)));
+
+	EXPECT_EQ("999", map.begin()->first);
+	EXPECT_EQ(0u, map.count("1000"));
+
+	EXPECT_EQ(1u, map.erase("500"));
+	EXPECT_EQ(0u, map.erase("500"));
+	EXPECT_EQ(999u, map.size());
+	EXPECT_EQ(0u, map.count("500"));
+	EXPECT_EQ(500, map.at("499"));
+	EXPECT_EQ(498, map.at("501"));
+}
+
+TEST(AmfOrderedMapTest, Reserve) {
+	AmfOrderedMap<int> map;
+	map["a"] = 1;
+	map.reserve(100);
+
+	for (int i = 0; i < 100; ++i)
+		map[std::to_string(i)] = i;
+
+	EXPECT_EQ(101u, map.size());
+	EXPECT_EQ(1, map.at("a"));
+	EXPECT_EQ(5, map.at("5"));
+	EXPECT_EQ(99, map.at("99"));
+
+	map.clear();
+	EXPECT_TRUE(map.empty());
+	EXPECT_EQ(0u, map.count("a"));
+	map["b"] = 2;
+	EXPECT_EQ(2, map.at("b"));
+}
+
+TEST(AmfOrderedMapTest, Equality) {
+	AmfOrderedMap<int> map1 { { "a", 1 }, { "b", 2 } };
+	AmfOrderedMap<int> map2 { { "b", 2 }, { "a", 1 } };
+	AmfOrderedMap<int> map3 { { "a", 1 }, { "b", 3 } };
+	AmfOrderedMap<int> map4 { { "a", 1 } };
+
+	// The order of the keys doesn't matter.
+	EXPECT_EQ(map1, map2);
+	EXPECT_NE(map1, map3);
+	EXPECT_NE(map1, map4);
+	EXPECT_NE(map4, map1);
+}
@@ -0,0 +1,90 @@
+#include "amftest.hpp"
+
+#include "utils/amfstringview.hpp"
+
+TEST(AmfStringViewTest, Construction) {
+	AmfStringView empty;
+	EXPECT_TRUE(empty.empty());
+	EXPECT_EQ(0u, empty.size());
+	EXPECT_EQ("", empty);
+
+	const char* data = "foobar";
+	AmfStringView view(data, 3);
+	EXPECT_EQ(data, view.data());
+	EXPECT_EQ(3u, view.size());
+	EXPECT_EQ(std::string("foo"), view.str());
+
+	std::string str("qux");
+	AmfStringView fromString(str);
+	EXPECT_EQ(str.data(), fromString.data());
+	EXPECT_EQ(3u, fromString.size());
+}
+
+TEST(AmfStringViewTest, Equality) {
+	const char* data = "foofoo";
+	AmfStringView a(data, 3);
+	AmfStringView b(data + 3, 3);
+	AmfStringView c(data, 6);
+
+	EXPECT_TRUE(a == b);
+	EXPECT_FALSE(a != b);
+	EXPECT_FALSE(a == c);
+	EXPECT_TRUE(a != c);
+
+	EXPECT_EQ("foo", a);
+	EXPECT_EQ(a, "foo");
+	EXPECT_EQ(std::string("foo"), a);
+	EXPECT_EQ(a, std::string("foo"));
+	EXPECT_NE("fo", a);
+	EXPECT_NE(a, std::string("foob"));
+	EXPECT_EQ(AmfStringView(), AmfStringView(data, 0));
+}
+
+TEST(AmfStringSlabTest, Store) {
+	AmfStringSlab slab;
+	std::string str("foo");
+	AmfStringView view = slab.store(str.data(), str.size());
+
+	EXPECT_EQ("foo", view);
+	EXPECT_NE(str.data(), view.data());
+
+	str = "bar";
+	EXPECT_EQ("foo", view);
+
+	EXPECT_TRUE(slab.store(str.data(), 0).empty());
+}
+
+TEST(AmfStringSlabTest, ViewsStayValid) {
+	AmfStringSlab slab;
+	std::vector<AmfStringView> views;
+	std::vector<std::string> strings;
+
+	// Enough strings to span several chunks, including some large ones.
+	for (int i = 0; i < 2000; ++i) {
+		strings.push_back(std::string(i % 50 == 0 ? 2000 : 1, 'a') + std::to_string(i));
+		views.push_back(slab.store(strings.back().data(), strings.back().size()));
+	}
+
+	for (size_t i = 0; i < views.size(); ++i)
+		EXPECT_EQ(strings[i], views[i]);
+}
+
+TEST(AmfStringSlabTest, Copy) {
+	AmfStringView view;
+	AmfStringSlab copy;
+
+	{
+		AmfStringSlab slab;
+		view = slab.store("foo", 3);
+		copy = slab;
+
+		// Strings stored in either slab must not overwrite each other.
+		AmfStringView a = slab.store("bar", 3);
+		AmfStringView b = copy.store("qux", 3);
+		EXPECT_EQ("bar", a);
+		EXPECT_EQ("qux", b);
+	}
+
+	// The copy keeps the shared chunks alive.
+	EXPECT_EQ("foo", view);
+}